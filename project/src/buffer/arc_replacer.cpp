@@ -0,0 +1,270 @@
+/**
+ * ARC implementation
+ */
+#include <algorithm>
+#include <cassert>
+
+#include "buffer/arc_replacer.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template <typename T>
+ARCReplacer<T>::ARCReplacer(size_t capacity)
+    : capacity_(capacity), target_(0), size_(0) {}
+
+template <typename T> ARCReplacer<T>::~ARCReplacer() = default;
+
+/*
+ * Mark value as evictable, a value never seen before is put in T1
+ */
+template <typename T> void ARCReplacer<T>::Insert(const T &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = table_.find(value);
+  if (it == table_.end()) {
+    it = table_.emplace(value, entry()).first;
+    Track(value, it->second, List::T1);
+  }
+  if (!it->second.evictable) {
+    it->second.evictable = true;
+    ++size_;
+  }
+}
+
+/* Evict the LRU evictable value of T1 if T1 is larger than its target, of T2
+ * otherwise, falling back to the other list if the preferred one has nothing
+ * evictable. The page id of the victim is remembered in B1 or B2. If no value
+ * is evictable, return false
+ */
+template <typename T> bool ARCReplacer<T>::Victim(T &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (size_ == 0) {
+    return false;
+  }
+  List first = Preferred();
+  List second = first == List::T1 ? List::T2 : List::T1;
+  if (EvictFrom(first, value) || EvictFrom(second, value)) {
+    return true;
+  }
+  assert(false);
+  return false;
+}
+
+/*
+ * Remove value from the replacer, it stays in T1/T2. If removal is
+ * successful, return true, otherwise return false
+ */
+template <typename T> bool ARCReplacer<T>::Erase(const T &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = table_.find(value);
+  if (it != table_.end() && it->second.evictable) {
+    it->second.evictable = false;
+    --size_;
+    return true;
+  }
+  return false;
+}
+
+template <typename T> size_t ARCReplacer<T>::Size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return size_;
+}
+
+/*
+ * value is pinned for page_id. If value already holds page_id it is a hit
+ * and moves to T2. Otherwise page_id was just loaded into value: a ghost hit
+ * in B1 or B2 adapts the target size of T1 and puts it in T2, a real miss
+ * puts it in T1
+ */
+template <typename T>
+void ARCReplacer<T>::RecordAccess(const T &value, page_id_t page_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = table_.find(value);
+  if (it != table_.end() && it->second.page_id == page_id) {
+    Untrack(it->second);
+    Track(value, it->second, List::T2);
+    return;
+  }
+
+  bool evictable = false;
+  if (it != table_.end()) {
+    // another page in the same frame, start over
+    evictable = it->second.evictable;
+    Untrack(it->second);
+    table_.erase(it);
+  }
+
+  size_t b1 = ghosts_[static_cast<int>(List::T1)].size();
+  size_t b2 = ghosts_[static_cast<int>(List::T2)].size();
+  List list = List::T1;
+  if (Forget(List::T1, page_id)) {
+    target_ = std::min(capacity_, target_ + std::max(b2 / b1, size_t(1)));
+    list = List::T2;
+  } else if (Forget(List::T2, page_id)) {
+    target_ -= std::min(target_, std::max(b1 / b2, size_t(1)));
+    list = List::T2;
+  }
+
+  entry &e = table_[value];
+  e.page_id = page_id;
+  e.evictable = evictable;
+  Track(value, e, list);
+  TrimGhosts();
+}
+
+/*
+ * LRU end of the preferred list first, then of the other one
+ */
+template <typename T>
+size_t ARCReplacer<T>::PeekVictims(std::vector<T> &values, size_t max) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  size_t count = 0;
+  List first = Preferred();
+  for (List list : {first, first == List::T1 ? List::T2 : List::T1}) {
+    auto &l = lists_[static_cast<int>(list)];
+    for (auto pos = l.rbegin(); pos != l.rend() && count < max; ++pos) {
+      if (table_[*pos].evictable) {
+        values.push_back(*pos);
+        ++count;
+      }
+    }
+  }
+  return count;
+}
+
+/*
+ * Evict value like Victim would, its page is remembered in B1 or B2
+ */
+template <typename T> bool ARCReplacer<T>::Evict(const T &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = table_.find(value);
+  if (it == table_.end() || !it->second.evictable) {
+    return false;
+  }
+  if (it->second.page_id != INVALID_PAGE_ID) {
+    Remember(it->second.list, it->second.page_id);
+  }
+  Untrack(it->second);
+  table_.erase(it);
+  --size_;
+  TrimGhosts();
+  return true;
+}
+
+/*
+ * Drop value from T1/T2 without remembering its page
+ */
+template <typename T> void ARCReplacer<T>::Discard(const T &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = table_.find(value);
+  if (it != table_.end()) {
+    if (it->second.evictable) {
+      --size_;
+    }
+    Untrack(it->second);
+    table_.erase(it);
+  }
+}
+
+/*
+ * The pool gained or lost frames, the target and the ghosts follow
+ */
+template <typename T> void ARCReplacer<T>::SetCapacity(size_t capacity) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = capacity;
+  target_ = std::min(target_, capacity_);
+  TrimGhosts();
+}
+
+template <typename T> size_t ARCReplacer<T>::GetTarget() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return target_;
+}
+
+template <typename T>
+void ARCReplacer<T>::Track(const T &value, entry &e, List list) {
+  auto &l = lists_[static_cast<int>(list)];
+  l.push_front(value);
+  e.list = list;
+  e.pos = l.begin();
+}
+
+template <typename T> void ARCReplacer<T>::Untrack(entry &e) {
+  lists_[static_cast<int>(e.list)].erase(e.pos);
+}
+
+template <typename T>
+typename ARCReplacer<T>::List ARCReplacer<T>::Preferred() {
+  return lists_[static_cast<int>(List::T1)].size() > target_ ? List::T1
+                                                             : List::T2;
+}
+
+template <typename T> bool ARCReplacer<T>::EvictFrom(List list, T &value) {
+  auto &l = lists_[static_cast<int>(list)];
+  for (auto pos = l.rbegin(); pos != l.rend(); ++pos) {
+    auto it = table_.find(*pos);
+    assert(it != table_.end());
+    if (it->second.evictable) {
+      value = *pos;
+      if (it->second.page_id != INVALID_PAGE_ID) {
+        Remember(list, it->second.page_id);
+      }
+      l.erase(std::next(pos).base());
+      table_.erase(it);
+      --size_;
+      TrimGhosts();
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename T>
+void ARCReplacer<T>::Remember(List list, page_id_t page_id) {
+  // a page id is a ghost in at most one list
+  Forget(List::T1, page_id);
+  Forget(List::T2, page_id);
+  auto &ghosts = ghosts_[static_cast<int>(list)];
+  ghosts.push_front(page_id);
+  ghost_table_[static_cast<int>(list)][page_id] = ghosts.begin();
+}
+
+template <typename T>
+bool ARCReplacer<T>::Forget(List list, page_id_t page_id) {
+  auto &table = ghost_table_[static_cast<int>(list)];
+  auto it = table.find(page_id);
+  if (it == table.end()) {
+    return false;
+  }
+  ghosts_[static_cast<int>(list)].erase(it->second);
+  table.erase(it);
+  return true;
+}
+
+/*
+ * Keep |T1| + |B1| <= c and |T1| + |T2| + |B1| + |B2| <= 2c
+ */
+template <typename T> void ARCReplacer<T>::TrimGhosts() {
+  auto &b1 = ghosts_[static_cast<int>(List::T1)];
+  auto &b2 = ghosts_[static_cast<int>(List::T2)];
+  while (!b1.empty() &&
+         lists_[static_cast<int>(List::T1)].size() + b1.size() > capacity_) {
+    Forget(List::T1, b1.back());
+  }
+  while (!b2.empty() && table_.size() + b1.size() + b2.size() > 2 * capacity_) {
+    Forget(List::T2, b2.back());
+  }
+}
+
+template class ARCReplacer<Page *>;
+// test only
+template class ARCReplacer<int>;
+
+} // namespace cmudb
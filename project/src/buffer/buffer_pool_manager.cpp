@@ -6,101 +6,177 @@
  * it, also to unpin a page in the buffer pool.
  */
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <new>
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
+#include "common/logger.h"
 
 namespace cmudb {
 
+/*
+ * One shard per hardware thread, each of SHARD_MIN_FRAMES frames at least,
+ * used by StorageEngine
+ */
+size_t BufferPoolManager::DefaultNumShards(size_t pool_size) {
+  size_t num_threads = std::thread::hardware_concurrency();
+  return std::max<size_t>(
+      1, std::min<size_t>(num_threads, pool_size / SHARD_MIN_FRAMES));
+}
+
 /*
  * BufferPoolManager Constructor
  * When log_manager is nullptr, logging is disabled (for test purpose)
- * WARNING: Do Not Edit This Function
+ * num_shards: number of partitions, clamped into [1, pool_size]
+ * replacer_type: replacement policy used by every shard
  */
 BufferPoolManager::BufferPoolManager(size_t pool_size,
                                      DiskManager *disk_manager,
-                                     LogManager *log_manager)
-    : pool_size_(pool_size), disk_manager_(disk_manager),
-      log_manager_(log_manager) {
+                                     LogManager *log_manager,
+                                     size_t num_shards,
+                                     ReplacerType replacer_type)
+    : pool_size_(pool_size), num_shards_(num_shards),
+      disk_manager_(disk_manager), log_manager_(log_manager),
+      arena_(ENABLE_HUGE_PAGES), num_dirty_(0),
+      enable_cleaner_(false), cleaner_thread_(nullptr), low_watermark_(0),
+      high_watermark_(0), max_write_rate_(0), prefetch_thread_(nullptr),
+      last_miss_(INVALID_PAGE_ID), stop_prefetch_(false) {
+  if (num_shards_ == 0) {
+    num_shards_ = 1;
+  } else if (num_shards_ > pool_size && pool_size > 0) {
+    num_shards_ = pool_size;
+  }
 
-  // a consecutive memory space for buffer pool
-  pages_ = new Page[pool_size_];
-  free_list_ = new std::list<Page *>;
+  shards_ = new Shard[num_shards_];
+  if (!disk_manager_->IsMapped()) {
+    arena_.Reserve(pool_size);
+  }
 
-  replacer_ = new LRUReplacer<Page *>;
-  page_table_ = new ExtendibleHash<page_id_t, Page *>(BUCKET_SIZE);
+  for (size_t i = 0; i < num_shards_; ++i) {
+    shards_[i].free_list_ = new std::list<Page *>;
+    switch (replacer_type) {
+    case ReplacerType::CLOCK:
+      shards_[i].replacer_ = new ClockReplacer<Page *>;
+      break;
+    case ReplacerType::LRUK:
+      shards_[i].replacer_ = new LRUKReplacer<Page *>;
+      break;
+    case ReplacerType::ARC:
+      shards_[i].replacer_ =
+          new ARCReplacer<Page *>(GetShardSize(i, pool_size));
+      break;
+    default:
+      shards_[i].replacer_ = new LRUReplacer<Page *>;
+      break;
+    }
+    shards_[i].page_table_ =
+        new ConcurrentExtendibleHash<page_id_t, Page *>(BUCKET_SIZE);
 
-  // put all the pages into free list
-  for (size_t i = 0; i < pool_size_; ++i) {
-    free_list_->push_back(&pages_[i]);
+    // put the frames of this shard into its free list
+    for (size_t j = 0; j < GetShardSize(i, pool_size); ++j) {
+      Page *page = CreateFrame();
+      shards_[i].frames_.insert(page);
+      shards_[i].free_list_->push_back(page);
+    }
   }
 }
 
 /*
  * BufferPoolManager Destructor
- * WARNING: Do Not Edit This Function
  */
 BufferPoolManager::~BufferPoolManager() {
-  delete[] pages_;
-  delete page_table_;
-  delete replacer_;
-  delete free_list_;
+  StopPrefetchThread();
+  StopPageCleaner();
+  for (size_t i = 0; i < num_shards_; ++i) {
+    delete shards_[i].page_table_;
+    delete shards_[i].replacer_;
+    delete shards_[i].free_list_;
+    for (auto *page : shards_[i].frames_) {
+      DestroyFrame(page);
+    }
+  }
+  delete[] shards_;
 }
 
 /**
  * 1. search hash table.
- *  1.1 if exist, pin the page and return immediately
+ *  1.1 if exist, pin the page and return immediately, if the frame is in the
+ *      middle of I/O, wait for it and search again
  *  1.2 if no exist, find a replacement entry from either free list or lru
  *      replacer. (NOTE: always find from free list first)
  * 2. If the entry chosen for replacement is dirty, write it back to disk.
  * 3. Delete the entry for the old page from the hash table and insert an
  * entry for the new page.
  * 4. Update page metadata, read page content from disk file and return page
- * pointer
+ * pointer. If the page read is corrupted, free the frame and return nullptr
+ * Disk I/O of step 2 and 4 is done without holding the shard latch
  */
-Page *BufferPoolManager::FetchPage(page_id_t page_id) {
+Page *BufferPoolManager::FetchPage(page_id_t page_id, ScanRing *ring) {
+  return LoadPage(page_id, ring, true);
+}
+
+Page *BufferPoolManager::LoadPage(page_id_t page_id, ScanRing *ring,
+                                  bool record_access) {
   assert(page_id != INVALID_PAGE_ID);
-  std::lock_guard<std::mutex> lock(latch_);
+  Shard &shard = GetShard(page_id);
+  std::unique_lock<std::mutex> lock(shard.latch_);
 
   Page *res = nullptr;
-  if (page_table_->Find(page_id, res)) {
-    // mark the Page as pinned
-    ++res->pin_count_;
-    // remove its entry from LRUReplacer
-    replacer_->Erase(res);
-    return res;
-  } else {
-    if (!free_list_->empty()) {
-      res = free_list_->front();
-      free_list_->pop_front();
-    } else {
-      if (!replacer_->Victim(res)) {
-        return nullptr;
+  while (shard.page_table_->Find(page_id, res)) {
+    if (res->state_ == FrameState::RESIDENT ||
+        res->state_ == FrameState::FLUSHING) {
+      // mark the Page as pinned
+      ++res->pin_count_;
+      // remove its entry from LRUReplacer
+      shard.replacer_->Erase(res);
+      if (record_access) {
+        shard.replacer_->RecordAccess(res, page_id);
+        shard.stats_.hits_.fetch_add(1, std::memory_order_relaxed);
+        CountPin(shard, res->pin_count_);
       }
+      return res;
     }
+    auto start = std::chrono::steady_clock::now();
+    WaitForFrame(shard, res, lock);
+    std::chrono::nanoseconds waited = std::chrono::steady_clock::now() - start;
+    shard.stats_.pin_wait_ns_.fetch_add(waited.count(),
+                                        std::memory_order_relaxed);
+  }
+  if (!AcquireFrame(shard, page_id, res, lock, ring)) {
+    return nullptr;
+  }
+  if (record_access) {
+    shard.replacer_->RecordAccess(res, page_id);
+    shard.stats_.misses_.fetch_add(1, std::memory_order_relaxed);
+    CountPin(shard, 1);
   }
 
-  assert(res->pin_count_ == 0);
-  // dirty? write back
-  if (res->is_dirty_) {
-    if (ENABLE_LOGGING) {
-      while (res->GetLSN() > log_manager_->GetPersistentLSN()) {
-        std::promise<void> promise;
-        log_manager_->WakeupFlushThread(&promise);
-      }
+  bool ok;
+  if (disk_manager_->IsMapped()) {
+    // no copy, the frame points at the page in the mapped file
+    char *data = disk_manager_->GetMappedPage(page_id);
+    ok = data != nullptr;
+    if (ok) {
+      res->data_ = data;
     }
-    disk_manager_->WritePage(res->page_id_, res->GetData());
+  } else {
+    lock.unlock();
+    ok = ReadMiss(page_id, res, ring);
+    lock.lock();
+  }
+  if (!ok) {
+    // corrupted, fail rather than hand it out
+    DropFrame(shard, res);
+    return nullptr;
   }
-  // delete the entry for old page.
-  page_table_->Remove(res->page_id_);
-
-  // insert an entry for the new page.
-  page_table_->Insert(page_id, res);
-
-  // initial meta data
-  res->page_id_ = page_id;
-  res->is_dirty_ = false;
-  res->pin_count_ = 1;
-  disk_manager_->ReadPage(page_id, res->GetData());
 
+  res->state_ = FrameState::RESIDENT;
+  shard.cv_.notify_all();
   return res;
 }
 
@@ -112,18 +188,23 @@ Page *BufferPoolManager::FetchPage(page_id_t page_id) {
  */
 bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
   assert(page_id != INVALID_PAGE_ID);
-  std::lock_guard<std::mutex> lock(latch_);
+  Shard &shard = GetShard(page_id);
+  std::unique_lock<std::mutex> lock(shard.latch_);
 
   Page *page;
-  if (page_table_->Find(page_id, page)) {
+  if (shard.page_table_->Find(page_id, page) && page->page_id_ == page_id) {
     if (page->pin_count_ <= 0) {
       return false;
     }
-    if (--page->pin_count_ == 0) {
-      replacer_->Insert(page);
-    }
     if (is_dirty) {
-      page->is_dirty_ = true;
+      SetDirty(page, true);
+    }
+    if (--page->pin_count_ == 0) {
+      shard.replacer_->Insert(page);
+      // the pool is shrinking and this shard still owes frames
+      if (shard.num_retiring_ > 0) {
+        RetireFrames(shard, lock);
+      }
     }
     return true;
   }
@@ -135,17 +216,49 @@ bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
  * write_page method of the disk manager
  * if page is not found in page table, return false
  * NOTE: make sure page_id != INVALID_PAGE_ID
+ * A snapshot of the page is written unlatched, the frame stays usable but
+ * can not be evicted until the write is done.
  */
 bool BufferPoolManager::FlushPage(page_id_t page_id) {
   assert(page_id != INVALID_PAGE_ID);
-  std::lock_guard<std::mutex> lock(latch_);
+  Shard &shard = GetShard(page_id);
+  std::unique_lock<std::mutex> lock(shard.latch_);
 
   Page *page;
-  if (page_table_->Find(page_id, page)) {
-    disk_manager_->WritePage(page_id, page->GetData());
-    return true;
+  while (true) {
+    if (!shard.page_table_->Find(page_id, page)) {
+      return false;
+    }
+    if (page->state_ == FrameState::RESIDENT) {
+      break;
+    }
+    WaitForFrame(shard, page, lock);
   }
-  return false;
+
+  return WriteBack(shard, page, lock);
+}
+
+/*
+ * Pages dirtied while this runs may or may not be part of the checkpoint.
+ * The disk manager syncs the db file once, after all the writes
+ */
+void BufferPoolManager::FlushAllPages() {
+  for (size_t i = 0; i < num_shards_; ++i) {
+    std::vector<page_id_t> dirty_pages;
+    {
+      std::lock_guard<std::mutex> lock(shards_[i].latch_);
+      for (auto *page : shards_[i].frames_) {
+        if (page->page_id_ != INVALID_PAGE_ID && page->is_dirty_) {
+          dirty_pages.push_back(page->page_id_);
+        }
+      }
+    }
+    // FlushPage skips the pages evicted meanwhile, they are written already
+    for (auto page_id : dirty_pages) {
+      FlushPage(page_id);
+    }
+  }
+  disk_manager_->SyncPages();
 }
 
 /**
@@ -158,19 +271,28 @@ bool BufferPoolManager::FlushPage(page_id_t page_id) {
  */
 bool BufferPoolManager::DeletePage(page_id_t page_id) {
   assert(page_id != INVALID_PAGE_ID);
-  std::lock_guard<std::mutex> lock(latch_);
+  if (disk_manager_->IsReadOnly()) {
+    return false;
+  }
+  Shard &shard = GetShard(page_id);
+  std::lock_guard<std::mutex> lock(shard.latch_);
 
   Page *page;
-  if (page_table_->Find(page_id, page) && page->pin_count_ == 0) {
-    page_table_->Remove(page_id);
-    replacer_->Erase(page);
-    disk_manager_->DeallocatePage(page_id);
+  if (shard.page_table_->Find(page_id, page)) {
+    if (page->pin_count_ != 0 || page->state_ != FrameState::RESIDENT) {
+      return false;
+    }
+    shard.page_table_->Remove(page_id);
+    shard.replacer_->Erase(page);
 
     page->page_id_ = INVALID_PAGE_ID;
-    page->is_dirty_ = false;
-    free_list_->push_back(page);
+    SetDirty(page, false);
+    page->state_ = FrameState::FREE;
+    shard.free_list_->push_back(page);
   }
-  return false;
+  // the page id may be reused from now on
+  disk_manager_->DeallocatePage(page_id);
+  return true;
 }
 
 /**
@@ -181,45 +303,904 @@ bool BufferPoolManager::DeletePage(page_id_t page_id) {
  * update new page's metadata, zero out memory and add corresponding entry
  * into page table. return nullptr if all the pages in pool are pinned
  */
-Page *BufferPoolManager::NewPage(page_id_t &page_id) {
-  std::lock_guard<std::mutex> lock(latch_);
+Page *BufferPoolManager::NewPage(page_id_t &page_id, ScanRing *ring,
+                                 Extent *extent) {
+  // the shard is decided by page id, so allocate first
+  page_id = disk_manager_->AllocatePage(extent);
+  if (page_id == INVALID_PAGE_ID) {
+    // the db file is read only
+    return nullptr;
+  }
+  Shard &shard = GetShard(page_id);
+  std::unique_lock<std::mutex> lock(shard.latch_);
 
   Page *res = nullptr;
-  if (!free_list_->empty()) {
-    res = free_list_->front();
-    free_list_->pop_front();
-  } else {
-    if (!replacer_->Victim(res)) {
+  if (shard.page_table_->Find(page_id, res)) {
+    // a frame left from before the page id was free again holds nothing of
+    // the new page. One in use can not be taken
+    if (res->pin_count_ != 0 || res->state_ != FrameState::RESIDENT) {
+      LOG_DEBUG("page %d is allocated but still in use", page_id);
+      disk_manager_->DeallocatePage(page_id);
+      page_id = INVALID_PAGE_ID;
       return nullptr;
     }
+    DropFrame(shard, res);
+  }
+  if (!AcquireFrame(shard, page_id, res, lock, ring)) {
+    // all the pages of this shard are pinned, give back the page id
+    disk_manager_->DeallocatePage(page_id);
+    page_id = INVALID_PAGE_ID;
+    return nullptr;
+  }
+
+  shard.replacer_->RecordAccess(res, page_id);
+  CountPin(shard, 1);
+  res->ResetMemory();
+  res->state_ = FrameState::RESIDENT;
+  shard.cv_.notify_all();
+  return res;
+}
+
+/*
+ * FetchPage, then read latch the page
+ */
+ReadPageGuard BufferPoolManager::FetchPageRead(page_id_t page_id,
+                                               ScanRing *ring) {
+  Page *page = FetchPage(page_id, ring);
+  if (page == nullptr) {
+    return ReadPageGuard();
+  }
+  page->RLatch();
+  return ReadPageGuard(this, page);
+}
+
+/*
+ * FetchPage, then write latch the page
+ */
+WritePageGuard BufferPoolManager::FetchPageWrite(page_id_t page_id,
+                                                 ScanRing *ring) {
+  Page *page = FetchPage(page_id, ring);
+  if (page == nullptr) {
+    return WritePageGuard();
   }
+  page->WLatch();
+  return WritePageGuard(this, page);
+}
 
-  assert(res->pin_count_ == 0);
-  page_id = disk_manager_->AllocatePage();
+/*
+ * NewPage, then write latch the page. A new page is dirty from the start
+ */
+WritePageGuard BufferPoolManager::NewPageWrite(page_id_t &page_id,
+                                               ScanRing *ring,
+                                               Extent *extent) {
+  Page *page = NewPage(page_id, ring, extent);
+  if (page == nullptr) {
+    return WritePageGuard();
+  }
+  page->WLatch();
+  WritePageGuard guard(this, page);
+  guard.MarkDirty();
+  return guard;
+}
 
-  // dirty? write back
-  if (res->is_dirty_) {
-    if (ENABLE_LOGGING) {
-      while (res->GetLSN() > log_manager_->GetPersistentLSN()) {
-        std::promise<void> promise;
-        log_manager_->WakeupFlushThread(&promise);
+/*
+ * Queue a read-ahead request, the I/O thread is started on first use.
+ * Requests are dropped if the thread falls far behind. A ring is kept busy
+ * until the request is done, so that it outlives it
+ */
+void BufferPoolManager::PrefetchPage(page_id_t page_id, size_t depth,
+                                     std::function<page_id_t(Page *)> next,
+                                     ScanRing *ring) {
+  if (page_id == INVALID_PAGE_ID || depth == 0) {
+    return;
+  }
+  if (disk_manager_->IsMapped() && !next) {
+    // the kernel reads ahead in the mapped file, no thread needed
+    disk_manager_->PrefetchMappedPages(page_id, depth);
+    return;
+  }
+  std::lock_guard<std::mutex> lock(prefetch_latch_);
+  if (stop_prefetch_ || prefetch_queue_.size() >= 16) {
+    return;
+  }
+  depth = std::min(depth, std::max(pool_size_ / 4, size_t(1)));
+  if (ring != nullptr) {
+    // leave the other half to the pages the scan is reading
+    depth = std::min(depth, std::max(GetRingLimit(ring) / 2, size_t(1)));
+    std::lock_guard<std::mutex> ring_lock(ring->latch_);
+    ++ring->pending_;
+  }
+  prefetch_queue_.push_back({page_id, depth, next, ring});
+  prefetch_cv_.notify_one();
+
+  if (prefetch_thread_ == nullptr) {
+    prefetch_thread_ = new std::thread([this]() {
+      while (true) {
+        std::unique_lock<std::mutex> lock(prefetch_latch_);
+        prefetch_cv_.wait(lock, [this]() {
+          return stop_prefetch_ || !prefetch_queue_.empty();
+        });
+        if (stop_prefetch_) {
+          break;
+        }
+        PrefetchRequest request = std::move(prefetch_queue_.front());
+        prefetch_queue_.pop_front();
+        lock.unlock();
+
+        // consecutive pages are all known up front, read them at once
+        if (!request.next) {
+          PrefetchRange(request.page_id, request.depth, request.ring);
+        } else {
+          // an access is recorded when the scan actually gets there
+          page_id_t cur = request.page_id;
+          for (size_t i = 0; i < request.depth && cur >= 0; ++i) {
+            Page *page = LoadPage(cur, request.ring, false);
+            if (page == nullptr) {
+              // all pinned, give up
+              break;
+            }
+            page_id_t next_page_id = INVALID_PAGE_ID;
+            if (i + 1 < request.depth) {
+              next_page_id = request.next(page);
+            }
+            UnpinPage(cur, false);
+            cur = next_page_id;
+          }
+        }
+        GetShard(request.page_id)
+            .stats_.prefetches_.fetch_add(1, std::memory_order_relaxed);
+        if (request.ring != nullptr) {
+          ReleaseRing(request.ring);
+        }
       }
+    });
+  }
+}
+
+/*
+ * Each frame becomes resident as soon as its own read is done. Return once all
+ * the reads are, so that none is left behind when the pool goes away. Like
+ * ReadMiss, the range ends at the first page which is not allocated
+ */
+void BufferPoolManager::PrefetchRange(page_id_t page_id, size_t depth,
+                                      ScanRing *ring) {
+  std::vector<PageIORequest> requests;
+  std::vector<std::promise<void>> done(depth);
+  std::vector<std::future<void>> futures;
+  for (size_t i = 0; i < depth; ++i) {
+    page_id_t cur = page_id + static_cast<page_id_t>(i);
+    if (!disk_manager_->IsAllocated(cur)) {
+      break;
+    }
+    Shard &shard = GetShard(cur);
+    std::unique_lock<std::mutex> lock(shard.latch_);
+    Page *page;
+    if (shard.page_table_->Find(cur, page)) {
+      // in the pool, or on its way
+      continue;
+    }
+    if (!AcquireFrame(shard, cur, page, lock, ring)) {
+      // all pinned, give up
+      break;
+    }
+    // an access is recorded when the scan actually gets there
+    std::promise<void> *promise = &done[futures.size()];
+    futures.push_back(promise->get_future());
+    requests.push_back({false, cur, page->GetData(),
+                        [this, &shard, page, cur, promise](bool ok) {
+                          {
+                            std::lock_guard<std::mutex> lock(shard.latch_);
+                            if (!ok) {
+                              DropFrame(shard, page);
+                            } else {
+                              page->state_ = FrameState::RESIDENT;
+                              shard.cv_.notify_all();
+                            }
+                          }
+                          if (ok) {
+                            UnpinPage(cur, false);
+                          }
+                          promise->set_value();
+                        }});
+  }
+
+  if (!requests.empty()) {
+    disk_manager_->SubmitPageIO(requests);
+  }
+  for (auto &future : futures) {
+    future.wait();
+  }
+}
+
+/*
+ * Only allocated pages are read ahead, a page id allocated later must not
+ * find a stale frame. The pages read along are left unpinned, their access is
+ * recorded when the scan actually gets there
+ */
+bool BufferPoolManager::ReadMiss(page_id_t page_id, Page *page,
+                                 ScanRing *ring) {
+  std::vector<Page *> pages{page};
+  page_id_t last_miss = last_miss_.exchange(page_id);
+  if (last_miss != INVALID_PAGE_ID && last_miss + 1 == page_id) {
+    size_t max_run =
+        std::min<size_t>(READ_AHEAD_SIZE, std::max(pool_size_ / 4, size_t(1)));
+    while (pages.size() < max_run) {
+      page_id_t cur = page_id + static_cast<page_id_t>(pages.size());
+      if (!disk_manager_->IsAllocated(cur)) {
+        break;
+      }
+      Shard &shard = GetShard(cur);
+      std::unique_lock<std::mutex> lock(shard.latch_);
+      Page *next;
+      // the run ends at the first page in the pool, or when all are pinned
+      if (shard.page_table_->Find(cur, next) ||
+          !AcquireFrame(shard, cur, next, lock, ring)) {
+        break;
+      }
+      pages.push_back(next);
+    }
+  }
+
+  std::vector<char *> buffers;
+  for (auto *p : pages) {
+    buffers.push_back(p->GetData());
+  }
+  std::unique_ptr<bool[]> valid(new bool[pages.size()]);
+  disk_manager_->ReadPages(page_id, pages.size(), buffers.data(), valid.get());
+  // the next miss of the stream is right after the run
+  last_miss_ = page_id + static_cast<page_id_t>(pages.size()) - 1;
+
+  for (size_t i = 1; i < pages.size(); ++i) {
+    page_id_t cur = page_id + static_cast<page_id_t>(i);
+    Shard &shard = GetShard(cur);
+    {
+      std::lock_guard<std::mutex> lock(shard.latch_);
+      if (!valid[i]) {
+        DropFrame(shard, pages[i]);
+        continue;
+      }
+      pages[i]->state_ = FrameState::RESIDENT;
+      shard.cv_.notify_all();
+    }
+    UnpinPage(cur, false);
+  }
+  return valid[0];
+}
+
+/*
+ * Drop pending read-ahead requests, stop and join the I/O thread
+ */
+void BufferPoolManager::StopPrefetchThread() {
+  {
+    std::lock_guard<std::mutex> lock(prefetch_latch_);
+    stop_prefetch_ = true;
+    for (auto &request : prefetch_queue_) {
+      if (request.ring != nullptr) {
+        ReleaseRing(request.ring);
+      }
+    }
+    prefetch_queue_.clear();
+  }
+  prefetch_cv_.notify_one();
+  if (prefetch_thread_ != nullptr) {
+    prefetch_thread_->join();
+    delete prefetch_thread_;
+    prefetch_thread_ = nullptr;
+  }
+}
+
+/*
+ * Take a frame out of the ring or the free list, or evict one from the
+ * replacer
+ * should be called when holding the shard latch
+ */
+bool BufferPoolManager::GetVictim(Shard &shard, Page *&page, ScanRing *ring) {
+  if (ring != nullptr && RecycleRingFrame(shard, page, ring)) {
+    return true;
+  }
+  if (!shard.free_list_->empty()) {
+    page = shard.free_list_->front();
+    shard.free_list_->pop_front();
+    return true;
+  }
+  if (ENABLE_LOGGING && log_manager_ != nullptr) {
+    return GetDurableVictim(shard, page);
+  }
+
+  // frames being flushed can not be reused until the write is done
+  std::vector<Page *> flushing;
+  bool found = false;
+  while (shard.replacer_->Victim(page)) {
+    if (page->state_ != FrameState::FLUSHING) {
+      found = true;
+      break;
+    }
+    flushing.push_back(page);
+  }
+  for (auto *p : flushing) {
+    shard.replacer_->Insert(p);
+  }
+  return found;
+}
+
+/*
+ * Look at the next VICTIM_WINDOW victims, then at all of them if needed:
+ * clean frames first, then dirty frames which can be written without
+ * waiting for the log, in replacement order. Otherwise the first dirty
+ * frame is taken and AcquireFrame forces the log. Any undurable candidate
+ * starts a log flush without waiting for it
+ * should be called when holding the shard latch
+ */
+bool BufferPoolManager::GetDurableVictim(Shard &shard, Page *&page) {
+  lsn_t persistent_lsn = log_manager_->GetPersistentLSN();
+  std::vector<Page *> candidates;
+  Page *clean = nullptr, *durable = nullptr, *fallback = nullptr;
+  bool undurable = false;
+  for (size_t window : {size_t(VICTIM_WINDOW), shard.replacer_->Size()}) {
+    candidates.clear();
+    shard.replacer_->PeekVictims(candidates, window);
+    for (auto *p : candidates) {
+      // frames being flushed can not be reused until the write is done
+      if (p->state_ == FrameState::FLUSHING) {
+        continue;
+      }
+      if (!p->is_dirty_) {
+        clean = p;
+        break;
+      }
+      if (p->GetLSN() > persistent_lsn) {
+        undurable = true;
+      } else if (durable == nullptr) {
+        durable = p;
+      }
+      if (fallback == nullptr) {
+        fallback = p;
+      }
+    }
+    if (clean != nullptr || durable != nullptr || candidates.size() < window) {
+      // found, or the whole replacer has been looked at
+      break;
+    }
+  }
+
+  if (undurable) {
+    log_manager_->RequestFlush();
+  }
+  page = clean != nullptr ? clean : durable != nullptr ? durable : fallback;
+  return page != nullptr && shard.replacer_->Evict(page);
+}
+
+/*
+ * Starting from the oldest slot, find a frame of this shard which still
+ * holds the page loaded through the ring and is not pinned
+ * should be called when holding the shard latch
+ */
+bool BufferPoolManager::RecycleRingFrame(Shard &shard, Page *&page,
+                                         ScanRing *ring) {
+  size_t shard_id = &shard - shards_;
+  std::lock_guard<std::mutex> ring_lock(ring->latch_);
+  size_t size = ring->slots_.size();
+  for (size_t i = 0; i < size; ++i) {
+    size_t pos = (ring->hand_ + i) % size;
+    auto &slot = ring->slots_[pos];
+    // the frame may have been released by Resize, look it up by page id
+    Page *cur;
+    if (slot.shard != shard_id ||
+        !shard.page_table_->Find(slot.page_id, cur) || cur != slot.page ||
+        slot.page->state_ != FrameState::RESIDENT) {
+      continue;
+    }
+    // only unpinned frames are in the replacer
+    if (shard.replacer_->Erase(slot.page)) {
+      page = slot.page;
+      ring->hand_ = (pos + 1) % size;
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * A ring never grows beyond 1/8 of the pool (but at least a few frames, so a
+ * scan holding the current page while fetching the next one can recycle),
+ * when it is full the oldest slot gives up its frame to the new one
+ * should be called when holding the shard latch
+ */
+void BufferPoolManager::TrackRingFrame(Shard &shard, Page *page,
+                                       page_id_t page_id, ScanRing *ring) {
+  size_t shard_id = &shard - shards_;
+  std::lock_guard<std::mutex> ring_lock(ring->latch_);
+  for (auto &slot : ring->slots_) {
+    if (slot.page == page) {
+      // recycled
+      slot.page_id = page_id;
+      return;
     }
-    disk_manager_->WritePage(res->page_id_, res->GetData());
   }
-  // delete the entry for old page.
-  page_table_->Remove(res->page_id_);
 
-  // insert an entry for the new page.
-  page_table_->Insert(page_id, res);
+  if (ring->slots_.size() < GetRingLimit(ring)) {
+    ring->slots_.push_back({page, page_id, shard_id});
+  } else {
+    ring->slots_[ring->hand_] = {page, page_id, shard_id};
+    ring->hand_ = (ring->hand_ + 1) % ring->slots_.size();
+  }
+}
+
+void BufferPoolManager::ReleaseRing(ScanRing *ring) {
+  std::lock_guard<std::mutex> lock(ring->latch_);
+  if (--ring->pending_ == 0) {
+    ring->cv_.notify_all();
+  }
+}
+
+/*
+ * Find a victim frame for page_id and write back its old content if dirty.
+ * The new page id is mapped to the frame before the write-back, so requesters
+ * of both the old and the new page wait on the frame.
+ * should be called when holding the shard latch, which is released during
+ * the write-back
+ */
+bool BufferPoolManager::AcquireFrame(Shard &shard, page_id_t page_id,
+                                     Page *&page,
+                                     std::unique_lock<std::mutex> &lock,
+                                     ScanRing *ring) {
+  if (!GetVictim(shard, page, ring)) {
+    return false;
+  }
+  if (ring != nullptr) {
+    TrackRingFrame(shard, page, page_id, ring);
+  }
+
+  assert(page->pin_count_ == 0);
+  page->pin_count_ = 1;
+  // insert an entry for the new page, the callers looked it up first: a page
+  // id backed by two frames would lose its mapping with the first evicted
+  Page *mapped;
+  assert(!shard.page_table_->Find(page_id, mapped));
+  (void)mapped;
+  shard.page_table_->Insert(page_id, page);
+
+  if (page->page_id_ != INVALID_PAGE_ID) {
+    shard.stats_.evictions_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // dirty? write back, and let the cleaner know it is falling behind
+  if (page->is_dirty_) {
+    page->state_ = FrameState::WRITING_BACK;
+    lock.unlock();
+    if (enable_cleaner_) {
+      cleaner_cv_.notify_one();
+    }
+
+    shard.stats_.dirty_writebacks_.fetch_add(1, std::memory_order_relaxed);
+    if (FlushLog(page->GetLSN())) {
+      shard.stats_.wal_waits_.fetch_add(1, std::memory_order_relaxed);
+      shard.stats_.eviction_wal_waits_.fetch_add(1, std::memory_order_relaxed);
+    }
+    bool written = disk_manager_->WritePage(page->page_id_, page->GetData());
+
+    lock.lock();
+    if (!written) {
+      // keep the old page, it is the only copy of the update
+      LOG_DEBUG("write-back of page %d failed", page->page_id_);
+      shard.page_table_->Remove(page_id);
+      page->pin_count_ = 0;
+      page->state_ = FrameState::RESIDENT;
+      shard.replacer_->Insert(page);
+      shard.cv_.notify_all();
+      return false;
+    }
+  }
+  // delete the entry for old page.
+  if (page->page_id_ != INVALID_PAGE_ID) {
+    shard.page_table_->Remove(page->page_id_);
+  }
 
   // initial meta data
-  res->page_id_ = page_id;
-  res->is_dirty_ = false;
-  res->pin_count_ = 1;
-  res->ResetMemory();
+  page->page_id_ = page_id;
+  SetDirty(page, false);
+  page->state_ = FrameState::LOADING;
+  shard.cv_.notify_all();
+  return true;
+}
 
-  return res;
+/*
+ * Give back the frame of a page which could not be read. Requesters waiting
+ * on it look the page up again
+ * should be called when holding the shard latch
+ */
+void BufferPoolManager::DropFrame(Shard &shard, Page *page) {
+  shard.page_table_->Remove(page->page_id_);
+  shard.replacer_->Erase(page);
+  page->page_id_ = INVALID_PAGE_ID;
+  page->pin_count_ = 0;
+  SetDirty(page, false);
+  page->state_ = FrameState::FREE;
+  shard.free_list_->push_back(page);
+  shard.cv_.notify_all();
+}
+
+/*
+ * Block until the frame leaves its current state, holds another page or is
+ * released by Resize
+ * should be called when holding the shard latch
+ */
+void BufferPoolManager::WaitForFrame(Shard &shard, Page *page,
+                                     std::unique_lock<std::mutex> &lock) {
+  FrameState state = page->state_;
+  page_id_t page_id = page->page_id_;
+  shard.cv_.wait(lock, [&shard, page, state, page_id]() {
+    return shard.frames_.count(page) == 0 || page->state_ != state ||
+           page->page_id_ != page_id;
+  });
+}
+
+/*
+ * Force the log manager to flush until lsn is persistent
+ * should be called without holding any shard latch
+ */
+bool BufferPoolManager::FlushLog(lsn_t lsn) {
+  bool waited = false;
+  if (ENABLE_LOGGING && log_manager_ != nullptr) {
+    while (lsn > log_manager_->GetPersistentLSN()) {
+      std::promise<void> promise;
+      log_manager_->WakeupFlushThread(&promise);
+      waited = true;
+    }
+  }
+  return waited;
+}
+
+/*
+ * Bucket i counts pins leaving the page pinned (2^(i-1), 2^i] times, the
+ * last bucket takes everything above
+ */
+void BufferPoolManager::CountPin(Shard &shard, int pin_count) {
+  size_t bucket = 0;
+  while (bucket + 1 < PIN_HISTOGRAM_SIZE && (1 << bucket) < pin_count) {
+    ++bucket;
+  }
+  shard.stats_.pin_count_histogram_[bucket].fetch_add(
+      1, std::memory_order_relaxed);
+}
+
+/*
+ * Snapshot the pages under the shard latch, then write the copies unlatched.
+ * The frames stay usable meanwhile but can not be evicted until the writes are
+ * done
+ */
+bool BufferPoolManager::WriteBack(Shard &shard, std::vector<Page *> &pages,
+                                  std::unique_lock<std::mutex> &lock) {
+  size_t num_pages = pages.size();
+  // aligned, so that direct I/O needs no copy of its own
+  std::unique_ptr<char, decltype(&free)> data(
+      static_cast<char *>(aligned_alloc(PAGE_SIZE, num_pages * PAGE_SIZE)),
+      &free);
+  if (!data) {
+    throw std::bad_alloc();
+  }
+  std::vector<page_id_t> page_ids;
+  lsn_t lsn = INVALID_LSN;
+  for (size_t i = 0; i < num_pages; ++i) {
+    Page *page = pages[i];
+    assert(page->state_ == FrameState::RESIDENT);
+    memcpy(data.get() + i * PAGE_SIZE, page->GetData(), PAGE_SIZE);
+    page_ids.push_back(page->page_id_);
+    lsn = std::max(lsn, page->GetLSN());
+    page->state_ = FrameState::FLUSHING;
+    SetDirty(page, false);
+  }
+  lock.unlock();
+
+  shard.stats_.flushes_.fetch_add(num_pages, std::memory_order_relaxed);
+  if (FlushLog(lsn)) {
+    shard.stats_.wal_waits_.fetch_add(1, std::memory_order_relaxed);
+  }
+  std::vector<bool> written(num_pages);
+  if (num_pages == 1) {
+    written[0] = disk_manager_->WritePage(page_ids[0], data.get());
+  } else {
+    std::vector<std::promise<bool>> done(num_pages);
+    std::vector<std::future<bool>> futures;
+    std::vector<PageIORequest> requests;
+    for (size_t i = 0; i < num_pages; ++i) {
+      std::promise<bool> *promise = &done[i];
+      futures.push_back(promise->get_future());
+      requests.push_back({true, page_ids[i], data.get() + i * PAGE_SIZE,
+                          [promise](bool ok) { promise->set_value(ok); }});
+    }
+    disk_manager_->SubmitPageIO(requests);
+    for (size_t i = 0; i < num_pages; ++i) {
+      written[i] = futures[i].get();
+    }
+  }
+
+  lock.lock();
+  bool all_written = true;
+  for (size_t i = 0; i < num_pages; ++i) {
+    Page *page = pages[i];
+    page->state_ = FrameState::RESIDENT;
+    if (!written[i]) {
+      // dirty again, the next flush or eviction retries the write
+      LOG_DEBUG("write-back of page %d failed", page_ids[i]);
+      SetDirty(page, true);
+      all_written = false;
+    }
+  }
+  shard.cv_.notify_all();
+  return all_written;
+}
+
+/*
+ * Grow or shrink every shard to its share of pool_size frames. Growing only
+ * adds free frames. Shrinking first cancels frames still owed by a previous
+ * shrink, then releases what it can right away, the rest is released by
+ * UnpinPage. If pool_size is less than the number of shards, return false
+ */
+bool BufferPoolManager::Resize(size_t pool_size) {
+  if (pool_size < num_shards_) {
+    return false;
+  }
+  std::lock_guard<std::mutex> resize_lock(resize_latch_);
+  if (pool_size > pool_size_ && !disk_manager_->IsMapped() &&
+      !arena_.Reserve(pool_size - pool_size_)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < num_shards_; ++i) {
+    Shard &shard = shards_[i];
+    std::unique_lock<std::mutex> lock(shard.latch_);
+
+    size_t target = GetShardSize(i, pool_size);
+    size_t current = shard.frames_.size() - shard.num_retiring_;
+    if (target > current) {
+      size_t grow = target - current;
+      size_t cancel = std::min(grow, shard.num_retiring_);
+      shard.num_retiring_ -= cancel;
+      for (size_t j = cancel; j < grow; ++j) {
+        Page *page = CreateFrame();
+        shard.frames_.insert(page);
+        shard.free_list_->push_back(page);
+      }
+    } else {
+      shard.num_retiring_ += current - target;
+    }
+    shard.replacer_->SetCapacity(target);
+    RetireFrames(shard, lock);
+  }
+
+  pool_size_ = pool_size;
+  return true;
+}
+
+/*
+ * Free frames go first, then unpinned frames from the cold end of the
+ * replacer. A dirty page is written back and looked at again, it may have
+ * been pinned meanwhile. Frames being flushed are skipped
+ */
+void BufferPoolManager::RetireFrames(Shard &shard,
+                                     std::unique_lock<std::mutex> &lock) {
+  std::vector<Page *> candidates;
+  while (shard.num_retiring_ > 0) {
+    Page *page = nullptr;
+    if (!shard.free_list_->empty()) {
+      page = shard.free_list_->front();
+      shard.free_list_->pop_front();
+    } else {
+      candidates.clear();
+      shard.replacer_->PeekVictims(candidates, shard.num_retiring_);
+      for (auto *p : candidates) {
+        if (p->state_ == FrameState::RESIDENT && p->pin_count_ == 0) {
+          page = p;
+          break;
+        }
+      }
+      if (page == nullptr) {
+        // everything is pinned or being flushed, wait for the next unpin
+        return;
+      }
+      if (page->is_dirty_) {
+        if (!WriteBack(shard, page, lock)) {
+          // try again on the next unpin rather than spin on a failing write
+          return;
+        }
+        continue;
+      }
+      shard.replacer_->Discard(page);
+      shard.page_table_->Remove(page->page_id_);
+    }
+
+    shard.frames_.erase(page);
+    DestroyFrame(page);
+    --shard.num_retiring_;
+  }
+  // wake up the waiters of released frames
+  shard.cv_.notify_all();
+}
+
+Page *BufferPoolManager::CreateFrame() {
+  if (disk_manager_->IsMapped()) {
+    return new Page();
+  }
+  return new Page(arena_.Allocate());
+}
+
+void BufferPoolManager::DestroyFrame(Page *page) {
+  if (!disk_manager_->IsMapped()) {
+    arena_.Free(page->data_);
+  }
+  delete page;
+}
+
+void BufferPoolManager::SetDirty(Page *page, bool is_dirty) {
+  if (page->is_dirty_ != is_dirty) {
+    page->is_dirty_ = is_dirty;
+    if (is_dirty) {
+      ++num_dirty_;
+    } else {
+      --num_dirty_;
+    }
+  }
+}
+
+/*
+ * Spawn a thread waking up every CLEANER_TIMEOUT (or when a foreground
+ * eviction had to write back) to clean pages at a rate depending on the
+ * ratio of dirty frames
+ */
+void BufferPoolManager::RunPageCleaner(double low_watermark,
+                                       double high_watermark,
+                                       size_t max_write_rate) {
+  if (enable_cleaner_) {
+    return;
+  }
+  low_watermark_ = low_watermark;
+  high_watermark_ = std::max(high_watermark, low_watermark);
+  max_write_rate_ = max_write_rate;
+  enable_cleaner_ = true;
+
+  cleaner_thread_ = new std::thread([this]() {
+    // number of pages allowed to be written, earned over time
+    double credit = 0;
+    auto last = std::chrono::steady_clock::now();
+    while (enable_cleaner_) {
+      {
+        std::unique_lock<std::mutex> lock(cleaner_latch_);
+        cleaner_cv_.wait_for(lock, CLEANER_TIMEOUT);
+      }
+      auto now = std::chrono::steady_clock::now();
+      std::chrono::duration<double> elapsed = now - last;
+      last = now;
+
+      size_t num_dirty = num_dirty_;
+      size_t pool_size = pool_size_;
+      size_t low_dirty = static_cast<size_t>(low_watermark_ * pool_size);
+      double ratio = static_cast<double>(num_dirty) / pool_size;
+      if (!enable_cleaner_ || ratio <= low_watermark_) {
+        credit = 0;
+        continue;
+      }
+      double speed = 1.0;
+      if (ratio < high_watermark_) {
+        speed = (ratio - low_watermark_) / (high_watermark_ - low_watermark_);
+      }
+      // never save up more than one second of writes
+      credit = std::min(credit + speed * max_write_rate_ * elapsed.count(),
+                        static_cast<double>(max_write_rate_));
+      // no need to go below the low watermark
+      size_t budget = std::min(static_cast<size_t>(credit),
+                               num_dirty - std::min(num_dirty, low_dirty));
+      if (budget > 0) {
+        size_t written = CleanPages(budget);
+        credit = written < budget ? 0 : credit - written;
+      }
+    }
+  });
+}
+
+/*
+ * Stop and join the page cleaner
+ */
+void BufferPoolManager::StopPageCleaner() {
+  if (enable_cleaner_) {
+    enable_cleaner_ = false;
+    cleaner_cv_.notify_one();
+    cleaner_thread_->join();
+    delete cleaner_thread_;
+    cleaner_thread_ = nullptr;
+  }
+}
+
+/*
+ * Walk the cold end of every shard's replacer and write back dirty unpinned
+ * pages, the budget is spread evenly over the shards
+ */
+size_t BufferPoolManager::CleanPages(size_t budget) {
+  size_t quota = (budget + num_shards_ - 1) / num_shards_;
+  size_t written = 0;
+  std::vector<Page *> candidates, pages;
+
+  for (size_t i = 0; i < num_shards_ && written < budget; ++i) {
+    Shard &shard = shards_[i];
+    std::unique_lock<std::mutex> lock(shard.latch_);
+
+    // most cold frames may be clean already, look a bit deeper
+    candidates.clear();
+    shard.replacer_->PeekVictims(candidates, 4 * quota);
+    pages.clear();
+    for (auto *page : candidates) {
+      if (pages.size() == quota || written + pages.size() == budget) {
+        break;
+      }
+      if (page->is_dirty_ && page->pin_count_ == 0 &&
+          page->state_ == FrameState::RESIDENT) {
+        pages.push_back(page);
+      }
+    }
+    // written in one batch
+    if (!pages.empty()) {
+      WriteBack(shard, pages, lock);
+      written += pages.size();
+    }
+  }
+  return written;
+}
+
+/*
+ * Sum of the counters, read without any latch. A snapshot taken while the
+ * pool is busy may be slightly inconsistent, e.g. hits + misses may lag
+ * behind the histogram
+ */
+BufferPoolStats BufferPoolManager::GetStats(size_t shard_id) const {
+  BufferPoolStats stats;
+  shards_[shard_id].stats_.AddTo(stats);
+  return stats;
+}
+
+BufferPoolStats BufferPoolManager::GetStats() const {
+  BufferPoolStats stats;
+  for (size_t i = 0; i < num_shards_; ++i) {
+    shards_[i].stats_.AddTo(stats);
+  }
+  return stats;
+}
+
+void BufferPoolManager::ResetStats() {
+  for (size_t i = 0; i < num_shards_; ++i) {
+    shards_[i].stats_.Reset();
+  }
+}
+
+void BufferPoolManager::ShardStats::Reset() {
+  hits_.store(0, std::memory_order_relaxed);
+  misses_.store(0, std::memory_order_relaxed);
+  evictions_.store(0, std::memory_order_relaxed);
+  dirty_writebacks_.store(0, std::memory_order_relaxed);
+  flushes_.store(0, std::memory_order_relaxed);
+  wal_waits_.store(0, std::memory_order_relaxed);
+  eviction_wal_waits_.store(0, std::memory_order_relaxed);
+  pin_wait_ns_.store(0, std::memory_order_relaxed);
+  prefetches_.store(0, std::memory_order_relaxed);
+  for (auto &bucket : pin_count_histogram_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+void BufferPoolManager::ShardStats::AddTo(BufferPoolStats &stats) const {
+  stats.hits += hits_.load(std::memory_order_relaxed);
+  stats.misses += misses_.load(std::memory_order_relaxed);
+  stats.evictions += evictions_.load(std::memory_order_relaxed);
+  stats.dirty_writebacks += dirty_writebacks_.load(std::memory_order_relaxed);
+  stats.flushes += flushes_.load(std::memory_order_relaxed);
+  stats.wal_waits += wal_waits_.load(std::memory_order_relaxed);
+  stats.eviction_wal_waits +=
+      eviction_wal_waits_.load(std::memory_order_relaxed);
+  stats.pin_wait_ns += pin_wait_ns_.load(std::memory_order_relaxed);
+  stats.prefetches += prefetches_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < PIN_HISTOGRAM_SIZE; ++i) {
+    stats.pin_count_histogram[i] +=
+        pin_count_histogram_[i].load(std::memory_order_relaxed);
+  }
 }
 
 } // namespace cmudb
@@ -0,0 +1,161 @@
+/**
+ * CLOCK implementation
+ */
+#include "buffer/clock_replacer.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template <typename T> ClockReplacer<T>::ClockReplacer() : hand_(0), size_(0) {}
+
+template <typename T> ClockReplacer<T>::~ClockReplacer() = default;
+
+/*
+ * Mark value as evictable and recently used
+ */
+template <typename T> void ClockReplacer<T>::Insert(const T &value) {
+  // the slot is not released while a lock is held
+  index_latch_.RLock();
+  auto it = index_.find(value);
+  if (it != index_.end()) {
+    slot &s = slots_[it->second];
+    s.ref.store(true, std::memory_order_relaxed);
+    if (!s.evictable.exchange(true)) {
+      ++size_;
+    }
+    index_latch_.RUnlock();
+    return;
+  }
+  index_latch_.RUnlock();
+
+  index_latch_.WLock();
+  it = index_.find(value);
+  slot &s = slots_[it == index_.end() ? NewSlot(value) : it->second];
+  s.ref.store(true, std::memory_order_relaxed);
+  if (!s.evictable.exchange(true)) {
+    ++size_;
+  }
+  index_latch_.WUnlock();
+}
+
+/* Sweep the hand until an evictable slot with a clear reference bit is found,
+ * clearing reference bits on the way and skipping free slots. Two full rounds
+ * are always enough unless values are erased concurrently. The slot of the
+ * victim is released. If nothing is evictable, return false
+ */
+template <typename T> bool ClockReplacer<T>::Victim(T &value) {
+  std::lock_guard<std::mutex> lock(hand_latch_);
+  index_latch_.RLock();
+
+  size_t n = slots_.size();
+  for (size_t i = 0; i < 2 * n && size_.load() > 0; ++i) {
+    slot &s = slots_[hand_];
+    hand_ = (hand_ + 1) % n;
+    if (!s.evictable.load()) {
+      continue;
+    }
+    if (s.ref.exchange(false)) {
+      // second chance
+      continue;
+    }
+    if (s.evictable.exchange(false)) {
+      --size_;
+      value = s.data;
+      index_latch_.RUnlock();
+
+      // unless inserted again meanwhile
+      index_latch_.WLock();
+      auto it = index_.find(value);
+      if (it != index_.end() && !slots_[it->second].evictable.load()) {
+        ReleaseSlot(it->second);
+      }
+      index_latch_.WUnlock();
+      return true;
+    }
+  }
+
+  index_latch_.RUnlock();
+  return false;
+}
+
+/*
+ * Remove value from the replacer and release its slot. If removal is
+ * successful, return true, otherwise return false
+ */
+template <typename T> bool ClockReplacer<T>::Erase(const T &value) {
+  index_latch_.RLock();
+  bool found = index_.find(value) != index_.end();
+  index_latch_.RUnlock();
+  if (!found) {
+    return false;
+  }
+
+  bool erased = false;
+  index_latch_.WLock();
+  auto it = index_.find(value);
+  if (it != index_.end()) {
+    erased = slots_[it->second].evictable.exchange(false);
+    if (erased) {
+      --size_;
+    }
+    ReleaseSlot(it->second);
+  }
+  index_latch_.WUnlock();
+  return erased;
+}
+
+template <typename T> size_t ClockReplacer<T>::Size() { return size_.load(); }
+
+/*
+ * Walk one round from the hand without touching reference bits: evictable
+ * slots with a clear reference bit go first, the others would only be taken
+ * by the next round
+ */
+template <typename T>
+size_t ClockReplacer<T>::PeekVictims(std::vector<T> &values, size_t max) {
+  std::lock_guard<std::mutex> lock(hand_latch_);
+  index_latch_.RLock();
+
+  size_t n = slots_.size();
+  size_t count = 0;
+  for (int round = 0; round < 2; ++round) {
+    for (size_t i = 0; i < n && count < max; ++i) {
+      slot &s = slots_[(hand_ + i) % n];
+      if (s.evictable.load() && s.ref.load() == (round == 1)) {
+        values.push_back(s.data);
+        ++count;
+      }
+    }
+  }
+
+  index_latch_.RUnlock();
+  return count;
+}
+
+template <typename T> size_t ClockReplacer<T>::NewSlot(const T &value) {
+  size_t pos;
+  if (!free_slots_.empty()) {
+    pos = free_slots_.back();
+    free_slots_.pop_back();
+    slots_[pos].data = value;
+  } else {
+    pos = slots_.size();
+    slots_.emplace_back(value);
+  }
+  index_.emplace(value, pos);
+  return pos;
+}
+
+template <typename T> void ClockReplacer<T>::ReleaseSlot(size_t pos) {
+  slot &s = slots_[pos];
+  s.evictable.store(false);
+  s.ref.store(false, std::memory_order_relaxed);
+  index_.erase(s.data);
+  free_slots_.push_back(pos);
+}
+
+template class ClockReplacer<Page *>;
+// test only
+template class ClockReplacer<int>;
+
+} // namespace cmudb
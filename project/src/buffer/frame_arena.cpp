@@ -0,0 +1,93 @@
+/**
+ * frame_arena.cpp
+ */
+
+#include <sys/mman.h>
+
+#include "buffer/frame_arena.h"
+#include "common/logger.h"
+
+namespace cmudb {
+
+FrameArena::FrameArena(bool huge_pages)
+    : huge_pages_(huge_pages), reserved_bytes_(0), hugetlb_(false) {}
+
+FrameArena::~FrameArena() {
+  for (auto &chunk : chunks_) {
+    munmap(chunk.memory, chunk.size);
+  }
+}
+
+/*
+ * Map one chunk for the frames missing. MAP_HUGETLB fails if no huge page is
+ * reserved, the chunk is then mapped with normal pages and left to
+ * transparent huge pages
+ */
+bool FrameArena::Reserve(size_t num_frames) {
+  std::lock_guard<std::mutex> lock(latch_);
+  if (free_frames_.size() >= num_frames) {
+    return true;
+  }
+  size_t size = (num_frames - free_frames_.size()) * PAGE_SIZE;
+  void *memory = MAP_FAILED;
+  if (huge_pages_) {
+    size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (memory != MAP_FAILED) {
+      hugetlb_ = true;
+    }
+  }
+  if (memory == MAP_FAILED) {
+    memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+      LOG_DEBUG("can't map %zu bytes of frames", size);
+      return false;
+    }
+    if (huge_pages_) {
+      madvise(memory, size, MADV_HUGEPAGE);
+    }
+  }
+
+  char *chunk = static_cast<char *>(memory);
+  chunks_.push_back({chunk, size});
+  reserved_bytes_ += size;
+  // lower addresses are handed out first
+  for (size_t offset = size; offset > 0; offset -= PAGE_SIZE) {
+    free_frames_.push_back(chunk + offset - PAGE_SIZE);
+  }
+  return true;
+}
+
+char *FrameArena::Allocate() {
+  std::lock_guard<std::mutex> lock(latch_);
+  if (free_frames_.empty()) {
+    return nullptr;
+  }
+  char *frame = free_frames_.back();
+  free_frames_.pop_back();
+  return frame;
+}
+
+void FrameArena::Free(char *frame) {
+  std::lock_guard<std::mutex> lock(latch_);
+  free_frames_.push_back(frame);
+}
+
+size_t FrameArena::GetReservedBytes() const {
+  std::lock_guard<std::mutex> lock(latch_);
+  return reserved_bytes_;
+}
+
+size_t FrameArena::GetNumFreeFrames() const {
+  std::lock_guard<std::mutex> lock(latch_);
+  return free_frames_.size();
+}
+
+bool FrameArena::UsesHugePages() const {
+  std::lock_guard<std::mutex> lock(latch_);
+  return hugetlb_;
+}
+
+} // namespace cmudb
@@ -0,0 +1,185 @@
+/**
+ * LRU-K implementation
+ */
+#include <algorithm>
+#include <cassert>
+
+#include "buffer/lru_k_replacer.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template <typename T>
+LRUKReplacer<T>::LRUKReplacer(size_t k, uint64_t correlated_period)
+    : k_(k == 0 ? 1 : k), correlated_period_(correlated_period), current_(0),
+      size_(0) {}
+
+template <typename T> LRUKReplacer<T>::~LRUKReplacer() = default;
+
+/*
+ * Mark value as evictable
+ */
+template <typename T> void LRUKReplacer<T>::Insert(const T &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  entry &e = table_[value];
+  if (e.history.empty()) {
+    Access(e);
+  }
+  if (!e.evictable) {
+    e.evictable = true;
+    ++size_;
+  }
+}
+
+/* Evict the evictable value with the largest backward K-distance, values with
+ * less than K accesses first. The history of the victim is dropped. If no
+ * value is evictable, return false
+ */
+template <typename T> bool LRUKReplacer<T>::Victim(T &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (size_ == 0) {
+    return false;
+  }
+
+  auto victim = table_.end();
+  for (auto it = table_.begin(); it != table_.end(); ++it) {
+    if (it->second.evictable &&
+        (victim == table_.end() || Before(it->second, victim->second))) {
+      victim = it;
+    }
+  }
+  assert(victim != table_.end());
+
+  value = victim->first;
+  table_.erase(victim);
+  --size_;
+  return true;
+}
+
+/*
+ * Remove value from the replacer, its history is kept. If removal is
+ * successful, return true, otherwise return false
+ */
+template <typename T> bool LRUKReplacer<T>::Erase(const T &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = table_.find(value);
+  if (it != table_.end() && it->second.evictable) {
+    it->second.evictable = false;
+    --size_;
+    return true;
+  }
+  return false;
+}
+
+template <typename T> size_t LRUKReplacer<T>::Size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return size_;
+}
+
+/*
+ * Record an access of value, which now holds page_id
+ */
+template <typename T>
+void LRUKReplacer<T>::RecordAccess(const T &value, page_id_t page_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  entry &e = table_[value];
+  if (e.page_id != page_id) {
+    // another page in the same frame, start over
+    e.page_id = page_id;
+    e.history.clear();
+  }
+  Access(e);
+}
+
+/*
+ * Sort the evictable values by eviction order
+ */
+template <typename T>
+size_t LRUKReplacer<T>::PeekVictims(std::vector<T> &values, size_t max) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::vector<std::pair<const T *, const entry *>> candidates;
+  for (auto &item : table_) {
+    if (item.second.evictable) {
+      candidates.emplace_back(&item.first, &item.second);
+    }
+  }
+  size_t count = std::min(max, candidates.size());
+  std::partial_sort(candidates.begin(), candidates.begin() + count,
+                    candidates.end(),
+                    [this](const std::pair<const T *, const entry *> &a,
+                           const std::pair<const T *, const entry *> &b) {
+                      return Before(*a.second, *b.second);
+                    });
+  for (size_t i = 0; i < count; ++i) {
+    values.push_back(*candidates[i].first);
+  }
+  return count;
+}
+
+/*
+ * Evict value like Victim would, its history is dropped
+ */
+template <typename T> bool LRUKReplacer<T>::Evict(const T &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = table_.find(value);
+  if (it == table_.end() || !it->second.evictable) {
+    return false;
+  }
+  table_.erase(it);
+  --size_;
+  return true;
+}
+
+/*
+ * Drop value together with its history
+ */
+template <typename T> void LRUKReplacer<T>::Discard(const T &value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = table_.find(value);
+  if (it != table_.end()) {
+    if (it->second.evictable) {
+      --size_;
+    }
+    table_.erase(it);
+  }
+}
+
+/*
+ * back() is the K-th most recent access, or the first access if the distance
+ * is infinite. Infinite distance goes first, then the older back()
+ */
+template <typename T>
+bool LRUKReplacer<T>::Before(const entry &a, const entry &b) const {
+  bool a_infinite = a.history.size() < k_;
+  bool b_infinite = b.history.size() < k_;
+  if (a_infinite != b_infinite) {
+    return a_infinite;
+  }
+  return a.history.back() < b.history.back();
+}
+
+template <typename T> void LRUKReplacer<T>::Access(entry &e) {
+  ++current_;
+  if (!e.history.empty() &&
+      current_ - e.history.front() <= correlated_period_) {
+    e.history.front() = current_;
+    return;
+  }
+  e.history.push_front(current_);
+  if (e.history.size() > k_) {
+    e.history.pop_back();
+  }
+}
+
+template class LRUKReplacer<Page *>;
+// test only
+template class LRUKReplacer<int>;
+
+} // namespace cmudb
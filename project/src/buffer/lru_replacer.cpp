@@ -103,6 +103,22 @@ template <typename T> size_t LRUReplacer<T>::Size() {
   return size_;
 }
 
+/*
+ * Walk from the head (least recently used) of LRU
+ */
+template <typename T>
+size_t LRUReplacer<T>::PeekVictims(std::vector<T> &values, size_t max) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  size_t count = 0;
+  for (node *cur = head_->next.get(); cur != nullptr && count < max;
+       cur = cur->next.get()) {
+    values.push_back(cur->data);
+    ++count;
+  }
+  return count;
+}
+
 // for debug: should be called when holding the lock
 template <typename T> void LRUReplacer<T>::check() {
   node *pointer = head_.get();
@@ -0,0 +1,76 @@
+/**
+ * page_guard.cpp
+ */
+
+#include "buffer/page_guard.h"
+#include "buffer/buffer_pool_manager.h"
+
+namespace cmudb {
+
+ReadPageGuard::ReadPageGuard(BufferPoolManager *buffer_pool_manager,
+                             Page *page)
+    : buffer_pool_manager_(buffer_pool_manager), page_(page) {}
+
+ReadPageGuard::ReadPageGuard(ReadPageGuard &&other) noexcept
+    : buffer_pool_manager_(other.buffer_pool_manager_), page_(other.page_) {
+  other.page_ = nullptr;
+}
+
+/*
+ * other's page is latched already, so moving a child guard into its parent's
+ * releases the parent after the child is latched, as latch crabbing needs
+ */
+ReadPageGuard &ReadPageGuard::operator=(ReadPageGuard &&other) noexcept {
+  if (this != &other) {
+    Release();
+    buffer_pool_manager_ = other.buffer_pool_manager_;
+    page_ = other.page_;
+    other.page_ = nullptr;
+  }
+  return *this;
+}
+
+void ReadPageGuard::Release() {
+  if (page_ != nullptr) {
+    page_id_t page_id = page_->GetPageId();
+    page_->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_ = nullptr;
+  }
+}
+
+WritePageGuard::WritePageGuard(BufferPoolManager *buffer_pool_manager,
+                               Page *page)
+    : buffer_pool_manager_(buffer_pool_manager), page_(page),
+      is_dirty_(false) {}
+
+WritePageGuard::WritePageGuard(WritePageGuard &&other) noexcept
+    : buffer_pool_manager_(other.buffer_pool_manager_), page_(other.page_),
+      is_dirty_(other.is_dirty_) {
+  other.page_ = nullptr;
+  other.is_dirty_ = false;
+}
+
+WritePageGuard &WritePageGuard::operator=(WritePageGuard &&other) noexcept {
+  if (this != &other) {
+    Release();
+    buffer_pool_manager_ = other.buffer_pool_manager_;
+    page_ = other.page_;
+    is_dirty_ = other.is_dirty_;
+    other.page_ = nullptr;
+    other.is_dirty_ = false;
+  }
+  return *this;
+}
+
+void WritePageGuard::Release() {
+  if (page_ != nullptr) {
+    page_id_t page_id = page_->GetPageId();
+    page_->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, is_dirty_);
+    page_ = nullptr;
+    is_dirty_ = false;
+  }
+}
+
+} // namespace cmudb
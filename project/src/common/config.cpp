@@ -4,4 +4,10 @@ namespace cmudb {
   std::atomic<bool> ENABLE_LOGGING(false);  // for virtual table
   std::chrono::duration<long long int> LOG_TIMEOUT =
    std::chrono::seconds(1);
+  // how often the buffer pool page cleaner wakes up
+  std::chrono::milliseconds CLEANER_TIMEOUT = std::chrono::milliseconds(10);
+  // number of pages scans keep in flight ahead of them, 0 to disable
+  std::atomic<size_t> PREFETCH_WINDOW(4);
+  // back the frames of the buffer pools created from now on by huge pages
+  std::atomic<bool> ENABLE_HUGE_PAGES(false);
 }
@@ -0,0 +1,79 @@
+/**
+ * crc32c.cpp
+ */
+
+#include <cstring>
+
+#include "disk/crc32c.h"
+
+namespace cmudb {
+
+namespace {
+
+// reversed Castagnoli polynomial
+const uint32_t POLYNOMIAL = 0x82f63b78;
+
+struct Table {
+  uint32_t entries[256];
+  Table() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ (crc & 1 ? POLYNOMIAL : 0);
+      }
+      entries[i] = crc;
+    }
+  }
+};
+
+const Table table;
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) uint32_t
+HardwareCRC(const char *data, size_t size) {
+  uint64_t crc = 0xffffffff;
+  for (; size >= 8; size -= 8, data += 8) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc = __builtin_ia32_crc32di(crc, word);
+  }
+  uint32_t crc32 = static_cast<uint32_t>(crc);
+  for (; size > 0; --size, ++data) {
+    crc32 = __builtin_ia32_crc32qi(crc32, static_cast<uint8_t>(*data));
+  }
+  return ~crc32;
+}
+
+bool DetectHardware() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2");
+}
+
+const bool has_hardware = DetectHardware();
+#else
+const bool has_hardware = false;
+#endif
+
+} // namespace
+
+uint32_t CRC32C::Compute(const char *data, size_t size) {
+#if defined(__x86_64__)
+  if (has_hardware) {
+    return HardwareCRC(data, size);
+  }
+#endif
+  return ComputeWithTable(data, size);
+}
+
+uint32_t CRC32C::ComputeWithTable(const char *data, size_t size) {
+  uint32_t crc = 0xffffffff;
+  for (size_t i = 0; i < size; ++i) {
+    crc = (crc >> 8) ^
+          table.entries[(crc ^ static_cast<uint8_t>(data[i])) & 0xff];
+  }
+  return ~crc;
+}
+
+bool CRC32C::HasHardware() { return has_hardware; }
+
+} // namespace cmudb
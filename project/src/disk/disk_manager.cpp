@@ -7,98 +7,467 @@
  * system.
  */
 
+#include <algorithm>
 #include <assert.h>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <thread>
+#include <unistd.h>
 
+#include "common/exception.h"
 #include "common/logger.h"
+#include "disk/crc32c.h"
 #include "disk/disk_manager.h"
+#include "disk/lz_codec.h"
 
 namespace cmudb {
 
 static char *buffer_used = nullptr;
 
+// first page of the db file
+struct FileHeader {
+  uint32_t magic;
+  uint32_t pages_per_map;
+  page_id_t next_page_id;
+  uint32_t flags;         // 0 in files written before there were any
+  uint32_t segment_pages; // pages of a segment file, 0 if a single file
+  uint32_t unused;
+  int64_t synced_size; // bytes of the db when written, 0 in older files
+};
+static const uint32_t FILE_MAGIC = 0x31554d43; // "CMU1"
+static const uint32_t FILE_COMPRESSED = 1;     // pages are in slots
+static const uint32_t FILE_CHECKSUMS = 2;      // pages end with a checksum
+
+static const uint32_t SECTORS_PER_PAGE = PAGE_SIZE / SECTOR_SIZE;
+
+static_assert(PAGE_CHECKSUM_SIZE == sizeof(uint32_t),
+              "the page checksum is a CRC32C");
+
+static inline uint32_t SectorsOf(uint32_t size) {
+  return (size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+}
+
+// the sector belongs to the file header or a map page
+static inline bool IsMapSector(uint32_t sector) {
+  uint32_t block = sector / SECTORS_PER_PAGE;
+  return block == 0 || (block - 1) % (PAGES_PER_MAP + 1) == 0;
+}
+
+static inline uint64_t ElapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// direct I/O wants buffers aligned to the logical block size, a page is
+static inline bool IsAligned(const char *data) {
+  return reinterpret_cast<uintptr_t>(data) % PAGE_SIZE == 0;
+}
+
+// an aligned copy for a buffer which is not
+static inline std::shared_ptr<char> NewAlignedBuffer(size_t size) {
+  char *data = static_cast<char *>(aligned_alloc(PAGE_SIZE, size));
+  if (data == nullptr) {
+    throw std::bad_alloc();
+  }
+  return std::shared_ptr<char>(data, free);
+}
+
+// an extent is a whole number of map bytes and never spans two map pages
+static_assert(EXTENT_SIZE % 8 == 0 && PAGES_PER_MAP % EXTENT_SIZE == 0,
+              "extents must be aligned to the map");
+
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
+ * @input read_only: open existing files without writing them, the db file is
+ * mapped into memory
+ * @input compress: create the db file with compressed pages, which are kept
+ * in the slots listed by the slot table file
+ * @input segment_size: create the db file as segment files of this size
+ * @input direct_io: read and write the db files with O_DIRECT
+ * Throws if db_file is not empty and not a db file, its pages would be looked
+ * for at the wrong offsets and its first page overwritten by the file header.
+ * A file of the legacy layout, without the file header, is opened as it is
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), next_page_id_(0), num_flushes_(0), flush_log_(false),
+DiskManager::DiskManager(const std::string &db_file,
+                         IOEngineType io_engine_type, bool read_only,
+                         bool compress, size_t segment_size, bool direct_io)
+    : log_fd_(-1), log_size_(0), log_segment_size_(LOG_SEGMENT_SIZE),
+      db_fd_(-1), file_name_(db_file), db_size_(0), segment_size_(0),
+      synced_size_(0), legacy_(false), direct_io_(false),
+      read_only_(read_only),
+      mapping_(nullptr), mapping_size_(0), zero_page_(nullptr),
+      compressed_(false), slots_fd_(-1), slots_dirty_(false), slot_writes_(0),
+      slot_syncs_(0), end_sector_(0),
+      pages_written_(0), bytes_in_(0), bytes_out_(0), compress_ns_(0),
+      pages_read_(0), decompress_ns_(0), checksums_(true),
+      checksum_mode_(ChecksumMode::ALWAYS), checksum_reads_(0),
+      checksum_failures_(0), io_engine_type_(io_engine_type),
+      io_engine_(nullptr), first_free_(0),
+      next_page_id_(0), num_flushes_(0), flush_log_(false),
       flush_log_f_(nullptr) {
+  // the log buffers of a previous instance may be reallocated at the same
+  // addresses, the swap check starts over with each disk manager
+  buffer_used = nullptr;
   std::string::size_type n = file_name_.find(".");
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  slots_name_ = file_name_.substr(0, n) + ".slots";
 
-  log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app | std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
+  if (read_only_) {
+    // nothing is created, a missing log is an empty one
+    db_fd_ = open(db_file.c_str(), O_RDONLY);
+    if (db_fd_ == -1) {
+      LOG_DEBUG("can't open file %s", db_file.c_str());
+    }
+  } else {
+    // directory or file does not exist: create a new file
+    db_fd_ = OpenFile(db_file, 0);
   }
-
-  db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
+  segment_fds_.push_back(db_fd_);
+  // only writes change the sizes from now on
+  db_size_ = std::max<int64_t>(GetFileSize(file_name_), 0);
+  bool create = db_size_ == 0;
+  if (!LoadPageMap()) {
+    close(db_fd_);
+    throw Exception("unknown file format of " + db_file);
+  }
+  OpenLog();
+  if (create && (compress || segment_size != 0) && !read_only_ &&
+      db_fd_ != -1) {
+    // the file header tells the format from now on, a slot table or
+    // segments left by an earlier file of the same name are dropped
+    compressed_ = compress;
+    if (segment_size % PAGE_SIZE == 0) {
+      segment_size_ = segment_size;
+      for (size_t i = 1; remove(SegmentName(i).c_str()) == 0; ++i) {
+      }
+    } else {
+      LOG_DEBUG("segment size %zu is not a multiple of pages", segment_size);
+    }
+    std::lock_guard<std::mutex> lock(map_latch_);
+    WritePageMap();
+  }
+  // compressed pages are not whole pages at page offsets
+  if (direct_io && (compressed_ || !EnableDirectIO())) {
+    LOG_DEBUG("no direct I/O for %s", db_file.c_str());
+  }
+  if (compressed_) {
+    slots_fd_ = read_only_ ? open(slots_name_.c_str(), O_RDONLY)
+                           : OpenFile(slots_name_, create ? O_TRUNC : 0);
+    LoadSlotTable();
+  } else if (IsMapped()) {
+    MapFile();
   }
 }
 
 DiskManager::~DiskManager() {
-  db_io_.close();
-  log_io_.close();
+  // waits for the asynchronous I/O in flight
+  delete io_engine_;
+  if (mapping_ != nullptr) {
+    munmap(mapping_, mapping_size_);
+  }
+  if (zero_page_ != nullptr) {
+    munmap(zero_page_, PAGE_SIZE);
+  }
+  if (db_fd_ != -1) {
+    if (compressed_ && !read_only_) {
+      SyncSlotTable();
+    }
+    if (!read_only_) {
+      std::lock_guard<std::mutex> lock(map_latch_);
+      // the ids reserved by extents and not handed out are free again
+      for (size_t i = 0; i < reserved_.size(); ++i) {
+        if (reserved_[i] != 0) {
+          map_dirty_[i / PAGE_SIZE] = true;
+          reserved_[i] = 0;
+        }
+      }
+      WritePageMap();
+    }
+    close(db_fd_);
+  }
+  for (size_t i = 1; i < segment_fds_.size(); ++i) {
+    if (segment_fds_[i] != -1) {
+      close(segment_fds_[i]);
+    }
+  }
+  if (slots_fd_ != -1) {
+    close(slots_fd_);
+  }
+  for (auto &segment : log_segments_) {
+    close(segment.fd);
+  }
 }
 
 /**
  * Write the contents of the specified page into disk file
+ * Not durable until the next SyncPages
  */
-void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  size_t offset = page_id*PAGE_SIZE;
-  // set write cursor to offset
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
+bool DiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  if (RejectWrite("page write")) {
+    return false;
+  }
+  if (compressed_) {
+    return WriteCompressedPage(page_id, page_data);
+  }
+  // the page of the caller is left as it is
+  alignas(PAGE_SIZE) char buffer[PAGE_SIZE];
+  memcpy(buffer, page_data, PAGE_SIZE);
+  if (checksums_) {
+    SetChecksum(buffer);
+  }
+  off_t offset = PageOffset(page_id);
   // check for I/O error
-  if (db_io_.bad()) {
+  if (!CompleteDbIO(true, buffer, PAGE_SIZE, offset)) {
     LOG_DEBUG("I/O error while writing");
-    return;
+    return false;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+  GrowTo(offset + PAGE_SIZE);
+  return true;
 }
 
 /**
  * Read the contents of the specified page into the given memory area
+ * false if the page read is corrupted
  */
-void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  int offset = page_id*PAGE_SIZE;
-  // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
-    LOG_DEBUG("I/O error while reading");
-    // std::cerr << "I/O error while reading" << std::endl;
-  } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+bool DiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  if (compressed_) {
+    return ReadCompressedPage(page_id, page_data);
+  }
+  bool read;
+  return ReadRun(page_id, 1, &page_data, &read) &&
+         VerifyChecksum(page_id, page_data);
+}
+
+/**
+ * Scatter consecutive pages into their buffers, one system call for each run
+ * of pages between two map pages or segments. Compressed pages are not
+ * adjacent in the file, they are read one by one
+ */
+bool DiskManager::ReadPages(page_id_t first_page_id, size_t count,
+                            char **buffers, bool *valid) {
+  bool all_valid = true;
+  if (compressed_) {
+    for (size_t i = 0; i < count; ++i) {
+      bool ok = ReadCompressedPage(first_page_id + static_cast<page_id_t>(i),
+                                   buffers[i]);
+      if (valid != nullptr) {
+        valid[i] = ok;
+      }
+      all_valid = all_valid && ok;
     }
+    return all_valid;
+  }
+  std::unique_ptr<bool[]> read(new bool[count]);
+  size_t i = 0;
+  while (i < count) {
+    page_id_t page_id = first_page_id + static_cast<page_id_t>(i);
+    size_t run = std::min<size_t>(count - i,
+                                  PAGES_PER_MAP - page_id % PAGES_PER_MAP);
+    if (segment_size_ != 0) {
+      off_t left = segment_size_ - PageOffset(page_id) % segment_size_;
+      run = std::min<size_t>(run, left / PAGE_SIZE);
+    }
+    ReadRun(page_id, run, buffers + i, read.get() + i);
+    for (size_t j = 0; j < run; ++j) {
+      bool ok = read[i + j] &&
+                VerifyChecksum(page_id + static_cast<page_id_t>(j),
+                               buffers[i + j]);
+      if (valid != nullptr) {
+        valid[i + j] = ok;
+      }
+      all_valid = all_valid && ok;
+    }
+    i += run;
+  }
+  return all_valid;
+}
+
+/**
+ * Force the pages written so far to disk, with the page allocations. fdatasync
+ * skips the metadata which is not needed to read the data back, e.g. the
+ * modification time
+ */
+void DiskManager::SyncPages() {
+  if (read_only_) {
+    return;
+  }
+  if (compressed_) {
+    SyncSlotTable();
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(map_latch_);
+    WritePageMap();
+  }
+  if (!SyncSegments()) {
+    LOG_DEBUG("I/O error while syncing");
+  }
+}
+
+/**
+ * Hand a batch of page reads and writes over to the I/O engine, one system
+ * call for all of them with io_uring. A page past the end of the file reads as
+ * zeros, like ReadPage. Writes are not durable until the next SyncPages.
+ * Compressed pages go through the codec and their slots, they are done on the
+ * calling thread before it returns
+ */
+void DiskManager::SubmitPageIO(std::vector<PageIORequest> &requests) {
+  if (compressed_) {
+    for (auto &request : requests) {
+      if (request.is_write && RejectWrite("page write")) {
+        request.callback(false);
+      } else if (request.is_write) {
+        request.callback(WriteCompressedPage(request.page_id, request.data));
+      } else {
+        request.callback(ReadCompressedPage(request.page_id, request.data));
+      }
+    }
+    return;
+  }
+  std::vector<IORequest> batch;
+  batch.reserve(requests.size());
+  for (auto &request : requests) {
+    off_t offset = PageOffset(request.page_id);
+    std::function<void(bool)> callback = std::move(request.callback);
+    if (request.is_write && RejectWrite("page write")) {
+      callback(false);
+      continue;
+    }
+    if (request.is_write) {
+      if (checksums_) {
+        SetChecksum(request.data);
+      }
+      // the file size is known to grow once the write is done
+      callback = [this, offset, callback](bool ok) {
+        if (ok) {
+          GrowTo(offset + PAGE_SIZE);
+        }
+        callback(ok);
+      };
+    } else {
+      page_id_t page_id = request.page_id;
+      char *data = request.data;
+      // the engine reads zeros past the end of file, see ReadRun
+      callback = [this, page_id, offset, data, callback](bool ok) {
+        if (ok && offset + PAGE_SIZE > db_size_) {
+          ok = offset >= db_size_ && NeverWritten(page_id);
+        }
+        callback(ok && VerifyChecksum(page_id, data));
+      };
+    }
+    off_t local;
+    size_t left;
+    int fd = SegmentFd(offset, request.is_write, &local, &left);
+    if (fd == -1) {
+      // a read of a missing segment, or a segment not created
+      if (!request.is_write) {
+        memset(request.data, 0, PAGE_SIZE);
+      }
+      callback(!request.is_write && NeverWritten(request.page_id));
+      continue;
+    }
+    char *data = request.data;
+    if (direct_io_ && !IsAligned(data)) {
+      // the copy lives until the request is done
+      std::shared_ptr<char> copy = NewAlignedBuffer(PAGE_SIZE);
+      bool is_write = request.is_write;
+      if (is_write) {
+        memcpy(copy.get(), data, PAGE_SIZE);
+      }
+      callback = [copy, data, is_write, callback](bool ok) {
+        if (!is_write) {
+          memcpy(data, copy.get(), PAGE_SIZE);
+        }
+        callback(ok);
+      };
+      data = copy.get();
+    }
+    batch.push_back({request.is_write, fd, data, PAGE_SIZE, local,
+                     std::move(callback)});
+  }
+  GetIOEngine()->Submit(batch);
+}
+
+std::future<bool> DiskManager::ReadPageAsync(page_id_t page_id,
+                                             char *page_data) {
+  auto promise = std::make_shared<std::promise<bool>>();
+  std::vector<PageIORequest> requests{
+      {false, page_id, page_data,
+       [promise](bool ok) { promise->set_value(ok); }}};
+  SubmitPageIO(requests);
+  return promise->get_future();
+}
+
+std::future<bool> DiskManager::WritePageAsync(page_id_t page_id,
+                                              char *page_data) {
+  auto promise = std::make_shared<std::promise<bool>>();
+  std::vector<PageIORequest> requests{
+      {true, page_id, page_data,
+       [promise](bool ok) { promise->set_value(ok); }}};
+  SubmitPageIO(requests);
+  return promise->get_future();
+}
+
+IOEngineType DiskManager::GetIOEngineType() {
+  return GetIOEngine()->GetType();
+}
+
+CompressionStats DiskManager::GetCompressionStats() const {
+  CompressionStats stats;
+  stats.pages_written = pages_written_;
+  stats.bytes_in = bytes_in_;
+  stats.bytes_out = bytes_out_;
+  stats.compress_ns = compress_ns_;
+  stats.pages_read = pages_read_;
+  stats.decompress_ns = decompress_ns_;
+  return stats;
+}
+
+/**
+ * The kernel reads the page on first access, straight into the page cache.
+ * Nothing is copied, and the mapping is read only, so writing the page faults
+ */
+char *DiskManager::GetMappedPage(page_id_t page_id) {
+  off_t offset = PageOffset(page_id);
+  if (mapping_ == nullptr ||
+      offset + PAGE_SIZE > static_cast<off_t>(mapping_size_)) {
+    return IsAllocated(page_id) ? zero_page_ : nullptr;
+  }
+  if (!VerifyChecksum(page_id, mapping_ + offset)) {
+    return nullptr;
+  }
+  return mapping_ + offset;
+}
+
+void DiskManager::PrefetchMappedPages(page_id_t page_id, size_t num_pages) {
+  if (mapping_ == nullptr || num_pages == 0) {
+    return;
+  }
+  off_t begin = PageOffset(page_id);
+  off_t end = PageOffset(page_id + num_pages - 1) + PAGE_SIZE;
+  end = std::min(end, static_cast<off_t>(mapping_size_));
+  if (begin < end &&
+      madvise(mapping_ + begin, end - begin, MADV_WILLNEED) != 0) {
+    LOG_DEBUG("madvise failed: %s", strerror(errno));
   }
 }
 
@@ -107,6 +476,9 @@ void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
  * Only return when sync is done, and only perform sequence write
  */
 void DiskManager::WriteLog(char *log_data, int size) {
+  if (RejectWrite("log write")) {
+    return;
+  }
   // enforce swap log buffer
   assert(log_data != buffer_used);
   buffer_used = log_data;
@@ -122,54 +494,241 @@ void DiskManager::WriteLog(char *log_data, int size) {
         std::future_status::ready);
 
   num_flushes_ += 1;
+  int64_t limit = log_segment_size_;
+  if (limit > 0) {
+    std::lock_guard<std::mutex> lock(log_latch_);
+    if (!log_segments_.empty() &&
+        log_size_ - log_segments_.back().start >= limit) {
+      // roll over, the log offsets go on where the last file ended
+      int64_t start = log_size_;
+      int fd = OpenFile(LogSegmentName(start), O_APPEND | O_TRUNC);
+      if (fd != -1) {
+        log_segments_.push_back({start, fd});
+        log_fd_ = fd;
+      }
+    }
+  }
   // sequence write
-  log_io_.write(log_data, size);
-
-  // check for I/O error
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while writing log");
+  int written = 0;
+  while (written < size) {
+    ssize_t rc = write(log_fd_, log_data + written, size - written);
+    // check for I/O error
+    if (rc < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_DEBUG("I/O error while writing log");
+      return;
+    }
+    written += rc;
+  }
+  log_size_ += size;
+  // the commits waiting for this flush are durable once it returns
+  if (fdatasync(log_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing log");
     return;
   }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
   flush_log_ = false;
 }
 
 /**
  * Read the contents of the log into the given memory area
- * Always read from the beginning and perform sequence read
+ * Always read from the beginning and perform sequence read, from one log file
+ * into the next
  * @return: false means already reach the end
  */
-bool DiskManager::ReadLog(char *log_data, int size, int offset) {
-  if (offset >= GetFileSize(log_name_)) {
+bool DiskManager::ReadLog(char *log_data, int size, int64_t offset) {
+  if (offset >= log_size_) {
     LOG_DEBUG("end of log file");
-    LOG_DEBUG("file size is %d", GetFileSize(log_name_));
+    LOG_DEBUG("file size is %lld", (long long)log_size_);
     return false;
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
+  std::lock_guard<std::mutex> lock(log_latch_);
+  int read_count = 0;
+  while (read_count < size) {
+    int64_t position = offset + read_count;
+    // the last file starting at or before position
+    auto next = std::upper_bound(
+        log_segments_.begin(), log_segments_.end(), position,
+        [](int64_t pos, const LogSegment &segment) {
+          return pos < segment.start;
+        });
+    if (next == log_segments_.begin()) {
+      LOG_DEBUG("log offset %lld was discarded", (long long)position);
+      break;
+    }
+    auto segment = next - 1;
+    int64_t end = next == log_segments_.end() ? log_size_.load() : next->start;
+    if (position >= end) {
+      break;
+    }
+    ssize_t rc = pread(segment->fd, log_data + read_count,
+                       std::min<int64_t>(size - read_count, end - position),
+                       position - segment->start);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc <= 0) {
+      break;
+    }
+    read_count += rc;
+  }
   // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
   if (read_count < size) {
-    log_io_.clear();
     memset(log_data + read_count, 0, size - read_count);
   }
 
   return true;
 }
 
+int64_t DiskManager::GetLogStart() {
+  std::lock_guard<std::mutex> lock(log_latch_);
+  return log_segments_.empty() ? log_size_.load() : log_segments_[0].start;
+}
+
+/**
+ * The offsets of the log do not change, reading before the first file kept
+ * finds nothing
+ */
+int DiskManager::DiscardLog(int64_t offset) {
+  if (RejectWrite("log discard")) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(log_latch_);
+  int discarded = 0;
+  while (log_segments_.size() > 1 && log_segments_[1].start <= offset) {
+    close(log_segments_[0].fd);
+    std::string name = LogSegmentName(log_segments_[0].start);
+    if (unlink(name.c_str()) != 0) {
+      LOG_DEBUG("can't unlink log file %s", name.c_str());
+    }
+    log_segments_.erase(log_segments_.begin());
+    ++discarded;
+  }
+  return discarded;
+}
+
 /**
  * Allocate new page (operations like create index/table)
- * For now just keep an increasing counter
+ * Pages of a table or index come from its extent, so they are next to each
+ * other in the file. Others take the lowest free page id
  */
-page_id_t DiskManager::AllocatePage() { return next_page_id_++; }
+page_id_t DiskManager::AllocatePage(Extent *extent) {
+  if (RejectWrite("page allocation")) {
+    return INVALID_PAGE_ID;
+  }
+  std::lock_guard<std::mutex> lock(map_latch_);
+  page_id_t page_id;
+  if (extent == nullptr) {
+    page_id = FindFreePage();
+  } else {
+    if (extent->next_page_id == extent->end_page_id) {
+      ReserveExtent(extent);
+    }
+    page_id = extent->next_page_id++;
+    reserved_[page_id / 8] &= ~(1 << (page_id % 8));
+  }
+  page_map_[page_id / 8] |= 1 << (page_id % 8);
+  map_dirty_[page_id / PAGES_PER_MAP] = true;
+  return page_id;
+}
+
+void DiskManager::ReleaseExtent(Extent *extent) {
+  std::lock_guard<std::mutex> lock(map_latch_);
+  for (page_id_t page_id = extent->next_page_id;
+       page_id != extent->end_page_id; ++page_id) {
+    reserved_[page_id / 8] &= ~(1 << (page_id % 8));
+    map_dirty_[page_id / PAGES_PER_MAP] = true;
+  }
+  if (extent->next_page_id != extent->end_page_id) {
+    first_free_ = std::min(first_free_, extent->next_page_id);
+  }
+  extent->next_page_id = extent->end_page_id = INVALID_PAGE_ID;
+}
 
 /**
  * Deallocate page (operations like drop index/table)
- * Need bitmap in header page for tracking pages
+ * The page id is free for reuse, the file does not shrink until Truncate
+ */
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  if (RejectWrite("page deallocation")) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(map_latch_);
+  if (page_id < 0 || page_id >= next_page_id_ ||
+      !(page_map_[page_id / 8] & (1 << (page_id % 8)))) {
+    LOG_DEBUG("deallocate page %d which is not allocated", page_id);
+    return;
+  }
+  page_map_[page_id / 8] &= ~(1 << (page_id % 8));
+  map_dirty_[page_id / PAGES_PER_MAP] = true;
+  first_free_ = std::min(first_free_, page_id);
+  if (compressed_) {
+    std::lock_guard<std::mutex> slot_lock(slot_latch_);
+    ReleaseSlot(page_id);
+  }
+}
+
+void DiskManager::ReservePage(page_id_t page_id) {
+  if (RejectWrite("page allocation")) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(map_latch_);
+  GrowPageMap(page_id + 1);
+  page_map_[page_id / 8] |= 1 << (page_id % 8);
+  map_dirty_[page_id / PAGES_PER_MAP] = true;
+}
+
+bool DiskManager::IsAllocated(page_id_t page_id) {
+  std::lock_guard<std::mutex> lock(map_latch_);
+  return page_id >= 0 && page_id < next_page_id_ &&
+         (page_map_[page_id / 8] & (1 << (page_id % 8)));
+}
+
+/**
+ * Free page ids at the end are forgotten, and so are the map pages which do
+ * not track any page any more. The file is cut after the last allocated page,
+ * unless it is compressed: its pages are not in page id order. The segments
+ * left without any page in use are unlinked
  */
-void DiskManager::DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-  return;
+page_id_t DiskManager::Truncate() {
+  std::lock_guard<std::mutex> lock(map_latch_);
+  if (RejectWrite("truncate")) {
+    return next_page_id_;
+  }
+  while (next_page_id_ > 0 &&
+         !((page_map_[(next_page_id_ - 1) / 8] |
+            reserved_[(next_page_id_ - 1) / 8]) &
+           (1 << ((next_page_id_ - 1) % 8)))) {
+    --next_page_id_;
+  }
+  first_free_ = std::min(first_free_, next_page_id_);
+  size_t num_maps = (next_page_id_ + PAGES_PER_MAP - 1) / PAGES_PER_MAP;
+  page_map_.resize(num_maps * PAGE_SIZE);
+  reserved_.resize(num_maps * PAGE_SIZE);
+  map_dirty_.resize(num_maps);
+
+  // the file header is kept
+  int64_t end = legacy_ ? 0 : PAGE_SIZE;
+  if (next_page_id_ != 0) {
+    end = PageOffset(next_page_id_ - 1) + PAGE_SIZE;
+  }
+  if (!compressed_ && segment_size_ != 0) {
+    TruncateSegments(end);
+  } else if (!compressed_ && end < db_size_) {
+    if (ftruncate(db_fd_, end) != 0) {
+      LOG_DEBUG("I/O error while truncating");
+    } else {
+      db_size_ = end;
+    }
+  }
+  // the maps are before end, the file header tells the size cut
+  synced_size_ = std::min<int64_t>(synced_size_, db_size_);
+  WritePageMap();
+  if (!SyncSegments()) {
+    LOG_DEBUG("I/O error while syncing");
+  }
+  return next_page_id_;
 }
 
 /**
@@ -182,10 +741,910 @@ int DiskManager::GetNumFlushes() const { return num_flushes_; }
  */
 bool DiskManager::GetFlushState() const { return flush_log_; }
 
+/**
+ * Private helper function to advance the cached file size, writes past the end
+ * grow the file
+ */
+void DiskManager::GrowTo(int64_t end) {
+  int64_t size = db_size_.load();
+  while (size < end && !db_size_.compare_exchange_weak(size, end)) {
+  }
+}
+
+/**
+ * Private helper function to read adjacent pages with preadv. A short read
+ * goes on from where it stopped. The pages past the end of file, or in a
+ * missing segment, read as zeros: they are valid if allocated, as they were
+ * never written. A page cut short by the end of file, or left unread by an
+ * I/O error, is not
+ */
+bool DiskManager::ReadRun(page_id_t first_page_id, size_t count,
+                          char **buffers, bool *valid) {
+  if (direct_io_ && !std::all_of(buffers, buffers + count, IsAligned)) {
+    std::shared_ptr<char> copy = NewAlignedBuffer(count * PAGE_SIZE);
+    std::vector<char *> pages(count);
+    for (size_t i = 0; i < count; ++i) {
+      pages[i] = copy.get() + i * PAGE_SIZE;
+    }
+    bool all_valid = ReadRun(first_page_id, count, pages.data(), valid);
+    for (size_t i = 0; i < count; ++i) {
+      memcpy(buffers[i], pages[i], PAGE_SIZE);
+    }
+    return all_valid;
+  }
+  off_t local;
+  size_t left;
+  int fd = SegmentFd(PageOffset(first_page_id), false, &local, &left);
+
+  std::vector<struct iovec> iov(count);
+  for (size_t i = 0; i < count; ++i) {
+    iov[i].iov_base = buffers[i];
+    iov[i].iov_len = PAGE_SIZE;
+  }
+  size_t index = 0;
+  off_t read_count = 0;
+  bool error = false;
+  while (fd != -1 && index < count) {
+    ssize_t rc = preadv(fd, &iov[index],
+                        std::min<size_t>(count - index, IOV_MAX),
+                        local + read_count);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc < 0) {
+      LOG_DEBUG("I/O error while reading: %s", strerror(errno));
+      error = true;
+      break;
+    }
+    if (rc == 0) {
+      // end of file
+      break;
+    }
+    read_count += rc;
+    // skip the buffers which are full, the next one may be partly
+    while (index < count && static_cast<size_t>(rc) >= iov[index].iov_len) {
+      rc -= iov[index].iov_len;
+      ++index;
+    }
+    if (index < count) {
+      iov[index].iov_base = static_cast<char *>(iov[index].iov_base) + rc;
+      iov[index].iov_len -= rc;
+    }
+  }
+  bool all_valid = true;
+  for (size_t i = 0; i < count; ++i) {
+    valid[i] = i < index;
+    if (valid[i]) {
+      continue;
+    }
+    page_id_t page_id = first_page_id + static_cast<page_id_t>(i);
+    valid[i] = !error && iov[i].iov_len == PAGE_SIZE &&
+               NeverWritten(page_id);
+    if (!valid[i]) {
+      LOG_DEBUG("Read less than page %d", page_id);
+    }
+    memset(buffers[i], 0, PAGE_SIZE);
+    all_valid = all_valid && valid[i];
+  }
+  return all_valid;
+}
+
+/**
+ * Private helper function to tell a page missing from the file from one lost.
+ * In a single file, the pages below its size as of the last file header were
+ * written. Segments are not written in order, any of them may end early
+ */
+bool DiskManager::NeverWritten(page_id_t page_id) {
+  if (segment_size_ == 0 && PageOffset(page_id) < synced_size_) {
+    LOG_DEBUG("page %d was cut off the file", page_id);
+    return false;
+  }
+  return IsAllocated(page_id);
+}
+
+/**
+ * Private helper function to find a free page id. Search the map from the
+ * lowest page id which may be free, a full byte is skipped at once. Page ids
+ * reserved by extents are not free
+ */
+page_id_t DiskManager::FindFreePage() {
+  page_id_t page_id = first_free_;
+  while (page_id < next_page_id_) {
+    uint8_t bits = page_map_[page_id / 8] | reserved_[page_id / 8];
+    if (bits == 0xff) {
+      page_id = (page_id / 8 + 1) * 8;
+    } else if (bits & (1 << (page_id % 8))) {
+      ++page_id;
+    } else {
+      break;
+    }
+  }
+  if (page_id >= next_page_id_) {
+    page_id = next_page_id_;
+    GrowPageMap(page_id + 1);
+  }
+  first_free_ = page_id + 1;
+  return page_id;
+}
+
+/**
+ * Private helper function to reserve an extent. Extents are aligned to
+ * EXTENT_SIZE, the lowest one without any allocated or reserved page is taken,
+ * else the file grows by one. Its pages are preallocated in the file, so the
+ * file system places them together and later writes do not have to extend it
+ */
+void DiskManager::ReserveExtent(Extent *extent) {
+  page_id_t start = first_free_ / EXTENT_SIZE * EXTENT_SIZE;
+  for (; start < next_page_id_; start += EXTENT_SIZE) {
+    size_t i = start / 8;
+    while (i < static_cast<size_t>(start + EXTENT_SIZE) / 8 &&
+           (page_map_[i] | reserved_[i]) == 0) {
+      ++i;
+    }
+    if (i == static_cast<size_t>(start + EXTENT_SIZE) / 8) {
+      break;
+    }
+  }
+  page_id_t end = start + EXTENT_SIZE;
+  GrowPageMap(end);
+  memset(&reserved_[start / 8], 0xff, EXTENT_SIZE / 8);
+  map_dirty_[start / PAGES_PER_MAP] = true;
+  extent->next_page_id = start;
+  extent->end_page_id = end;
+  if (compressed_) {
+    // page ids are not file offsets, the slots are allocated on write
+    return;
+  }
+
+  off_t offset = PageOffset(start);
+  size_t size = EXTENT_SIZE * PAGE_SIZE;
+  while (size > 0) {
+    off_t local;
+    size_t left;
+    int fd = SegmentFd(offset, true, &local, &left);
+    size_t n = std::min(size, left);
+    if (fd == -1 || fallocate(fd, 0, local, n) != 0) {
+      // e.g. not supported by the file system, pages are allocated on write
+      LOG_DEBUG("can't preallocate extent: %s", strerror(errno));
+      return;
+    }
+    offset += n;
+    size -= n;
+    GrowTo(offset);
+  }
+}
+
+void DiskManager::GrowPageMap(page_id_t next_page_id) {
+  if (next_page_id <= next_page_id_) {
+    return;
+  }
+  next_page_id_ = next_page_id;
+  size_t num_maps = (next_page_id_ + PAGES_PER_MAP - 1) / PAGES_PER_MAP;
+  page_map_.resize(num_maps * PAGE_SIZE, 0);
+  reserved_.resize(num_maps * PAGE_SIZE, 0);
+  map_dirty_.resize(num_maps, true);
+}
+
+/**
+ * Private helper functions to locate pages in the file, the file header and
+ * the map page of each group of PAGES_PER_MAP pages are skipped
+ */
+off_t DiskManager::PageOffset(page_id_t page_id) const {
+  if (legacy_) {
+    return static_cast<off_t>(page_id) * PAGE_SIZE;
+  }
+  off_t block = static_cast<off_t>(page_id) + page_id / PAGES_PER_MAP + 2;
+  return block * PAGE_SIZE;
+}
+
+off_t DiskManager::MapOffset(size_t map_index) {
+  off_t block = static_cast<off_t>(map_index) * (PAGES_PER_MAP + 1) + 1;
+  return block * PAGE_SIZE;
+}
+
+/**
+ * Private helper function to restore the page allocations of an existing file.
+ * The ids up to the last allocated page are in use, even if the file header
+ * was not written after the maps
+ */
+bool DiskManager::LoadPageMap() {
+  if (db_size_ == 0) {
+    return true;
+  }
+  alignas(PAGE_SIZE) char buffer[PAGE_SIZE];
+  IORequest request{false, db_fd_, buffer, PAGE_SIZE, 0, nullptr};
+  FileHeader header;
+  if (!IOEngine::Complete(request)) {
+    LOG_DEBUG("I/O error while reading file header");
+    return false;
+  }
+  memcpy(&header, buffer, sizeof(header));
+  if (header.magic != FILE_MAGIC || header.pages_per_map != PAGES_PER_MAP) {
+    return LoadLegacyLayout(buffer);
+  }
+  compressed_ = header.flags & FILE_COMPRESSED;
+  checksums_ = header.flags & FILE_CHECKSUMS;
+  synced_size_ = header.synced_size;
+  segment_size_ = static_cast<size_t>(header.segment_pages) * PAGE_SIZE;
+  if (segment_size_ != 0) {
+    ScanSegments(header.next_page_id);
+  }
+
+  // the maps in the file
+  size_t num_maps = 0;
+  while (MapOffset(num_maps) < db_size_) {
+    ++num_maps;
+  }
+  page_map_.resize(num_maps * PAGE_SIZE);
+  reserved_.resize(num_maps * PAGE_SIZE, 0);
+  map_dirty_.assign(num_maps, false);
+  for (size_t i = 0; i < num_maps; ++i) {
+    if (!CompleteDbIO(false,
+                      reinterpret_cast<char *>(&page_map_[i * PAGE_SIZE]),
+                      PAGE_SIZE, MapOffset(i))) {
+      LOG_DEBUG("I/O error while reading map page %zu", i);
+    }
+  }
+
+  next_page_id_ = header.next_page_id;
+  for (page_id_t page_id = num_maps * PAGES_PER_MAP; page_id > next_page_id_;
+       --page_id) {
+    if (page_map_[(page_id - 1) / 8] & (1 << ((page_id - 1) % 8))) {
+      next_page_id_ = page_id;
+      break;
+    }
+  }
+  num_maps = (next_page_id_ + PAGES_PER_MAP - 1) / PAGES_PER_MAP;
+  page_map_.resize(num_maps * PAGE_SIZE, 0);
+  reserved_.resize(num_maps * PAGE_SIZE, 0);
+  map_dirty_.resize(num_maps, true);
+  return true;
+}
+
+/**
+ * Private helper function to open a file of the layout before the file
+ * header. Its first page is the header page of the tables, which starts with
+ * the number of its records of 36 bytes, see HeaderPage
+ */
+bool DiskManager::LoadLegacyLayout(const char *first_page) {
+  int32_t record_count;
+  memcpy(&record_count, first_page, sizeof(record_count));
+  if (db_size_ % PAGE_SIZE != 0 || record_count < 0 ||
+      record_count > (PAGE_SIZE - 4) / 36) {
+    LOG_DEBUG("unknown file format of %s", file_name_.c_str());
+    return false;
+  }
+  legacy_ = true;
+  // the pages were written without checksums, and nothing tells which ones
+  // are free
+  checksums_ = false;
+  GrowPageMap(db_size_ / PAGE_SIZE);
+  for (page_id_t page_id = 0; page_id < next_page_id_; ++page_id) {
+    page_map_[page_id / 8] |= 1 << (page_id % 8);
+  }
+  map_dirty_.assign(map_dirty_.size(), false);
+  first_free_ = next_page_id_;
+  return true;
+}
+
+/**
+ * Private helper function to persist the page allocations, after the maps so
+ * that the file header never claims more pages than they track. The ids
+ * reserved by extents are written as allocated: a crash may leak them but
+ * never hands out a page in use again
+ */
+void DiskManager::WritePageMap() {
+  if (legacy_) {
+    return;
+  }
+  alignas(PAGE_SIZE) char map[PAGE_SIZE];
+  for (size_t i = 0; i < map_dirty_.size(); ++i) {
+    if (!map_dirty_[i]) {
+      continue;
+    }
+    for (size_t j = 0; j < PAGE_SIZE; ++j) {
+      map[j] = page_map_[i * PAGE_SIZE + j] | reserved_[i * PAGE_SIZE + j];
+    }
+    if (!CompleteDbIO(true, map, PAGE_SIZE, MapOffset(i))) {
+      LOG_DEBUG("I/O error while writing map page %zu", i);
+      return;
+    }
+    GrowTo(MapOffset(i) + PAGE_SIZE);
+    map_dirty_[i] = false;
+  }
+
+  alignas(PAGE_SIZE) char buffer[PAGE_SIZE] = {0};
+  FileHeader header{FILE_MAGIC, PAGES_PER_MAP, next_page_id_,
+                    (compressed_ ? FILE_COMPRESSED : 0) |
+                        (checksums_ ? FILE_CHECKSUMS : 0),
+                    static_cast<uint32_t>(segment_size_ / PAGE_SIZE), 0,
+                    db_size_.load()};
+  memcpy(buffer, &header, sizeof(header));
+  IORequest request{true, db_fd_, buffer, PAGE_SIZE, 0, nullptr};
+  if (!IOEngine::Complete(request)) {
+    LOG_DEBUG("I/O error while writing file header");
+    return;
+  }
+  GrowTo(PAGE_SIZE);
+}
+
+/**
+ * Private helper functions to checksum the pages. A page of zeros, e.g. in a
+ * preallocated extent, was never written and passes if it is allocated
+ */
+void DiskManager::SetChecksum(char *page_data) {
+  uint32_t checksum = CRC32C::Compute(page_data, PAGE_DATA_SIZE);
+  memcpy(page_data + PAGE_DATA_SIZE, &checksum, sizeof(checksum));
+}
+
+bool DiskManager::VerifyChecksum(page_id_t page_id, const char *page_data) {
+  ChecksumMode mode = checksum_mode_;
+  if (!checksums_ || mode == ChecksumMode::OFF ||
+      (mode == ChecksumMode::SAMPLED &&
+       checksum_reads_.fetch_add(1, std::memory_order_relaxed) %
+               CHECKSUM_SAMPLE_RATE !=
+           0)) {
+    return true;
+  }
+  uint32_t checksum;
+  memcpy(&checksum, page_data + PAGE_DATA_SIZE, sizeof(checksum));
+  if (checksum == CRC32C::Compute(page_data, PAGE_DATA_SIZE)) {
+    return true;
+  }
+  // a page written has a checksum, even a page of zeros
+  if (checksum == 0 && page_data[0] == 0 &&
+      memcmp(page_data, page_data + 1, PAGE_DATA_SIZE - 1) == 0 &&
+      IsAllocated(page_id)) {
+    return true;
+  }
+  LOG_DEBUG("page %d does not match its checksum", page_id);
+  ++checksum_failures_;
+  return false;
+}
+
+/**
+ * Private helper function to read a compressed page. A slot of PAGE_SIZE
+ * bytes holds a page which did not compress, a page never written reads as
+ * zeros
+ */
+bool DiskManager::ReadCompressedPage(page_id_t page_id, char *page_data) {
+  PageSlot slot{0, 0};
+  {
+    std::lock_guard<std::mutex> lock(slot_latch_);
+    if (page_id >= 0 && static_cast<size_t>(page_id) < slots_.size()) {
+      slot = slots_[page_id];
+    }
+  }
+  if (slot.size == 0) {
+    memset(page_data, 0, PAGE_SIZE);
+    return IsAllocated(page_id);
+  }
+  char buffer[PAGE_SIZE];
+  char *data = slot.size == PAGE_SIZE ? page_data : buffer;
+  if (!CompleteDbIO(false, data, slot.size,
+                    static_cast<off_t>(slot.sector) * SECTOR_SIZE)) {
+    LOG_DEBUG("I/O error while reading");
+    memset(page_data, 0, PAGE_SIZE);
+    return false;
+  }
+  if (data == page_data) {
+    return VerifyChecksum(page_id, page_data);
+  }
+  auto start = std::chrono::steady_clock::now();
+  if (!LZCodec::Decompress(buffer, slot.size, page_data, PAGE_SIZE)) {
+    LOG_DEBUG("page %d is corrupted", page_id);
+    memset(page_data, 0, PAGE_SIZE);
+    ++checksum_failures_;
+    return false;
+  }
+  decompress_ns_ += ElapsedNs(start);
+  ++pages_read_;
+  return VerifyChecksum(page_id, page_data);
+}
+
+/**
+ * Private helper function to write a compressed page. A slot written since
+ * the last SyncPages is overwritten if the page still fits, else the page
+ * moves to a new slot: the slot table on disk must keep pointing to the page
+ * as it was synced
+ */
+bool DiskManager::WriteCompressedPage(page_id_t page_id,
+                                      const char *page_data) {
+  char page[PAGE_SIZE], buffer[PAGE_SIZE];
+  memcpy(page, page_data, PAGE_SIZE);
+  if (checksums_) {
+    SetChecksum(page);
+  }
+  auto start = std::chrono::steady_clock::now();
+  uint32_t size = LZCodec::Compress(page, PAGE_SIZE, buffer, PAGE_SIZE);
+  compress_ns_ += ElapsedNs(start);
+  char *data = buffer;
+  if (size == 0) {
+    // does not compress, stored as it is
+    data = page;
+    size = PAGE_SIZE;
+  }
+
+  uint32_t sector;
+  {
+    std::unique_lock<std::mutex> lock(slot_latch_);
+    slot_cv_.wait(lock, [this]() { return slot_syncs_ == 0; });
+    if (slots_.size() <= static_cast<size_t>(page_id)) {
+      slots_.resize(page_id + 1, {0, 0});
+      unsynced_.resize(page_id + 1, false);
+    }
+    PageSlot &slot = slots_[page_id];
+    if (slot.size != 0 && unsynced_[page_id] &&
+        SectorsOf(slot.size) == SectorsOf(size)) {
+      sector = slot.sector;
+    } else {
+      ReleaseSlot(page_id);
+      sector = AllocateSlot(SectorsOf(size));
+    }
+    slot = {sector, size};
+    unsynced_[page_id] = true;
+    slots_dirty_ = true;
+    ++slot_writes_;
+  }
+
+  off_t offset = static_cast<off_t>(sector) * SECTOR_SIZE;
+  bool ok = CompleteDbIO(true, data, size, offset);
+  if (ok) {
+    GrowTo(offset + size);
+  }
+  {
+    std::lock_guard<std::mutex> lock(slot_latch_);
+    if (--slot_writes_ == 0) {
+      slot_cv_.notify_all();
+    }
+  }
+  if (!ok) {
+    LOG_DEBUG("I/O error while writing");
+    return false;
+  }
+  ++pages_written_;
+  bytes_in_ += PAGE_SIZE;
+  bytes_out_ += size;
+  return true;
+}
+
+/**
+ * Private helper function to find a slot. The smallest free slot big enough
+ * is split, else the slot is taken at the end of the used sectors
+ */
+uint32_t DiskManager::AllocateSlot(uint32_t num_sectors) {
+  for (uint32_t n = num_sectors; n <= SECTORS_PER_PAGE; ++n) {
+    if (!free_slots_[n].empty()) {
+      uint32_t sector = free_slots_[n].back();
+      free_slots_[n].pop_back();
+      FreeSectors(sector + num_sectors, sector + n);
+      return sector;
+    }
+  }
+  uint32_t sector = end_sector_;
+  uint32_t i = 0;
+  while (i < num_sectors) {
+    if (IsMapSector(sector + i)) {
+      // skip the header or map page, the sectors before it stay free
+      FreeSectors(sector, sector + i);
+      sector = ((sector + i) / SECTORS_PER_PAGE + 1) * SECTORS_PER_PAGE;
+      i = 0;
+    } else {
+      ++i;
+    }
+  }
+  end_sector_ = sector + num_sectors;
+  return sector;
+}
+
+void DiskManager::FreeSectors(uint32_t begin, uint32_t end) {
+  while (begin < end) {
+    if (IsMapSector(begin)) {
+      ++begin;
+      continue;
+    }
+    uint32_t n = 1;
+    while (n < SECTORS_PER_PAGE && begin + n < end &&
+           !IsMapSector(begin + n)) {
+      ++n;
+    }
+    free_slots_[n].push_back(begin);
+    begin += n;
+  }
+}
+
+/**
+ * Private helper function to give up the slot of a page. A slot in the slot
+ * table on disk is only free once the next slot table is synced
+ */
+void DiskManager::ReleaseSlot(page_id_t page_id) {
+  if (static_cast<size_t>(page_id) >= slots_.size() ||
+      slots_[page_id].size == 0) {
+    return;
+  }
+  PageSlot &slot = slots_[page_id];
+  if (unsynced_[page_id]) {
+    FreeSectors(slot.sector, slot.sector + SectorsOf(slot.size));
+  } else {
+    pending_free_.push_back(slot);
+  }
+  slot = {0, 0};
+  unsynced_[page_id] = false;
+  slots_dirty_ = true;
+}
+
+/**
+ * Private helper function to restore the slots of an existing file, the
+ * sectors between them are free
+ */
+void DiskManager::LoadSlotTable() {
+  int64_t size = GetFileSize(slots_name_);
+  if (slots_fd_ == -1 || size <= 0) {
+    return;
+  }
+  slots_.resize(size / sizeof(PageSlot));
+  unsynced_.assign(slots_.size(), false);
+  IORequest request{false, slots_fd_, reinterpret_cast<char *>(slots_.data()),
+                    slots_.size() * sizeof(PageSlot), 0, nullptr};
+  if (!IOEngine::Complete(request)) {
+    LOG_DEBUG("I/O error while reading slot table");
+    slots_.assign(slots_.size(), {0, 0});
+    return;
+  }
+
+  std::vector<PageSlot> used;
+  for (auto &slot : slots_) {
+    if (slot.size != 0) {
+      used.push_back(slot);
+    }
+  }
+  std::sort(used.begin(), used.end(), [](const PageSlot &a, const PageSlot &b) {
+    return a.sector < b.sector;
+  });
+  for (auto &slot : used) {
+    if (slot.sector > end_sector_) {
+      FreeSectors(end_sector_, slot.sector);
+    }
+    end_sector_ = std::max(end_sector_, slot.sector + SectorsOf(slot.size));
+  }
+}
+
+/**
+ * Private helper function to checkpoint a compressed file. The slot table is
+ * taken first: the pages it points to are durable once the db file is synced,
+ * pages written meanwhile go to other slots. The slots released before are
+ * not in the new table, they are reused once it is synced in turn
+ */
+void DiskManager::SyncSlotTable() {
+  std::vector<PageSlot> slots;
+  std::vector<PageSlot> released;
+  {
+    // the table must not point to a slot before the page is in it
+    std::unique_lock<std::mutex> lock(slot_latch_);
+    ++slot_syncs_;
+    slot_cv_.wait(lock, [this]() { return slot_writes_ == 0; });
+    if (--slot_syncs_ == 0) {
+      slot_cv_.notify_all();
+    }
+    if (slots_dirty_) {
+      slots = slots_;
+    }
+    released.swap(pending_free_);
+    unsynced_.assign(slots_.size(), false);
+    slots_dirty_ = false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(map_latch_);
+    WritePageMap();
+  }
+  if (!SyncSegments()) {
+    LOG_DEBUG("I/O error while syncing");
+  }
+  if (slots.empty()) {
+    return;
+  }
+
+  IORequest request{true, slots_fd_, reinterpret_cast<char *>(slots.data()),
+                    slots.size() * sizeof(PageSlot), 0, nullptr};
+  if (!IOEngine::Complete(request) || fdatasync(slots_fd_) != 0) {
+    LOG_DEBUG("I/O error while writing slot table");
+    // the old table may still point to the released slots
+    std::lock_guard<std::mutex> lock(slot_latch_);
+    pending_free_.insert(pending_free_.end(), released.begin(),
+                         released.end());
+    slots_dirty_ = true;
+    return;
+  }
+  std::lock_guard<std::mutex> lock(slot_latch_);
+  for (auto &slot : released) {
+    FreeSectors(slot.sector, slot.sector + SectorsOf(slot.size));
+  }
+}
+
+/**
+ * Private helper functions to find the segment of an offset, segments are
+ * opened on first use and stay open
+ */
+int DiskManager::SegmentFd(off_t offset, bool create, off_t *local,
+                           size_t *left) {
+  if (segment_size_ == 0) {
+    *local = offset;
+    *left = std::numeric_limits<size_t>::max();
+    return db_fd_;
+  }
+  size_t index = offset / segment_size_;
+  *local = offset % segment_size_;
+  *left = segment_size_ - *local;
+  std::lock_guard<std::mutex> lock(segment_latch_);
+  if (index >= segment_fds_.size()) {
+    segment_fds_.resize(index + 1, -1);
+  }
+  int &fd = segment_fds_[index];
+  if (fd == -1) {
+    std::string name = SegmentName(index);
+    int flags = direct_io_ ? O_DIRECT : 0;
+    fd = open(name.c_str(), (read_only_ ? O_RDONLY : O_RDWR) | flags);
+    if (fd == -1 && create && !read_only_) {
+      fd = OpenFile(name, flags);
+    }
+  }
+  return fd;
+}
+
+std::string DiskManager::SegmentName(size_t index) const {
+  return index == 0 ? file_name_ : file_name_ + "." + std::to_string(index);
+}
+
+bool DiskManager::CompleteDbIO(bool is_write, char *data, size_t size,
+                               off_t offset) {
+  if (direct_io_ && !IsAligned(data)) {
+    std::shared_ptr<char> copy = NewAlignedBuffer(size);
+    if (is_write) {
+      memcpy(copy.get(), data, size);
+    }
+    if (!CompleteDbIO(is_write, copy.get(), size, offset)) {
+      return false;
+    }
+    if (!is_write) {
+      memcpy(data, copy.get(), size);
+    }
+    return true;
+  }
+  while (size > 0) {
+    off_t local;
+    size_t left;
+    int fd = SegmentFd(offset, is_write, &local, &left);
+    size_t n = std::min(size, left);
+    if (fd == -1 && is_write) {
+      return false;
+    }
+    if (fd == -1) {
+      memset(data, 0, n);
+    } else {
+      IORequest request{is_write, fd, data, n, local, nullptr};
+      if (!IOEngine::Complete(request)) {
+        return false;
+      }
+    }
+    data += n;
+    size -= n;
+    offset += n;
+  }
+  return true;
+}
+
+/**
+ * Private helper function to find the end of a segmented db. Segments up to
+ * the last allocated page may have been unlinked, the ones after it are only
+ * there if pages were written past it
+ */
+void DiskManager::ScanSegments(page_id_t next_page_id) {
+  int64_t end = next_page_id > 0 ? PageOffset(next_page_id - 1) : 0;
+  for (size_t i = 1;; ++i) {
+    int64_t begin = static_cast<int64_t>(i) * segment_size_;
+    int64_t size = GetFileSize(SegmentName(i));
+    if (size < 0 && begin > end) {
+      break;
+    }
+    if (size >= 0) {
+      db_size_ = std::max<int64_t>(db_size_, begin + size);
+    }
+  }
+}
+
+/**
+ * Private helper function to cut a segmented db at end. A segment is in use
+ * if one of its pages is, or one of its map pages tracks a page in use. The
+ * others read as zeros once unlinked, like they were
+ */
+void DiskManager::TruncateSegments(int64_t end) {
+  const int64_t blocks = segment_size_ / PAGE_SIZE;
+  size_t num_maps = map_dirty_.size();
+  std::lock_guard<std::mutex> lock(segment_latch_);
+  size_t num_segments = (db_size_ + segment_size_ - 1) / segment_size_;
+  segment_fds_.resize(std::max(segment_fds_.size(), num_segments), -1);
+  for (size_t i = 1; i < segment_fds_.size(); ++i) {
+    int64_t begin = static_cast<int64_t>(i) * segment_size_;
+    bool in_use = false;
+    for (int64_t block = begin / PAGE_SIZE;
+         block < begin / PAGE_SIZE + blocks && block * PAGE_SIZE < end &&
+         !in_use;
+         ++block) {
+      size_t group = (block - 1) / (PAGES_PER_MAP + 1);
+      int64_t index = (block - 1) % (PAGES_PER_MAP + 1);
+      if (index == 0) {
+        in_use = group < num_maps &&
+                 std::any_of(&page_map_[group * PAGE_SIZE],
+                             &page_map_[group * PAGE_SIZE] + PAGE_SIZE,
+                             [](uint8_t bits) { return bits != 0; });
+      } else {
+        page_id_t page_id = group * PAGES_PER_MAP + index - 1;
+        in_use = page_id < next_page_id_ &&
+                 ((page_map_[page_id / 8] | reserved_[page_id / 8]) &
+                  (1 << (page_id % 8)));
+      }
+    }
+    if (in_use) {
+      if (end < begin + static_cast<int64_t>(segment_size_) &&
+          truncate(SegmentName(i).c_str(), end - begin) != 0) {
+        LOG_DEBUG("I/O error while truncating");
+      }
+      continue;
+    }
+    if (segment_fds_[i] != -1) {
+      close(segment_fds_[i]);
+      segment_fds_[i] = -1;
+    }
+    if (unlink(SegmentName(i).c_str()) != 0 && errno != ENOENT) {
+      LOG_DEBUG("can't unlink segment %zu", i);
+    }
+  }
+  if (end < static_cast<int64_t>(segment_size_) &&
+      ftruncate(db_fd_, end) != 0) {
+    LOG_DEBUG("I/O error while truncating");
+  }
+  db_size_ = std::min<int64_t>(db_size_, end);
+}
+
+bool DiskManager::SyncSegments() {
+  std::vector<int> fds;
+  {
+    std::lock_guard<std::mutex> lock(segment_latch_);
+    fds = segment_fds_;
+  }
+  bool ok = true;
+  for (int fd : fds) {
+    if (fd != -1 && fdatasync(fd) != 0) {
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+/**
+ * Private helper function to bypass the page cache. O_DIRECT is turned on
+ * with fcntl once the format of the file is known, it fails on file systems
+ * without direct I/O, e.g. tmpfs. The segments opened later get it at once
+ */
+bool DiskManager::EnableDirectIO() {
+  std::lock_guard<std::mutex> lock(segment_latch_);
+  int flags = fcntl(db_fd_, F_GETFL);
+  if (flags == -1 || fcntl(db_fd_, F_SETFL, flags | O_DIRECT) == -1) {
+    return false;
+  }
+  for (int fd : segment_fds_) {
+    if (fd != -1 && fd != db_fd_) {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_DIRECT);
+    }
+  }
+  direct_io_ = true;
+  return true;
+}
+
+/**
+ * Private helper function to open the log files, the first one is named after
+ * the db file and the others after the log offset they start at
+ */
+void DiskManager::OpenLog() {
+  std::string dir = ".";
+  std::string base = log_name_;
+  std::string::size_type slash = log_name_.rfind('/');
+  if (slash != std::string::npos) {
+    dir = slash == 0 ? "/" : log_name_.substr(0, slash);
+    base = log_name_.substr(slash + 1);
+  }
+  std::vector<int64_t> starts;
+  DIR *d = opendir(dir.c_str());
+  if (d != nullptr) {
+    while (struct dirent *entry = readdir(d)) {
+      std::string name = entry->d_name;
+      if (name == base) {
+        starts.push_back(0);
+      } else if (name.size() > base.size() + 1 &&
+                 name.size() <= base.size() + 19 &&
+                 name.compare(0, base.size() + 1, base + ".") == 0 &&
+                 name.find_first_not_of("0123456789", base.size() + 1) ==
+                     std::string::npos) {
+        starts.push_back(std::stoll(name.substr(base.size() + 1)));
+      }
+    }
+    closedir(d);
+  }
+  std::sort(starts.begin(), starts.end());
+  if (starts.empty() && !read_only_) {
+    starts.push_back(0);
+  }
+  for (int64_t start : starts) {
+    std::string name = LogSegmentName(start);
+    int fd = read_only_ ? open(name.c_str(), O_RDONLY)
+                        : OpenFile(name, O_APPEND);
+    if (fd == -1) {
+      continue;
+    }
+    log_segments_.push_back({start, fd});
+    log_size_ = start + std::max<int64_t>(GetFileSize(name), 0);
+  }
+  log_fd_ = log_segments_.empty() ? -1 : log_segments_.back().fd;
+}
+
+std::string DiskManager::LogSegmentName(int64_t start) const {
+  return start == 0 ? log_name_ : log_name_ + "." + std::to_string(start);
+}
+
+/**
+ * Private helper function to map the db file as it is when opened, pages
+ * written to it later by others are not seen past the mapped size
+ */
+void DiskManager::MapFile() {
+  void *zero_page = mmap(nullptr, PAGE_SIZE, PROT_READ,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (zero_page != MAP_FAILED) {
+    zero_page_ = static_cast<char *>(zero_page);
+  }
+  if (db_size_ == 0) {
+    return;
+  }
+  void *mapping = mmap(nullptr, db_size_, PROT_READ, MAP_SHARED, db_fd_, 0);
+  if (mapping == MAP_FAILED) {
+    LOG_DEBUG("can't map file %s: %s", file_name_.c_str(), strerror(errno));
+    return;
+  }
+  mapping_ = static_cast<char *>(mapping);
+  mapping_size_ = db_size_;
+}
+
+bool DiskManager::RejectWrite(const char *what) const {
+  if (read_only_) {
+    LOG_DEBUG("%s rejected, %s is read only", what, file_name_.c_str());
+  }
+  return read_only_;
+}
+
+/**
+ * Private helper function to start the I/O engine on first use
+ */
+IOEngine *DiskManager::GetIOEngine() {
+  std::call_once(io_engine_flag_, [this]() {
+    io_engine_ = IOEngine::Create(io_engine_type_, IO_QUEUE_DEPTH);
+  });
+  return io_engine_;
+}
+
+/**
+ * Private helper function to open a file, creating it if it does not exist
+ */
+int DiskManager::OpenFile(const std::string &file_name, int flags) {
+  int fd = open(file_name.c_str(), O_RDWR | O_CREAT | flags, 0644);
+  if (fd == -1) {
+    LOG_DEBUG("can't open file %s", file_name.c_str());
+  }
+  return fd;
+}
+
 /**
  * Private helper function to get disk file size
  */
-int DiskManager::GetFileSize(const std::string &file_name) {
+int64_t DiskManager::GetFileSize(const std::string &file_name) {
   struct stat stat_buf;
   int rc = stat(file_name.c_str(), &stat_buf);
   return rc == 0 ? stat_buf.st_size : -1;
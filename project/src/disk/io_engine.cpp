@@ -0,0 +1,55 @@
+/**
+ * io_engine.cpp
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+#include "common/config.h"
+#include "disk/io_engine.h"
+#include "disk/thread_pool_io_engine.h"
+#include "disk/uring_io_engine.h"
+
+namespace cmudb {
+
+IOEngine *IOEngine::Create(IOEngineType type, size_t queue_depth) {
+  if (type != IOEngineType::THREAD_POOL) {
+    UringIOEngine *engine = new UringIOEngine(queue_depth);
+    if (engine->IsValid()) {
+      return engine;
+    }
+    delete engine;
+  }
+  return new ThreadPoolIOEngine(
+      std::max(std::min(queue_depth, size_t(IO_POOL_THREADS)), size_t(1)));
+}
+
+bool IOEngine::Complete(const IORequest &request, size_t done) {
+  while (done < request.size) {
+    ssize_t rc;
+    if (request.is_write) {
+      rc = pwrite(request.fd, request.data + done, request.size - done,
+                  request.offset + done);
+    } else {
+      rc = pread(request.fd, request.data + done, request.size - done,
+                 request.offset + done);
+    }
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc < 0) {
+      return false;
+    }
+    if (rc == 0 && !request.is_write) {
+      // end of file
+      memset(request.data + done, 0, request.size - done);
+      return true;
+    }
+    done += rc;
+  }
+  return true;
+}
+
+} // namespace cmudb
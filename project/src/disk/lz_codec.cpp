@@ -0,0 +1,177 @@
+/**
+ * lz_codec.cpp
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "disk/lz_codec.h"
+
+namespace cmudb {
+
+namespace {
+
+const size_t MIN_MATCH = 4;
+const size_t MAX_OFFSET = 65535;
+const int HASH_BITS = 12;
+
+inline uint32_t Read32(const char *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t Hash(uint32_t v) {
+  return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// append a length continued after its nibble, false if dst is full
+inline bool PutLength(size_t length, char *dst, size_t &pos, size_t capacity) {
+  for (; length >= 255; length -= 255) {
+    if (pos >= capacity) {
+      return false;
+    }
+    dst[pos++] = static_cast<char>(255);
+  }
+  if (pos >= capacity) {
+    return false;
+  }
+  dst[pos++] = static_cast<char>(length);
+  return true;
+}
+
+inline bool GetLength(const uint8_t *src, size_t size, size_t &pos,
+                      size_t &length) {
+  uint8_t byte;
+  do {
+    if (pos >= size) {
+      return false;
+    }
+    byte = src[pos++];
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+// append one run of literals, then the match if match_length > 0
+bool PutSequence(const char *literals, size_t literal_length, size_t offset,
+                 size_t match_length, char *dst, size_t &pos,
+                 size_t capacity) {
+  if (pos >= capacity) {
+    return false;
+  }
+  size_t token = pos++;
+  size_t literal_nibble = literal_length < 15 ? literal_length : 15;
+  size_t match_nibble = 0;
+  if (literal_length >= 15 &&
+      !PutLength(literal_length - 15, dst, pos, capacity)) {
+    return false;
+  }
+  if (pos + literal_length > capacity) {
+    return false;
+  }
+  memcpy(dst + pos, literals, literal_length);
+  pos += literal_length;
+
+  if (match_length > 0) {
+    if (pos + 2 > capacity) {
+      return false;
+    }
+    dst[pos++] = static_cast<char>(offset & 0xff);
+    dst[pos++] = static_cast<char>(offset >> 8);
+    match_length -= MIN_MATCH;
+    match_nibble = match_length < 15 ? match_length : 15;
+    if (match_length >= 15 &&
+        !PutLength(match_length - 15, dst, pos, capacity)) {
+      return false;
+    }
+  }
+  dst[token] = static_cast<char>(literal_nibble << 4 | match_nibble);
+  return true;
+}
+
+} // namespace
+
+/**
+ * Greedy parse: the last position of each hash of 4 bytes is remembered, a
+ * match is taken as soon as one is found and extended as far as it goes
+ */
+size_t LZCodec::Compress(const char *src, size_t size, char *dst,
+                         size_t capacity) {
+  std::vector<int> table(1 << HASH_BITS, -1);
+  size_t pos = 0;
+  size_t anchor = 0;
+  size_t ip = 0;
+  while (ip + MIN_MATCH <= size) {
+    uint32_t sequence = Read32(src + ip);
+    uint32_t h = Hash(sequence);
+    int ref = table[h];
+    table[h] = static_cast<int>(ip);
+    if (ref < 0 || ip - ref > MAX_OFFSET || Read32(src + ref) != sequence) {
+      ++ip;
+      continue;
+    }
+
+    size_t length = MIN_MATCH;
+    while (ip + length < size && src[ref + length] == src[ip + length]) {
+      ++length;
+    }
+    if (!PutSequence(src + anchor, ip - anchor, ip - ref, length, dst, pos,
+                     capacity)) {
+      return 0;
+    }
+    ip += length;
+    anchor = ip;
+  }
+  if (!PutSequence(src + anchor, size - anchor, 0, 0, dst, pos, capacity) ||
+      pos >= capacity) {
+    return 0;
+  }
+  return pos;
+}
+
+bool LZCodec::Decompress(const char *src, size_t size, char *dst,
+                         size_t dst_size) {
+  const uint8_t *in = reinterpret_cast<const uint8_t *>(src);
+  size_t pos = 0;
+  size_t op = 0;
+  while (pos < size) {
+    uint8_t token = in[pos++];
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 && !GetLength(in, size, pos, literal_length)) {
+      return false;
+    }
+    if (pos + literal_length > size || op + literal_length > dst_size) {
+      return false;
+    }
+    memcpy(dst + op, src + pos, literal_length);
+    pos += literal_length;
+    op += literal_length;
+    if (pos == size) {
+      // the last run has no match
+      break;
+    }
+
+    if (pos + 2 > size) {
+      return false;
+    }
+    size_t offset = in[pos] | in[pos + 1] << 8;
+    pos += 2;
+    size_t match_length = token & 0xf;
+    if (match_length == 15 && !GetLength(in, size, pos, match_length)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (offset == 0 || offset > op || op + match_length > dst_size) {
+      return false;
+    }
+    // the match may overlap what it produces, copy byte by byte
+    for (size_t i = 0; i < match_length; ++i, ++op) {
+      dst[op] = dst[op - offset];
+    }
+  }
+  return op == dst_size;
+}
+
+} // namespace cmudb
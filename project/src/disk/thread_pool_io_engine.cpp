@@ -0,0 +1,55 @@
+/**
+ * thread_pool_io_engine.cpp
+ */
+
+#include "disk/thread_pool_io_engine.h"
+
+namespace cmudb {
+
+ThreadPoolIOEngine::ThreadPoolIOEngine(size_t num_threads) : stop_(false) {
+  for (size_t i = 0; i < num_threads; ++i) {
+    threads_.emplace_back([this]() {
+      std::unique_lock<std::mutex> lock(latch_);
+      while (true) {
+        cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          break;
+        }
+        IORequest request = std::move(queue_.front());
+        queue_.pop_front();
+        lock.unlock();
+
+        bool ok = Complete(request);
+        request.callback(ok);
+        lock.lock();
+      }
+    });
+  }
+}
+
+ThreadPoolIOEngine::~ThreadPoolIOEngine() {
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPoolIOEngine::Submit(std::vector<IORequest> &requests) {
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    for (auto &request : requests) {
+      queue_.push_back(std::move(request));
+    }
+  }
+  if (requests.size() == 1) {
+    cv_.notify_one();
+  } else {
+    cv_.notify_all();
+  }
+}
+
+} // namespace cmudb
@@ -0,0 +1,256 @@
+/**
+ * uring_io_engine.cpp
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "common/logger.h"
+#include "disk/uring_io_engine.h"
+
+namespace cmudb {
+
+namespace {
+
+int io_uring_setup(unsigned entries, struct io_uring_params *params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete,
+                   unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+// the kernel reads and writes the ring indexes concurrently
+inline unsigned LoadAcquire(const unsigned *p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+inline void StoreRelease(unsigned *p, unsigned v) {
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+template <typename T> T *At(void *ring, unsigned offset) {
+  return reinterpret_cast<T *>(static_cast<char *>(ring) + offset);
+}
+
+} // namespace
+
+UringIOEngine::UringIOEngine(size_t queue_depth)
+    : ring_fd_(-1), sq_entries_(0), sq_ring_(MAP_FAILED), sq_ring_size_(0),
+      cq_ring_(MAP_FAILED), cq_ring_size_(0), sqes_(nullptr), sqes_size_(0),
+      in_flight_(0), reaper_(nullptr) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int ring_fd = io_uring_setup(queue_depth, &params);
+  if (ring_fd < 0) {
+    LOG_DEBUG("io_uring is not available: %s", strerror(errno));
+    return;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  // both rings in one mapping since 5.4
+  bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+  if (sq_ring_ != MAP_FAILED) {
+    cq_ring_ = single_mmap ? sq_ring_
+                           : mmap(nullptr, cq_ring_size_,
+                                  PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_POPULATE, ring_fd,
+                                  IORING_OFF_CQ_RING);
+  }
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  void *sqes = MAP_FAILED;
+  if (cq_ring_ != MAP_FAILED) {
+    sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+  }
+  if (sqes == MAP_FAILED) {
+    LOG_DEBUG("can't map io_uring: %s", strerror(errno));
+    Unmap();
+    close(ring_fd);
+    return;
+  }
+  sqes_ = static_cast<struct io_uring_sqe *>(sqes);
+
+  sq_head_ = At<unsigned>(sq_ring_, params.sq_off.head);
+  sq_tail_ = At<unsigned>(sq_ring_, params.sq_off.tail);
+  sq_mask_ = At<unsigned>(sq_ring_, params.sq_off.ring_mask);
+  sq_array_ = At<unsigned>(sq_ring_, params.sq_off.array);
+  cq_head_ = At<unsigned>(cq_ring_, params.cq_off.head);
+  cq_tail_ = At<unsigned>(cq_ring_, params.cq_off.tail);
+  cq_mask_ = At<unsigned>(cq_ring_, params.cq_off.ring_mask);
+  cqes_ = At<struct io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+  // the completion ring is twice as large, it can not overflow as long as
+  // no more than sq_entries_ requests are in flight
+  sq_entries_ = params.sq_entries;
+  ring_fd_ = ring_fd;
+
+  reaper_ = new std::thread(&UringIOEngine::Reap, this);
+}
+
+UringIOEngine::~UringIOEngine() {
+  if (!IsValid()) {
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(latch_);
+    cv_.wait(lock, [this]() { return in_flight_ == 0; });
+    // a nop without user data stops the reaper
+    Push(IORING_OP_NOP, nullptr);
+    Enter(1);
+  }
+  reaper_->join();
+  delete reaper_;
+  Unmap();
+  close(ring_fd_);
+}
+
+void UringIOEngine::Submit(std::vector<IORequest> &requests) {
+  std::unique_lock<std::mutex> lock(latch_);
+  unsigned count = 0;
+  for (auto &request : requests) {
+    if (in_flight_ == sq_entries_) {
+      // hand over what is queued, then wait for a free slot
+      Enter(count);
+      count = 0;
+      cv_.wait(lock, [this]() { return in_flight_ < sq_entries_; });
+    }
+    Pending *pending = new Pending{std::move(request), {nullptr, 0}};
+    pending->iov.iov_base = pending->request.data;
+    pending->iov.iov_len = pending->request.size;
+    Push(pending->request.is_write ? IORING_OP_WRITEV : IORING_OP_READV,
+         pending);
+    ++in_flight_;
+    ++count;
+  }
+  Enter(count);
+}
+
+void UringIOEngine::Push(uint8_t opcode, Pending *pending) {
+  // only the submission side moves the tail
+  unsigned tail = *sq_tail_;
+  unsigned index = tail & *sq_mask_;
+  struct io_uring_sqe *sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->user_data = reinterpret_cast<uint64_t>(pending);
+  if (pending != nullptr) {
+    sqe->fd = pending->request.fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&pending->iov);
+    sqe->len = 1;
+    sqe->off = pending->request.offset;
+  } else {
+    sqe->fd = -1;
+  }
+  sq_array_[index] = index;
+  StoreRelease(sq_tail_, tail + 1);
+}
+
+void UringIOEngine::Enter(unsigned count) {
+  while (count > 0) {
+    int rc = io_uring_enter(ring_fd_, count, 0, 0);
+    if (rc > 0) {
+      count -= rc;
+    } else if (rc < 0 && (errno == EINTR || errno == EAGAIN)) {
+      std::this_thread::yield();
+    } else {
+      break;
+    }
+  }
+  if (count == 0) {
+    return;
+  }
+
+  // take back the entries the kernel did not consume
+  LOG_DEBUG("io_uring_enter failed: %s", strerror(errno));
+  unsigned head = LoadAcquire(sq_head_);
+  unsigned tail = *sq_tail_;
+  StoreRelease(sq_tail_, head);
+  for (; head != tail; ++head) {
+    auto *pending = reinterpret_cast<Pending *>(
+        sqes_[sq_array_[head & *sq_mask_]].user_data);
+    if (pending != nullptr) {
+      pending->request.callback(Complete(pending->request));
+      delete pending;
+      --in_flight_;
+    }
+  }
+  cv_.notify_all();
+}
+
+void UringIOEngine::Reap() {
+  std::vector<std::pair<Pending *, int>> completed;
+  bool stop = false;
+  while (!stop) {
+    if (io_uring_enter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+        errno != EINTR) {
+      LOG_DEBUG("io_uring_enter failed: %s", strerror(errno));
+    }
+
+    // copy the completions out, then free their slots for the kernel
+    completed.clear();
+    unsigned head = *cq_head_;
+    unsigned tail = LoadAcquire(cq_tail_);
+    for (; head != tail; ++head) {
+      struct io_uring_cqe *cqe = &cqes_[head & *cq_mask_];
+      completed.emplace_back(reinterpret_cast<Pending *>(cqe->user_data),
+                             cqe->res);
+    }
+    StoreRelease(cq_head_, head);
+
+    size_t count = 0;
+    for (auto &entry : completed) {
+      Pending *pending = entry.first;
+      int res = entry.second;
+      if (pending == nullptr) {
+        stop = true;
+        continue;
+      }
+      bool ok = true;
+      if (res == -EINTR || res == -EAGAIN) {
+        ok = Complete(pending->request);
+      } else if (res < 0) {
+        LOG_DEBUG("I/O error in io_uring: %s", strerror(-res));
+        ok = false;
+      } else if (static_cast<size_t>(res) < pending->request.size) {
+        // short transfer, e.g. end of file
+        ok = Complete(pending->request, res);
+      }
+      pending->request.callback(ok);
+      delete pending;
+      ++count;
+    }
+    if (count > 0) {
+      std::lock_guard<std::mutex> lock(latch_);
+      in_flight_ -= count;
+      cv_.notify_all();
+    }
+  }
+}
+
+void UringIOEngine::Unmap() {
+  if (sqes_ != nullptr) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != MAP_FAILED) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+}
+
+} // namespace cmudb
@@ -0,0 +1,410 @@
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <functional>
+
+#include "hash/concurrent_extendible_hash.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+/*
+ * constructor
+ * size: least number of elements in a bucket before it is split, rounded up
+ * so that the keys of a bucket fill whole cache lines
+ */
+template <typename K, typename V>
+ConcurrentExtendibleHash<K, V>::ConcurrentExtendibleHash(size_t size)
+    : capacity_([size]() {
+        size_t per_line = std::max(CACHE_LINE_SIZE / sizeof(K), size_t(1));
+        size_t lines = std::max((size + per_line - 1) / per_line, size_t(1));
+        return lines * per_line;
+      }()),
+      bucket_count_(1), depth_(0), pair_count_(0), merge_count_(0),
+      shrink_count_(0), directory_(1) {
+  directory_[0].store(new Bucket(capacity_, 0, 0));
+}
+
+/*
+ * a bucket is pointed to by every slot of the directory matching its prefix,
+ * the first of them is the one equal to its id
+ */
+template <typename K, typename V>
+ConcurrentExtendibleHash<K, V>::~ConcurrentExtendibleHash() {
+  for (size_t i = 0; i < directory_.size(); ++i) {
+    Bucket *bucket = directory_[i].load();
+    if (bucket->id == i) {
+      delete bucket;
+    }
+  }
+}
+
+/*
+ * helper function to calculate the hashing address of input key
+ */
+template <typename K, typename V>
+size_t ConcurrentExtendibleHash<K, V>::HashKey(const K &key) {
+  return std::hash<K>()(key);
+}
+
+template <typename K, typename V>
+int ConcurrentExtendibleHash<K, V>::GetGlobalDepth() const {
+  directory_latch_.RLock();
+  int depth = depth_;
+  directory_latch_.RUnlock();
+  return depth;
+}
+
+/*
+ * local depth of the bucket directory slot bucket_id points to
+ */
+template <typename K, typename V>
+int ConcurrentExtendibleHash<K, V>::GetLocalDepth(int bucket_id) const {
+  directory_latch_.RLock();
+  assert(0 <= bucket_id && bucket_id < static_cast<int>(directory_.size()));
+  Bucket *bucket = directory_[bucket_id].load();
+  int depth;
+  {
+    std::lock_guard<std::mutex> lock(bucket->latch);
+    depth = bucket->depth;
+  }
+  directory_latch_.RUnlock();
+  return depth;
+}
+
+template <typename K, typename V>
+int ConcurrentExtendibleHash<K, V>::GetNumBuckets() const {
+  return bucket_count_;
+}
+
+/*
+ * directory size and bucket occupancy, each bucket is counted at the
+ * directory slot equal to its id
+ */
+template <typename K, typename V>
+ExtendibleHashStats ConcurrentExtendibleHash<K, V>::GetStats() const {
+  ExtendibleHashStats stats;
+  directory_latch_.RLock();
+  stats.directory_size = directory_.size();
+  stats.global_depth = depth_;
+  stats.bucket_size = capacity_;
+  for (size_t i = 0; i < directory_.size(); ++i) {
+    Bucket *bucket = directory_[i].load();
+    std::lock_guard<std::mutex> lock(bucket->latch);
+    if (bucket->id == i) {
+      size_t items = bucket->count + bucket->overflow.size();
+      ++stats.num_buckets;
+      if (items == 0) {
+        ++stats.empty_buckets;
+      }
+      stats.max_items = std::max(stats.max_items, items);
+      stats.num_items += items;
+    }
+  }
+  stats.occupancy = static_cast<double>(stats.num_items) /
+                    (stats.num_buckets * capacity_);
+  stats.merges = merge_count_;
+  stats.shrinks = shrink_count_;
+  directory_latch_.RUnlock();
+  return stats;
+}
+
+/*
+ * lookup function to find value associate with input key
+ */
+template <typename K, typename V>
+bool ConcurrentExtendibleHash<K, V>::Find(const K &key, V &value) {
+  directory_latch_.RLock();
+  Bucket *bucket = LockBucket(HashKey(key));
+  bool found = false;
+  for (size_t i = 0; i < bucket->count && !found; ++i) {
+    if (bucket->keys[i] == key) {
+      value = bucket->values[i];
+      found = true;
+    }
+  }
+  for (auto it = bucket->overflow.begin();
+       it != bucket->overflow.end() && !found; ++it) {
+    if (it->first == key) {
+      value = it->second;
+      found = true;
+    }
+  }
+  bucket->latch.unlock();
+  directory_latch_.RUnlock();
+  return found;
+}
+
+/*
+ * delete <key,value> entry in hash table, the last slot of the bucket fills
+ * the hole so the used slots stay contiguous
+ * A bucket left at most half full is merged with its buddy if both together
+ * fit in half a bucket. The buddy is looked at with only its own latch held,
+ * the merge itself is done under the directory write latch
+ */
+template <typename K, typename V>
+bool ConcurrentExtendibleHash<K, V>::Remove(const K &key) {
+  size_t hash = HashKey(key);
+  directory_latch_.RLock();
+  Bucket *bucket = LockBucket(hash);
+  bool found = false;
+  for (size_t i = 0; i < bucket->count && !found; ++i) {
+    if (bucket->keys[i] == key) {
+      if (i != --bucket->count) {
+        bucket->keys[i] = std::move(bucket->keys[bucket->count]);
+        bucket->values[i] = std::move(bucket->values[bucket->count]);
+      }
+      found = true;
+    }
+  }
+  if (!found) {
+    auto it = std::find_if(
+        bucket->overflow.begin(), bucket->overflow.end(),
+        [&key](const std::pair<K, V> &item) { return item.first == key; });
+    if (it != bucket->overflow.end()) {
+      bucket->overflow.erase(it);
+      found = true;
+    }
+  }
+  bool merge = false;
+  if (found) {
+    --pair_count_;
+    merge = bucket->depth > 0 && bucket->count <= capacity_ / 2;
+  }
+  if (merge) {
+    size_t buddy_id = bucket->id ^ (size_t(1) << (bucket->depth - 1));
+    bucket->latch.unlock();
+    Bucket *buddy = directory_[buddy_id].load();
+    std::lock_guard<std::mutex> lock(buddy->latch);
+    merge = buddy->id == buddy_id && buddy->count <= capacity_ / 2;
+  } else {
+    bucket->latch.unlock();
+  }
+  directory_latch_.RUnlock();
+  if (merge) {
+    Merge(hash);
+  }
+  return found;
+}
+
+/*
+ * insert <key,value> entry in hash table
+ * A full bucket is split while holding its latch and the directory read
+ * latch. If its local depth equals the global depth, the directory is doubled
+ * first under the directory write latch, without holding any bucket latch
+ */
+template <typename K, typename V>
+void ConcurrentExtendibleHash<K, V>::Insert(const K &key, const V &value) {
+  size_t hash = HashKey(key);
+  while (true) {
+    directory_latch_.RLock();
+    Bucket *bucket = LockBucket(hash);
+
+    // already in bucket, override
+    bool found = false;
+    for (size_t i = 0; i < bucket->count && !found; ++i) {
+      if (bucket->keys[i] == key) {
+        bucket->values[i] = value;
+        found = true;
+      }
+    }
+    for (auto it = bucket->overflow.begin();
+         it != bucket->overflow.end() && !found; ++it) {
+      if (it->first == key) {
+        it->second = value;
+        found = true;
+      }
+    }
+    if (found) {
+      bucket->latch.unlock();
+      directory_latch_.RUnlock();
+      return;
+    }
+
+    if (bucket->count < capacity_) {
+      bucket->keys[bucket->count] = key;
+      bucket->values[bucket->count] = value;
+      ++bucket->count;
+      ++pair_count_;
+      bucket->latch.unlock();
+      directory_latch_.RUnlock();
+      return;
+    }
+
+    // all keys of the bucket have the same hash, should be a rare case
+    if (bucket->depth == static_cast<int>(sizeof(size_t) * CHAR_BIT)) {
+      bucket->overflow.emplace_back(key, value);
+      ++pair_count_;
+      bucket->latch.unlock();
+      directory_latch_.RUnlock();
+      return;
+    }
+
+    int depth = bucket->depth;
+    bool grow = depth == depth_;
+    if (!grow) {
+      Split(bucket);
+    }
+    bucket->latch.unlock();
+    directory_latch_.RUnlock();
+    if (grow) {
+      Grow(depth);
+    }
+  }
+}
+
+/*
+ * helper function to lock the bucket holding hash
+ * should be called when holding the directory read latch. A bucket read from
+ * the directory may have been split before its latch is acquired, then the
+ * slot is read again
+ */
+template <typename K, typename V>
+typename ConcurrentExtendibleHash<K, V>::Bucket *
+ConcurrentExtendibleHash<K, V>::LockBucket(size_t hash) {
+  size_t index = hash & Mask(depth_);
+  while (true) {
+    Bucket *bucket = directory_[index].load();
+    bucket->latch.lock();
+    if ((hash & Mask(bucket->depth)) == bucket->id) {
+      return bucket;
+    }
+    bucket->latch.unlock();
+  }
+}
+
+/*
+ * helper function to split a full bucket in two, the keys with the next bit
+ * of their hash set go to the new bucket
+ * should be called when holding the directory read latch and the bucket latch
+ */
+template <typename K, typename V>
+void ConcurrentExtendibleHash<K, V>::Split(Bucket *bucket) {
+  assert(bucket->depth < depth_);
+  size_t bit = size_t(1) << bucket->depth;
+  auto image = new Bucket(capacity_, bucket->id | bit, bucket->depth + 1);
+  size_t kept = 0;
+  for (size_t i = 0; i < bucket->count; ++i) {
+    if (HashKey(bucket->keys[i]) & bit) {
+      image->keys[image->count] = std::move(bucket->keys[i]);
+      image->values[image->count] = std::move(bucket->values[i]);
+      ++image->count;
+    } else {
+      if (kept != i) {
+        bucket->keys[kept] = std::move(bucket->keys[i]);
+        bucket->values[kept] = std::move(bucket->values[i]);
+      }
+      ++kept;
+    }
+  }
+  bucket->count = kept;
+  ++bucket->depth;
+  ++bucket_count_;
+
+  // publish the new bucket, these slots point to the split bucket and nobody
+  // else changes them while its latch is held
+  for (size_t i = image->id; i < directory_.size(); i += bit << 1) {
+    directory_[i].store(image);
+  }
+}
+
+/*
+ * helper function to double the directory if the global depth still is depth,
+ * every new slot points to the bucket of its lower half twin
+ */
+template <typename K, typename V>
+void ConcurrentExtendibleHash<K, V>::Grow(int depth) {
+  directory_latch_.WLock();
+  if (depth_ == depth) {
+    size_t size = directory_.size();
+    std::vector<std::atomic<Bucket *>> directory(size * 2);
+    for (size_t i = 0; i < size * 2; ++i) {
+      directory[i].store(directory_[i & (size - 1)].load());
+    }
+    directory_.swap(directory);
+    ++depth_;
+  }
+  directory_latch_.WUnlock();
+}
+
+/*
+ * helper function to tell if bucket and buddy, the bucket it was split from
+ * or split off, together hold at most half a bucket. Splitting above a full
+ * bucket and merging below half of one keeps churn around either boundary
+ * from splitting and merging the same buckets over and over
+ * should be called when holding the directory write latch
+ */
+template <typename K, typename V>
+bool ConcurrentExtendibleHash<K, V>::CanMerge(Bucket *bucket,
+                                              Bucket *buddy) const {
+  return buddy->depth == bucket->depth && bucket->overflow.empty() &&
+         buddy->overflow.empty() &&
+         bucket->count + buddy->count <= capacity_ / 2;
+}
+
+/*
+ * helper function to merge the bucket holding hash with its buddy while they
+ * fit in half a bucket, then halve the directory while its upper half mirrors
+ * the lower half. The bucket with the higher id is folded into the other one
+ */
+template <typename K, typename V>
+void ConcurrentExtendibleHash<K, V>::Merge(size_t hash) {
+  directory_latch_.WLock();
+  Bucket *bucket = directory_[hash & Mask(depth_)].load();
+  bool merged = false;
+  while (bucket->depth > 0) {
+    size_t bit = size_t(1) << (bucket->depth - 1);
+    Bucket *buddy = directory_[bucket->id ^ bit].load();
+    if (!CanMerge(bucket, buddy)) {
+      break;
+    }
+    if (buddy->id < bucket->id) {
+      std::swap(bucket, buddy);
+    }
+    for (size_t i = 0; i < buddy->count; ++i) {
+      bucket->keys[bucket->count] = std::move(buddy->keys[i]);
+      bucket->values[bucket->count] = std::move(buddy->values[i]);
+      ++bucket->count;
+    }
+    --bucket->depth;
+    for (size_t i = buddy->id; i < directory_.size(); i += bit << 1) {
+      directory_[i].store(bucket);
+    }
+    delete buddy;
+    --bucket_count_;
+    ++merge_count_;
+    merged = true;
+  }
+
+  while (merged && depth_ > 0) {
+    size_t half = directory_.size() / 2;
+    bool mirrored = true;
+    for (size_t i = 0; i < half && mirrored; ++i) {
+      mirrored = directory_[i].load() == directory_[i + half].load();
+    }
+    if (!mirrored) {
+      break;
+    }
+    std::vector<std::atomic<Bucket *>> directory(half);
+    for (size_t i = 0; i < half; ++i) {
+      directory[i].store(directory_[i].load());
+    }
+    directory_.swap(directory);
+    --depth_;
+    ++shrink_count_;
+  }
+  directory_latch_.WUnlock();
+}
+
+template <typename K, typename V>
+size_t ConcurrentExtendibleHash<K, V>::Mask(int depth) {
+  return depth >= static_cast<int>(sizeof(size_t) * CHAR_BIT)
+             ? ~size_t(0)
+             : (size_t(1) << depth) - 1;
+}
+
+template class ConcurrentExtendibleHash<page_id_t, Page *>;
+// test purpose
+template class ConcurrentExtendibleHash<int, std::string>;
+template class ConcurrentExtendibleHash<int, int>;
+} // namespace cmudb
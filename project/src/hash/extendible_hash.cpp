@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <functional>
 #include <list>
@@ -17,7 +18,7 @@ namespace cmudb {
 template <typename K, typename V>
 ExtendibleHash<K, V>::ExtendibleHash(size_t size):
     bucket_size_(size), bucket_count_(0), depth(0),
-    pair_count(0) {
+    pair_count(0), merge_count_(0), shrink_count_(0) {
   directory_.emplace_back(new Bucket(0, 0));
   // initial: 1 bucket
   bucket_count_ = 1;
@@ -66,6 +67,37 @@ int ExtendibleHash<K, V>::GetNumBuckets() const {
   return bucket_count_;
 }
 
+/*
+ * directory size and bucket occupancy, each bucket is counted at the
+ * directory slot equal to its id
+ */
+template <typename K, typename V>
+ExtendibleHashStats ExtendibleHash<K, V>::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ExtendibleHashStats stats;
+  stats.directory_size = directory_.size();
+  stats.global_depth = depth;
+  stats.num_items = pair_count;
+  stats.bucket_size = bucket_size_;
+  for (size_t i = 0; i < directory_.size(); ++i) {
+    const auto &bucket = directory_[i];
+    if (bucket && bucket->id == i) {
+      ++stats.num_buckets;
+      if (bucket->items.empty()) {
+        ++stats.empty_buckets;
+      }
+      stats.max_items = std::max(stats.max_items, bucket->items.size());
+    }
+  }
+  if (stats.num_buckets > 0 && bucket_size_ > 0) {
+    stats.occupancy = static_cast<double>(stats.num_items) /
+                      (stats.num_buckets * bucket_size_);
+  }
+  stats.merges = merge_count_;
+  stats.shrinks = shrink_count_;
+  return stats;
+}
+
 /*
  * lookup function to find value associate with input key
  */
@@ -86,7 +118,8 @@ bool ExtendibleHash<K, V>::Find(const K &key, V &value) {
 
 /*
  * delete <key,value> entry in hash table
- * Shrink & Combination is not required for this project
+ * A bucket left at most half full is merged with its buddy if possible, then
+ * the directory is halved as long as no bucket needs its full depth
  */
 template <typename K, typename V>
 bool ExtendibleHash<K, V>::Remove(const K &key) {
@@ -98,10 +131,81 @@ bool ExtendibleHash<K, V>::Remove(const K &key) {
     auto bucket = directory_[index];
     cnt += bucket->items.erase(key);
     pair_count -= cnt;
+    if (cnt != 0 && bucket->items.size() <= bucket_size_ / 2 &&
+        merge(index)) {
+      shrink();
+    }
   }
   return cnt != 0;
 }
 
+/*
+ * helper function to merge the bucket at index with its buddy, repeatedly,
+ * while both together hold at most half a bucket. Splitting above a full
+ * bucket and merging below half of one keeps churn around either boundary
+ * from splitting and merging the same buckets over and over. A buddy whose
+ * directory slots are all empty is an empty bucket of the same local depth
+ * return true if any bucket was merged
+ * should be called when holding the lock
+ */
+template <typename K, typename V>
+bool ExtendibleHash<K, V>::merge(size_t index) {
+  auto bucket = directory_[index];
+  bool merged = false;
+  while (bucket->depth > 0 && !bucket->overflow) {
+    size_t step = size_t(1) << bucket->depth;
+    size_t buddy_id = bucket->id ^ (step >> 1);
+    auto buddy = directory_[buddy_id];
+    if (buddy == nullptr) {
+      // the buddy slots are empty unless some deeper bucket lives there
+      for (size_t i = buddy_id; i < directory_.size(); i += step) {
+        if (directory_[i]) {
+          return merged;
+        }
+      }
+    } else if (buddy->depth != bucket->depth || buddy->overflow) {
+      break;
+    }
+    size_t items = bucket->items.size() + (buddy ? buddy->items.size() : 0);
+    if (items > bucket_size_ / 2) {
+      break;
+    }
+
+    if (buddy) {
+      bucket->items.insert(buddy->items.begin(), buddy->items.end());
+      --bucket_count_;
+    }
+    --bucket->depth;
+    bucket->id &= (step >> 1) - 1;
+    for (size_t i = bucket->id; i < directory_.size(); i += step >> 1) {
+      directory_[i] = bucket;
+    }
+    ++merge_count_;
+    merged = true;
+  }
+  return merged;
+}
+
+/*
+ * helper function to halve the directory while its upper half mirrors the
+ * lower half, i.e. no bucket has a local depth equal to the global depth
+ * should be called when holding the lock
+ */
+template <typename K, typename V>
+void ExtendibleHash<K, V>::shrink() {
+  while (depth > 0) {
+    size_t half = directory_.size() / 2;
+    for (size_t i = 0; i < half; ++i) {
+      if (directory_[i] != directory_[i + half]) {
+        return;
+      }
+    }
+    directory_.resize(half);
+    --depth;
+    ++shrink_count_;
+  }
+}
+
 /*
  * helper function to split a bucket when is full, overflow if necessary
  */
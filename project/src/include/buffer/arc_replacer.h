@@ -0,0 +1,90 @@
+/**
+ * arc_replacer.h
+ *
+ * Functionality: Adaptive Replacement Cache (Megiddo & Modha). Resident
+ * values are split into T1 (page seen once recently) and T2 (page seen at
+ * least twice), both kept in LRU order. Ghost lists B1 and B2 remember the
+ * page ids recently evicted from T1 and T2. A miss on a page found in B1
+ * means T1 was too small and grows the target size p of T1, a miss on a page
+ * found in B2 shrinks it. Victim evicts from T1 while T1 exceeds p, from T2
+ * otherwise.
+ *
+ * Pages are reported through RecordAccess, which the buffer pool calls on
+ * every pin, including right after a miss has been mapped to a frame. As the
+ * victim is chosen before the missing page is known, the adaption of p takes
+ * effect from the next eviction on.
+ */
+
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "buffer/replacer.h"
+
+namespace cmudb {
+
+template <typename T> class ARCReplacer : public Replacer<T> {
+  enum class List { T1 = 0, T2 };
+
+  struct entry {
+    List list;
+    typename std::list<T>::iterator pos;
+    page_id_t page_id = INVALID_PAGE_ID;
+    bool evictable = false;
+  };
+
+public:
+  // capacity: number of frames managed by this replacer
+  explicit ARCReplacer(size_t capacity);
+
+  ~ARCReplacer();
+
+  // disable copy
+  ARCReplacer(const ARCReplacer &) = delete;
+  ARCReplacer &operator=(const ARCReplacer &) = delete;
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+  void RecordAccess(const T &value, page_id_t page_id);
+
+  size_t PeekVictims(std::vector<T> &values, size_t max);
+
+  bool Evict(const T &value);
+
+  void Discard(const T &value);
+
+  void SetCapacity(size_t capacity);
+
+  // for test
+  size_t GetTarget();
+
+private:
+  // should be called when holding the lock
+  void Track(const T &value, entry &e, List list);
+  void Untrack(entry &e);
+  List Preferred();
+  bool EvictFrom(List list, T &value);
+  void Remember(List list, page_id_t page_id);
+  bool Forget(List list, page_id_t page_id);
+  void TrimGhosts();
+
+  std::mutex mutex_;
+  size_t capacity_;
+  size_t target_;                      // target size of T1
+  size_t size_;                        // number of evictable values
+  std::list<T> lists_[2];              // T1 & T2, MRU at front
+  std::list<page_id_t> ghosts_[2];     // B1 & B2, MRU at front
+  std::unordered_map<page_id_t, typename std::list<page_id_t>::iterator>
+      ghost_table_[2];
+  std::unordered_map<T, entry> table_;
+};
+
+} // namespace cmudb
@@ -4,63 +4,347 @@
  * Functionality: The simplified Buffer Manager interface allows a client to
  * new/delete pages on disk, to read a disk page into the buffer pool and pin
  * it, also to unpin a page in the buffer pool.
+ *
+ * The pool can be split into several shards, each shard owns a disjoint set
+ * of frames together with its own page table, replacer, free list and latch.
+ * A page always lives in the shard selected by hashing its page_id, so
+ * threads working on different pages rarely contend on the same latch.
+ *
+ * Shard latches only protect metadata, disk reads and writes are done
+ * unlatched. While a frame is loading or being written back, requesters of
+ * its page wait on the shard's condition variable for that frame instead of
+ * blocking the whole shard.
+ *
+ * An optional page cleaner thread writes dirty unpinned pages from the cold
+ * end of the replacers ahead of demand, so eviction rarely has to write back
+ * (and wait for the log) on the query path. It stays idle while the ratio of
+ * dirty frames is below the low watermark, and speeds up linearly to its max
+ * write rate as the ratio approaches the high watermark.
+ *
+ * Scans following a page chain can ask for read-ahead: a background thread,
+ * started on first use, loads the requested pages into unpinned frames. It
+ * takes at most a quarter of the pool per request. The read-ahead of a scan
+ * with a ring goes to at most half of its ring instead, and leaves the rest
+ * of the pool alone. A miss on the page after
+ * the previous miss is taken as a sequential stream, the pages following it
+ * are read along with it in one vectored read.
+ *
+ * The number of frames can be changed online with Resize. New frames go to
+ * the free lists right away. When shrinking, free and clean unpinned frames
+ * are released at once, dirty ones are written back first, and a shard that
+ * still owes frames releases them as its pages get unpinned.
+ *
+ * With logging enabled, victim selection is WAL aware: among the next few
+ * victims of the replacer, a clean frame is taken first, then a dirty frame
+ * whose LSN is already durable. The log is forced only if there is none,
+ * and a background log flush is started as soon as undurable victims show
+ * up, so they are durable by the time their turn comes.
+ *
+ * The memory of the frames comes from an arena, aligned for direct I/O and
+ * backed by huge pages if ENABLE_HUGE_PAGES is set when the pool is created.
+ * A frame released by a shrink goes back to the arena for the next growth.
+ *
+ * When the db file is opened read only, frames have no memory of their own: a
+ * page is pointed into the mapped file instead of being read into its frame.
+ * New and deleted pages are refused.
+ *
+ * Every shard keeps counters of what happened to it. They are relaxed atomics
+ * padded to cache lines of their own and never take a latch, GetStats sums
+ * them into a snapshot.
  */
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <list>
 #include <mutex>
+#include <thread>
+#include <unordered_set>
 
+#include "buffer/arc_replacer.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/frame_arena.h"
+#include "buffer/lru_k_replacer.h"
 #include "buffer/lru_replacer.h"
+#include "buffer/page_guard.h"
+#include "buffer/scan_ring.h"
 #include "disk/disk_manager.h"
-#include "hash/extendible_hash.h"
+#include "hash/concurrent_extendible_hash.h"
 #include "logging/log_manager.h"
 #include "page/page.h"
 
 namespace cmudb {
 
+// snapshot of the buffer pool counters
+struct BufferPoolStats {
+  uint64_t hits = 0;             // FetchPage found the page in the pool
+  uint64_t misses = 0;           // FetchPage had to read the page
+  uint64_t evictions = 0;        // frames taken from another page
+  uint64_t dirty_writebacks = 0; // evictions which had to write back first
+  uint64_t flushes = 0;          // pages written by FlushPage or the cleaner
+  uint64_t wal_waits = 0;        // writes which had to wait for the log
+  uint64_t eviction_wal_waits = 0; // evictions which had to wait for the log
+  uint64_t pin_wait_ns = 0;      // time FetchPage waited for frames in I/O
+  uint64_t prefetches = 0;       // read-ahead requests carried out
+  uint64_t pin_count_histogram[PIN_HISTOGRAM_SIZE] = {}; // 1, 2, 3-4, 5-8, 9+
+};
+
 class BufferPoolManager {
 public:
   BufferPoolManager(size_t pool_size, DiskManager *disk_manager,
-                    LogManager *log_manager = nullptr);
+                    LogManager *log_manager = nullptr,
+                    size_t num_shards = 1,
+                    ReplacerType replacer_type = ReplacerType::LRU);
 
   ~BufferPoolManager();
 
+  // shards for a pool of pool_size frames: one per hardware thread, as long
+  // as each gets SHARD_MIN_FRAMES frames
+  static size_t DefaultNumShards(size_t pool_size);
+
   // disable copy
   BufferPoolManager(BufferPoolManager const &) = delete;
   BufferPoolManager &operator=(BufferPoolManager const &) = delete;
 
-  Page *FetchPage(page_id_t page_id);
+  // ring: access strategy of a bulk read, see scan_ring.h
+  Page *FetchPage(page_id_t page_id, ScanRing *ring = nullptr);
 
   bool UnpinPage(page_id_t page_id, bool is_dirty);
 
+  // false if the page is not in the pool or its write fails
   bool FlushPage(page_id_t page_id);
 
-  Page *NewPage(page_id_t &page_id);
+  // write back every dirty page, then force them to disk as a checkpoint
+  void FlushAllPages();
+
+  // extent: pages of a table or index, see disk_manager.h
+  Page *NewPage(page_id_t &page_id, ScanRing *ring = nullptr,
+                Extent *extent = nullptr);
 
   bool DeletePage(page_id_t page_id);
 
+  // pin and latch in one go, the guard undoes both, see page_guard.h
+  // an empty guard is returned if all the frames are pinned
+  ReadPageGuard FetchPageRead(page_id_t page_id, ScanRing *ring = nullptr);
+
+  WritePageGuard FetchPageWrite(page_id_t page_id, ScanRing *ring = nullptr);
+
+  WritePageGuard NewPageWrite(page_id_t &page_id, ScanRing *ring = nullptr,
+                              Extent *extent = nullptr);
+
+  // the page ids an extent did not hand out are free again
+  inline void ReleaseExtent(Extent *extent) {
+    disk_manager_->ReleaseExtent(extent);
+  }
+
+  // asynchronously load page_id and the depth - 1 pages after it, next
+  // returns the page following a loaded page, or INVALID_PAGE_ID. With the
+  // ring of the scan, the pages are loaded into its frames, at most half of
+  // them ahead
+  void PrefetchPage(page_id_t page_id, size_t depth = 1,
+                    std::function<page_id_t(Page *)> next = nullptr,
+                    ScanRing *ring = nullptr);
+
+  // grow or shrink the pool to pool_size frames, at least one per shard
+  bool Resize(size_t pool_size);
+
+  inline size_t GetPoolSize() const { return pool_size_; }
+
+  inline size_t GetNumShards() const { return num_shards_; }
+
+  inline size_t GetNumDirty() const { return num_dirty_; }
+
+  // bytes of memory taken by the frames, whether in use or not
+  inline size_t GetFrameMemory() const { return arena_.GetReservedBytes(); }
+
+  // counters of one shard, or of the whole pool
+  BufferPoolStats GetStats(size_t shard_id) const;
+  BufferPoolStats GetStats() const;
+  // not atomic with respect to concurrent updates
+  void ResetStats();
+
+  // spawn the page cleaner, max_write_rate is in pages per second
+  void RunPageCleaner(double low_watermark = 0.1, double high_watermark = 0.5,
+                      size_t max_write_rate = 1000);
+  void StopPageCleaner();
+
   // for debug
   bool Check() const {
-    //std::cerr << "table: " << page_table_->Size() << " replacer: "
-    //          << replacer_->Size() << std::endl;
     // +1 for header_page, in the test environment,
     // header_page is out the replacer's control
-    return page_table_->Size() == (replacer_->Size() + 1);
+    size_t table_size = 0, replacer_size = 0;
+    for (size_t i = 0; i < num_shards_; ++i) {
+      table_size += shards_[i].page_table_->Size();
+      replacer_size += shards_[i].replacer_->Size();
+    }
+    return table_size == (replacer_size + 1);
   }
 
 private:
-  size_t pool_size_;                         // number of pages in buffer pool
-  Page *pages_;                              // array of pages
+  // counters of one shard, a full cache line on both sides keeps them away
+  // from the shard latch and from the counters of the next shard
+  struct ShardStats {
+    char pad_front_[CACHE_LINE_SIZE];
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> evictions_{0};
+    std::atomic<uint64_t> dirty_writebacks_{0};
+    std::atomic<uint64_t> flushes_{0};
+    std::atomic<uint64_t> wal_waits_{0};
+    std::atomic<uint64_t> eviction_wal_waits_{0};
+    std::atomic<uint64_t> pin_wait_ns_{0};
+    std::atomic<uint64_t> prefetches_{0};
+    std::atomic<uint64_t> pin_count_histogram_[PIN_HISTOGRAM_SIZE];
+    char pad_back_[CACHE_LINE_SIZE];
+
+    ShardStats() { Reset(); }
+    void Reset();
+    void AddTo(BufferPoolStats &stats) const;
+  };
+
+  // one partition of the buffer pool
+  struct Shard {
+    HashTable<page_id_t, Page *> *page_table_; // pages currently in this shard
+    Replacer<Page *> *replacer_;               // unpinned pages for replacement
+    std::list<Page *> *free_list_;             // free frames of this shard
+    std::unordered_set<Page *> frames_;        // all frames of this shard
+    size_t num_retiring_ = 0;                  // frames to release on unpin
+    std::mutex latch_;                         // protect this shard only
+    std::condition_variable cv_;               // frame state changes
+    ShardStats stats_;                         // no latch needed
+  };
+
+  // one read-ahead request
+  struct PrefetchRequest {
+    page_id_t page_id;
+    size_t depth;
+    std::function<page_id_t(Page *)> next;
+    ScanRing *ring;
+  };
+
+  // the shard which is responsible for page_id
+  inline Shard &GetShard(page_id_t page_id) {
+    return shards_[std::hash<page_id_t>()(page_id) % num_shards_];
+  }
+
+  // FetchPage, the replacer is not told about the access if !record_access
+  Page *LoadPage(page_id_t page_id, ScanRing *ring, bool record_access);
+
+  // find a frame for replacement, from the ring, free list, then replacer
+  // should be called when holding the shard latch
+  bool GetVictim(Shard &shard, Page *&page, ScanRing *ring);
+
+  // pick a victim from the replacer, avoiding to wait for the log
+  // should be called when holding the shard latch
+  bool GetDurableVictim(Shard &shard, Page *&page);
+
+  // take back an unpinned frame previously loaded through ring
+  bool RecycleRingFrame(Shard &shard, Page *&page, ScanRing *ring);
+
+  // frames a ring may hold in this pool
+  inline size_t GetRingLimit(const ScanRing *ring) const {
+    return std::min(ring->capacity_, std::max(pool_size_ / 8, size_t(4)));
+  }
+
+  // a read-ahead request using ring is done or dropped
+  static void ReleaseRing(ScanRing *ring);
+
+  // remember that page is loaded with page_id through ring
+  void TrackRingFrame(Shard &shard, Page *page, page_id_t page_id,
+                      ScanRing *ring);
+
+  // pick a victim, write it back if dirty and map it to page_id, the frame
+  // is returned pinned and in LOADING state
+  bool AcquireFrame(Shard &shard, page_id_t page_id, Page *&page,
+                    std::unique_lock<std::mutex> &lock,
+                    ScanRing *ring = nullptr);
+
+  // free the frame of page, whose read failed
+  void DropFrame(Shard &shard, Page *page);
+  // wait until the state of page changes
+  void WaitForFrame(Shard &shard, Page *page,
+                    std::unique_lock<std::mutex> &lock);
+
+  // WAL: log records up to lsn must be on disk before the page, return true
+  // if it had to wait
+  bool FlushLog(lsn_t lsn);
+
+  // count one more pin of a page which is now pinned pin_count times
+  void CountPin(Shard &shard, int pin_count);
+
+  // write a snapshot of resident pages of shard, the shard latch is released
+  // during the writes and held again on return. Several pages are written
+  // with one batch of asynchronous I/O. Pages whose write fails are left
+  // dirty, false if there is any
+  bool WriteBack(Shard &shard, std::vector<Page *> &pages,
+                 std::unique_lock<std::mutex> &lock);
+  inline bool WriteBack(Shard &shard, Page *page,
+                        std::unique_lock<std::mutex> &lock) {
+    std::vector<Page *> pages{page};
+    return WriteBack(shard, pages, lock);
+  }
+
+  // read-ahead of the pages from page_id to page_id + depth - 1 which are not
+  // in the pool yet, with one batch of asynchronous reads
+  void PrefetchRange(page_id_t page_id, size_t depth, ScanRing *ring);
+
+  // read page_id into its frame, on a sequential miss together with the
+  // pages after it which are not in the pool yet. The ones after it which are
+  // corrupted are dropped, false if page_id is
+  // should be called without holding any shard latch
+  bool ReadMiss(page_id_t page_id, Page *page, ScanRing *ring);
+
+  // number of frames of shard i in a pool of pool_size frames
+  inline size_t GetShardSize(size_t i, size_t pool_size) const {
+    return pool_size / num_shards_ + (i < pool_size % num_shards_ ? 1 : 0);
+  }
+
+  // a frame with memory from the arena, without in mapped mode
+  Page *CreateFrame();
+  void DestroyFrame(Page *page);
+
+  // release free or unpinned frames until the shard owes none, dirty pages
+  // are written back first
+  // should be called when holding the shard latch
+  void RetireFrames(Shard &shard, std::unique_lock<std::mutex> &lock);
+
+  // keep num_dirty_ in sync, should be called when holding the shard latch
+  void SetDirty(Page *page, bool is_dirty);
+
+  // write at most budget dirty pages from the cold end of the replacers
+  size_t CleanPages(size_t budget);
+
+  void StopPrefetchThread();
+
+  std::atomic<size_t> pool_size_;            // number of pages in buffer pool
+  size_t num_shards_;                        // number of shards
+  std::mutex resize_latch_;                  // one Resize at a time
+  Shard *shards_;                            // array of shards
   DiskManager *disk_manager_;
   LogManager *log_manager_;
+  FrameArena arena_;                         // memory of the frames
+  std::atomic<size_t> num_dirty_;            // number of dirty frames
 
-  HashTable<page_id_t, Page *> *page_table_; // to keep track of pages that are currently in memory
-
-  Replacer<Page *> *replacer_;               // to find an unpinned page for replacement
-  std::list<Page *> *free_list_;             // to find a free page for replacement
+  // page cleaner
+  std::atomic<bool> enable_cleaner_;
+  std::thread *cleaner_thread_;
+  std::mutex cleaner_latch_;
+  std::condition_variable cleaner_cv_;       // kicked by dirty evictions
+  double low_watermark_;
+  double high_watermark_;
+  size_t max_write_rate_;
 
-  std::mutex latch_;                         // to protect shared data structure
+  // read-ahead
+  std::thread *prefetch_thread_;
+  std::atomic<page_id_t> last_miss_;         // last page read on a miss
+  std::mutex prefetch_latch_;                // protect the members below
+  std::condition_variable prefetch_cv_;
+  std::deque<PrefetchRequest> prefetch_queue_;
+  bool stop_prefetch_;
 };
 
 } // namespace cmudb
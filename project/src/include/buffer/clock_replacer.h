@@ -0,0 +1,72 @@
+/**
+ * clock_replacer.h
+ *
+ * Functionality: CLOCK (second chance) approximation of LRU. Every value in
+ * the replacer owns a slot with a reference bit and an evictable bit. Insert
+ * sets both bits, it neither allocates nor reorders anything while the value
+ * keeps its slot. Victim sweeps a hand over the slots, clearing reference
+ * bits until it meets an evictable slot whose reference bit is already clear.
+ *
+ * Erase and Victim release the slot of the value to a free list, the hand
+ * skips free slots and Insert reuses them before appending a new one. So
+ * slots_ only grows to the most values held at once, e.g. the frames retired
+ * by a shrinking buffer pool leave no dead slots behind.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/rwmutex.h"
+
+namespace cmudb {
+
+template <typename T> class ClockReplacer : public Replacer<T> {
+  struct slot {
+    explicit slot(const T &d) : data(d) {}
+    T data;
+    std::atomic<bool> ref{false};       // recently unpinned
+    std::atomic<bool> evictable{false}; // currently in the replacer
+  };
+
+public:
+  ClockReplacer();
+
+  ~ClockReplacer();
+
+  // disable copy
+  ClockReplacer(const ClockReplacer &) = delete;
+  ClockReplacer &operator=(const ClockReplacer &) = delete;
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+  size_t PeekVictims(std::vector<T> &values, size_t max);
+
+private:
+  // position of a new slot for value, a free one first, under the write lock
+  size_t NewSlot(const T &value);
+
+  // give the slot at pos back to the free list, under the write lock
+  void ReleaseSlot(size_t pos);
+
+  RWMutex index_latch_;                    // protect index_ & slots_ growth
+  std::unordered_map<T, size_t> index_;    // value -> position in slots_
+  std::deque<slot> slots_;                 // never shrink, stable addresses
+  std::vector<size_t> free_slots_;         // released positions in slots_
+  std::mutex hand_latch_;                  // one sweeper at a time
+  size_t hand_;                            // next slot to inspect
+  std::atomic<size_t> size_;               // number of evictable slots
+};
+
+} // namespace cmudb
@@ -0,0 +1,64 @@
+/**
+ * frame_arena.h
+ *
+ * Functionality: the memory of the buffer pool frames. Frames are carved out
+ * of anonymous mappings, so every frame is aligned to PAGE_SIZE and can be
+ * read and written with direct I/O without a bounce buffer. The pool maps
+ * all of its frames at once, and one more chunk each time it grows, so the
+ * memory it uses is what it reserved and not what the allocator made of it.
+ *
+ * With huge pages, chunks are rounded up to HUGE_PAGE_SIZE and taken from the
+ * reserved huge pages if there are any, else transparent huge pages are asked
+ * for, which cuts the TLB misses of a large pool. The frames rounding adds are
+ * free for the next growth.
+ *
+ * Freed frames are kept for reuse, the memory is only given back when the
+ * arena is destroyed.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+class FrameArena {
+public:
+  explicit FrameArena(bool huge_pages = false);
+  ~FrameArena();
+
+  // disable copy
+  FrameArena(FrameArena const &) = delete;
+  FrameArena &operator=(FrameArena const &) = delete;
+
+  // make sure num_frames frames can be allocated, false if out of memory
+  bool Reserve(size_t num_frames);
+  // a frame of PAGE_SIZE bytes, nullptr if none is reserved
+  char *Allocate();
+  void Free(char *frame);
+
+  // bytes mapped so far, in use or not
+  size_t GetReservedBytes() const;
+  size_t GetNumFreeFrames() const;
+  // at least one chunk is backed by reserved huge pages
+  bool UsesHugePages() const;
+
+private:
+  struct Chunk {
+    char *memory;
+    size_t size;
+  };
+
+  bool huge_pages_;
+  mutable std::mutex latch_;
+  std::vector<Chunk> chunks_;
+  std::vector<char *> free_frames_;
+  size_t reserved_bytes_;
+  bool hugetlb_;
+};
+
+} // namespace cmudb
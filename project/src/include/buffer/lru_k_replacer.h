@@ -0,0 +1,78 @@
+/**
+ * lru_k_replacer.h
+ *
+ * Functionality: LRU-K replacement (O'Neil et al.). The last K access times
+ * of every value are kept, and the victim is the evictable value whose K-th
+ * most recent access is the oldest, i.e. the one with the largest backward
+ * K-distance. Values with fewer than K accesses have an infinite distance and
+ * are evicted first, oldest first access first, so pages touched once by a
+ * sequential scan do not push out frequently used pages.
+ *
+ * Time is a logical clock advanced by every access. An access that happens
+ * within correlated_period ticks of the previous access to the same value is
+ * correlated with it (e.g. repeated pins of one page by one operation) and
+ * only refreshes the latest timestamp instead of adding history.
+ *
+ * Accesses are reported through RecordAccess, a value that is inserted
+ * without any recorded access gets one at insertion time. History is dropped
+ * when the value is evicted or starts holding another page.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+#include "buffer/replacer.h"
+
+namespace cmudb {
+
+template <typename T> class LRUKReplacer : public Replacer<T> {
+  struct entry {
+    page_id_t page_id = INVALID_PAGE_ID;
+    std::deque<uint64_t> history; // most recent access first, at most K
+    bool evictable = false;
+  };
+
+public:
+  explicit LRUKReplacer(size_t k = 2, uint64_t correlated_period = 1);
+
+  ~LRUKReplacer();
+
+  // disable copy
+  LRUKReplacer(const LRUKReplacer &) = delete;
+  LRUKReplacer &operator=(const LRUKReplacer &) = delete;
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+  void RecordAccess(const T &value, page_id_t page_id);
+
+  size_t PeekVictims(std::vector<T> &values, size_t max);
+
+  bool Evict(const T &value);
+
+  void Discard(const T &value);
+
+private:
+  // should be called when holding the lock
+  void Access(entry &e);
+  // true if a should be evicted before b
+  bool Before(const entry &a, const entry &b) const;
+
+  std::mutex mutex_;
+  size_t k_;                           // number of accesses remembered
+  uint64_t correlated_period_;         // in ticks of the logical clock
+  uint64_t current_;                   // logical clock
+  size_t size_;                        // number of evictable values
+  std::unordered_map<T, entry> table_;
+};
+
+} // namespace cmudb
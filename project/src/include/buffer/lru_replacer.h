@@ -43,6 +43,8 @@ public:
 
   size_t Size();
 
+  size_t PeekVictims(std::vector<T> &values, size_t max);
+
 private:
   // invariant check
   void check();
@@ -0,0 +1,89 @@
+/**
+ * page_guard.h
+ *
+ * Functionality: RAII handles of a pinned and latched page, returned by the
+ * FetchPageRead/FetchPageWrite/NewPageWrite methods of BufferPoolManager. A
+ * guard unlatches and unpins its page exactly once: on Release, when another
+ * guard is moved into it, or on destruction. Guards are move-only, so a page
+ * is handed along (e.g. from parent to child while crabbing down a tree)
+ * without going back to the buffer pool.
+ *
+ * A write guard remembers whether the page was modified and passes it to
+ * UnpinPage, call MarkDirty after changing the page.
+ */
+
+#pragma once
+
+#include "page/page.h"
+
+namespace cmudb {
+
+class BufferPoolManager;
+
+class ReadPageGuard {
+public:
+  // an empty guard
+  ReadPageGuard() = default;
+  // take over page, which is pinned and read latched by the caller
+  ReadPageGuard(BufferPoolManager *buffer_pool_manager, Page *page);
+
+  ~ReadPageGuard() { Release(); }
+
+  // move only
+  ReadPageGuard(ReadPageGuard &&other) noexcept;
+  ReadPageGuard &operator=(ReadPageGuard &&other) noexcept;
+  ReadPageGuard(ReadPageGuard const &) = delete;
+  ReadPageGuard &operator=(ReadPageGuard const &) = delete;
+
+  // unlatch and unpin now, the guard becomes empty
+  void Release();
+
+  inline bool IsValid() const { return page_ != nullptr; }
+
+  inline Page *GetPage() const { return page_; }
+
+  inline page_id_t GetPageId() const { return page_->GetPageId(); }
+
+  inline const char *GetData() const { return page_->GetData(); }
+
+private:
+  BufferPoolManager *buffer_pool_manager_ = nullptr;
+  Page *page_ = nullptr;
+};
+
+class WritePageGuard {
+public:
+  // an empty guard
+  WritePageGuard() = default;
+  // take over page, which is pinned and write latched by the caller
+  WritePageGuard(BufferPoolManager *buffer_pool_manager, Page *page);
+
+  ~WritePageGuard() { Release(); }
+
+  // move only
+  WritePageGuard(WritePageGuard &&other) noexcept;
+  WritePageGuard &operator=(WritePageGuard &&other) noexcept;
+  WritePageGuard(WritePageGuard const &) = delete;
+  WritePageGuard &operator=(WritePageGuard const &) = delete;
+
+  // unlatch and unpin now, the guard becomes empty
+  void Release();
+
+  // the page is unpinned as dirty
+  inline void MarkDirty() { is_dirty_ = true; }
+
+  inline bool IsValid() const { return page_ != nullptr; }
+
+  inline Page *GetPage() const { return page_; }
+
+  inline page_id_t GetPageId() const { return page_->GetPageId(); }
+
+  inline char *GetData() const { return page_->GetData(); }
+
+private:
+  BufferPoolManager *buffer_pool_manager_ = nullptr;
+  Page *page_ = nullptr;
+  bool is_dirty_ = false;
+};
+
+} // namespace cmudb
@@ -6,9 +6,15 @@
 #pragma once
 
 #include <cstdlib>
+#include <vector>
+
+#include "common/config.h"
 
 namespace cmudb {
 
+// replacement policy of the buffer pool
+enum class ReplacerType { LRU = 0, CLOCK, LRUK, ARC };
+
 template <typename T> class Replacer {
 public:
   Replacer() {}
@@ -17,6 +23,18 @@ public:
   virtual bool Victim(T &value) = 0;
   virtual bool Erase(const T &value) = 0;
   virtual size_t Size() = 0;
+  // append at most max values in the order they would be victimized,
+  // without removing them, return the number of values appended
+  virtual size_t PeekVictims(std::vector<T> &values, size_t max) = 0;
+  // value is pinned for page_id, history based policies override this
+  virtual void RecordAccess(const T &value, page_id_t page_id) {}
+  // evict value, picked by the caller from PeekVictims, return false if it
+  // is not evictable. Policies which remember their victims override this
+  virtual bool Evict(const T &value) { return Erase(value); }
+  // value is gone for good, drop whatever is remembered about it
+  virtual void Discard(const T &value) { Erase(value); }
+  // the number of values to manage changed, size aware policies override this
+  virtual void SetCapacity(size_t capacity) {}
 };
 
 } // namespace cmudb
@@ -0,0 +1,70 @@
+/**
+ * scan_ring.h
+ *
+ * Functionality: access strategy for bulk reads and bulk inserts. A scan
+ * passing a ring to the buffer pool recycles a small private set of frames
+ * on misses instead of taking victims from the shared replacer, so one pass
+ * over a large table does not evict the working set of everybody else.
+ *
+ * The ring only remembers which frames it loaded. A frame is recycled when it
+ * still holds the page the ring put there and nobody has it pinned, otherwise
+ * the buffer pool picks a regular victim and the ring takes that frame over.
+ * Pages found in the pool are used as is and never join the ring.
+ *
+ * A ring belongs to one scan and must not be shared between scans. The
+ * read-ahead of the scan loads its pages through the ring too, from the I/O
+ * thread of the buffer pool, so the ring has a latch of its own. It must not
+ * go away before the read-ahead requests using it: the destructor waits for
+ * them.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+class Page;
+
+class ScanRing {
+  friend class BufferPoolManager;
+
+  struct slot {
+    Page *page;        // frame loaded through this ring
+    page_id_t page_id; // page the ring loaded into it
+    size_t shard;      // shard owning the frame
+  };
+
+public:
+  explicit ScanRing(size_t capacity = SCAN_RING_SIZE)
+      : capacity_(capacity == 0 ? 1 : capacity), hand_(0), pending_(0) {}
+  ~ScanRing() {
+    std::unique_lock<std::mutex> lock(latch_);
+    cv_.wait(lock, [this]() { return pending_ == 0; });
+  }
+
+  // disable copy
+  ScanRing(const ScanRing &) = delete;
+  ScanRing &operator=(const ScanRing &) = delete;
+
+  inline size_t GetCapacity() const { return capacity_; }
+
+  inline size_t Size() const {
+    std::lock_guard<std::mutex> lock(latch_);
+    return slots_.size();
+  }
+
+private:
+  size_t capacity_;
+  mutable std::mutex latch_; // protect the members below
+  std::condition_variable cv_;
+  size_t hand_;              // oldest slot, next to recycle
+  std::vector<slot> slots_;
+  size_t pending_;           // read-ahead requests queued or running
+};
+
+} // namespace cmudb
@@ -8,23 +8,48 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 
 namespace cmudb {
 
 extern std::chrono::duration<long long int> LOG_TIMEOUT;
 
+extern std::chrono::milliseconds CLEANER_TIMEOUT;
+
+extern std::atomic<size_t> PREFETCH_WINDOW;
+
 extern std::atomic<bool> ENABLE_LOGGING;
 
+extern std::atomic<bool> ENABLE_HUGE_PAGES;
+
 #define INVALID_PAGE_ID  (-1) // representing an invalid page id
 #define INVALID_TXN_ID   (-1) // representing an invalid txn id
 #define INVALID_LSN      (-1) // representing an invalid lsn
 #define HEADER_PAGE_ID   0    // the header page id
 #define PAGE_SIZE        4096 // size of a data page in byte
+#define PAGE_CHECKSUM_SIZE 4  // checksum at the end of a page, see DiskManager
+#define PAGE_DATA_SIZE   (PAGE_SIZE - PAGE_CHECKSUM_SIZE) // left to page layouts
 
-#define LOG_BUFFER_SIZE  ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE) // size of a log buffer in byte
+// size of a log buffer in byte. It does not follow the runtime pool size:
+// every flush writes a whole buffer and recovery reads the log back in
+// chunks of this size, so it is part of the log format
+#define LOG_BUFFER_SIZE  (11 * PAGE_SIZE)
 #define BUCKET_SIZE      50   // size of extendible hash bucket
-#define BUFFER_POOL_SIZE 10   // size of buffer pool
+#define BUFFER_POOL_SIZE 10   // default size of buffer pool
+#define SHARD_MIN_FRAMES 16   // frames of a buffer pool shard at least
+#define SCAN_RING_SIZE   32   // max number of frames recycled by a scan
+#define CACHE_LINE_SIZE  64   // padding against false sharing
+#define PIN_HISTOGRAM_SIZE 5  // buckets of pin counts, powers of two
+#define VICTIM_WINDOW    8    // victims looked at for a log-free eviction
+#define IO_QUEUE_DEPTH   64   // asynchronous page I/O in flight at most
+#define IO_POOL_THREADS  8    // threads of the fallback I/O engine
+#define EXTENT_SIZE      64   // pages reserved at once by a table or index
+#define READ_AHEAD_SIZE  16   // pages read at once on a sequential miss
+#define CHECKSUM_SAMPLE_RATE 16 // sampled checksums verify one read in so many
+#define SEGMENT_SIZE     (1 << 30) // bytes of a db segment file, see DiskManager
+#define LOG_SEGMENT_SIZE (64 << 20) // bytes of a log file before the next one
+#define HUGE_PAGE_SIZE   (2 << 20) // frame arena chunks round up to this
 
 typedef int32_t page_id_t;    // page id type
 typedef int32_t txn_id_t;     // transaction id type
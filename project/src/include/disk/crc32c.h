@@ -0,0 +1,26 @@
+/**
+ * crc32c.h
+ *
+ * CRC32C (Castagnoli) checksums of pages. x86 processors with SSE4.2 compute
+ * it with the crc32 instruction, 8 bytes at a time, others look it up in a
+ * table one byte at a time. Both give the same value.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cmudb {
+
+class CRC32C {
+public:
+  // the checksum of size bytes of data, with the crc32 instruction if any
+  static uint32_t Compute(const char *data, size_t size);
+  // the checksum computed from the table, whatever the processor
+  static uint32_t ComputeWithTable(const char *data, size_t size);
+  // true if Compute uses the crc32 instruction
+  static bool HasHardware();
+};
+
+} // namespace cmudb
@@ -5,31 +5,211 @@
  * database. It also performs read and write of pages to and from disk, and
  * provides a logical file layer within the context of a database management
  * system.
+ *
+ * Both files are accessed through file descriptors with positional reads and
+ * writes, so pages can be read and written by many threads at once. Writes
+ * are not durable until SyncPages (checkpoint) or WriteLog (commit) returns.
+ * Pages can also be read and written asynchronously in batches, through the
+ * I/O engine which is started on first use.
+ *
+ * The db file starts with a file header, and every PAGES_PER_MAP pages are
+ * preceded by a map page, a bitmap of the allocated ones:
+ *  ----------------------------------------------------------------------
+ * | FILE HEADER | MAP(0) | PAGE(0) | ... | PAGE(n - 1) | MAP(1) | PAGE(n) | ...
+ *  ----------------------------------------------------------------------
+ * Page ids do not count the header and map pages. The maps are kept in memory,
+ * the dirty ones are written with the file header by SyncPages (checkpoint)
+ * and on close, so allocating a page writes nothing. They are durable once
+ * SyncPages returns. A crash loses the allocations and deallocations made
+ * since: the pages allocated meanwhile are allocated again by recovery when
+ * it redoes their NEWPAGE log records, see ReservePage. Without the log,
+ * their ids may be handed out again.
+ *
+ * A db file of the layout from before the file header, page N at N * PAGE_SIZE
+ * and the header page of the tables first, is opened as it is: its pages are
+ * neither moved nor checksummed, and nothing but the pages is written. With
+ * no map to tell, every page in the file is in use when it is opened, the
+ * pages deallocated are only reused until it is closed. Any other file which
+ * does not start with the file header is not opened.
+ *
+ * A table or index allocates through an Extent, a run of EXTENT_SIZE free page
+ * ids reserved for it and preallocated in the file, so that its pages are
+ * contiguous on disk and scans read them sequentially. The map in the file
+ * has the whole extent allocated once it is written. The ids an extent did
+ * not hand out are free again once it is released or on close, a crash after
+ * a SyncPages leaks them.
+ *
+ * A db file opened read only, e.g. by a reporting replica, is mapped into
+ * memory. The buffer pool points its pages into the mapping instead of copying
+ * them into frames. Writes, allocations and log records are rejected.
+ *
+ * A db file created with compression keeps its pages LZ compressed in slots
+ * of whole sectors (PAGE_SIZE / 8) instead of at fixed offsets, the header and
+ * map pages stay where they are. The slot of each page is recorded in a slot
+ * table file next to the db file, written by SyncPages and on close. Slots
+ * freed by rewrites are only reused once the table no longer points to them,
+ * so the pages as of the last SyncPages survive a crash. Compressed files are
+ * never mapped, and pages are read and written one by one.
+ * NOTE: nothing syncs the slot table on its own. A crash takes a compressed
+ * file back to its last SyncPages (e.g. BufferPoolManager::FlushAllPages),
+ * every page written since is lost and has to be redone from the log, so
+ * its users must checkpoint regularly.
+ *
+ * The last PAGE_CHECKSUM_SIZE bytes of every page hold the CRC32C of the
+ * others, set when the page is written and checked when it is read back, so
+ * that a torn or decayed page is reported instead of used: the read fails.
+ * Page layouts stop at PAGE_DATA_SIZE. A page of zeros, or past the end of
+ * file, is one never written and passes if it is allocated. Reads cut short
+ * by the end of file or failing with an I/O error fail too. The file header
+ * tells whether the file has checksums, the ones created before there were
+ * any are neither stamped nor verified.
+ *
+ * A db file created with a segment size is cut into segment files of that
+ * size, db_file, db_file.1, db_file.2... holding the layout above one after
+ * the other. A missing segment reads as zeros, so Truncate unlinks every
+ * segment without a page in use, not only the last ones. Segmented files are
+ * not mapped. The log rolls over to a new file once the current one reaches
+ * the log segment size, each named after the log offset it starts at:
+ * db.log, db.log.67108864... DiscardLog unlinks the ones no longer needed.
+ *
+ * With direct I/O, the db files are read and written with O_DIRECT, bypassing
+ * the kernel page cache, so the buffer pool is the only cache of the pages.
+ * Buffers not aligned to PAGE_SIZE go through an aligned copy, the frames of
+ * the buffer pool are aligned and do not. If the file system does not support
+ * it, or the file is compressed, the files are used through the page cache.
+ * The log is always written through the page cache.
  */
 
 #pragma once
 #include <atomic>
-#include <fstream>
+#include <condition_variable>
+#include <functional>
 #include <future>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "common/config.h"
+#include "disk/io_engine.h"
 
 namespace cmudb {
 
+#define PAGES_PER_MAP (PAGE_SIZE * 8) // pages tracked by one map page
+#define SECTOR_SIZE (PAGE_SIZE / 8)   // unit of compressed page slots
+
+// page ids reserved for one table or index, only the disk manager changes it
+struct Extent {
+  page_id_t next_page_id = INVALID_PAGE_ID; // next page id to hand out
+  page_id_t end_page_id = INVALID_PAGE_ID;  // one past the last reserved id
+};
+
+// what compression did so far, see GetCompressionStats
+struct CompressionStats {
+  uint64_t pages_written = 0;
+  uint64_t bytes_in = 0;  // page bytes compressed
+  uint64_t bytes_out = 0; // bytes written to the slots
+  uint64_t compress_ns = 0;
+  uint64_t pages_read = 0; // pages decompressed
+  uint64_t decompress_ns = 0;
+};
+
+// how often reads verify the page checksum
+enum class ChecksumMode { ALWAYS = 0, SAMPLED, OFF };
+
+// one page of an asynchronous batch, see IORequest for the callback. The
+// checksum of a write is set in its data, a read which fails it is not ok
+struct PageIORequest {
+  bool is_write;
+  page_id_t page_id;
+  char *data;
+  std::function<void(bool ok)> callback;
+};
+
 class DiskManager {
 public:
-  DiskManager(const std::string &db_file);
+  // compress: compress the pages of a new db file. segment_size: cut a new
+  // db file into files of this many bytes, a multiple of PAGE_SIZE, e.g.
+  // SEGMENT_SIZE. An existing file keeps the format it was created with.
+  // direct_io: bypass the page cache for the db files
+  DiskManager(const std::string &db_file,
+              IOEngineType io_engine_type = IOEngineType::AUTO,
+              bool read_only = false, bool compress = false,
+              size_t segment_size = 0, bool direct_io = false);
   ~DiskManager();
 
-  void WritePage(page_id_t page_id, const char *page_data);
-  void ReadPage(page_id_t page_id, char *page_data);
+  // false if the write is rejected or fails, the page is not written then
+  bool WritePage(page_id_t page_id, const char *page_data);
+  // false if the page read is corrupted, see GetNumChecksumFailures
+  bool ReadPage(page_id_t page_id, char *page_data);
+  // read count consecutive pages, page i into buffers[i]. false if any is
+  // corrupted, valid[i] tells whether page i is if valid is not nullptr
+  bool ReadPages(page_id_t first_page_id, size_t count, char **buffers,
+                 bool *valid = nullptr);
+  // force written pages to disk, e.g. at a checkpoint
+  void SyncPages();
+
+  inline bool IsReadOnly() const { return read_only_; }
+  inline bool IsCompressed() const { return compressed_; }
+  // the db files are opened with O_DIRECT
+  inline bool IsDirectIO() const { return direct_io_; }
+  // read only and not compressed: pages are reached through GetMappedPage
+  inline bool IsMapped() const {
+    return read_only_ && !compressed_ && segment_size_ == 0 && !direct_io_;
+  }
+  // bytes of each db file, 0 if the db is in a single file
+  inline size_t GetSegmentSize() const { return segment_size_; }
+  CompressionStats GetCompressionStats() const;
+  // SAMPLED verifies one read in CHECKSUM_SAMPLE_RATE
+  inline void SetChecksumMode(ChecksumMode mode) { checksum_mode_ = mode; }
+  inline ChecksumMode GetChecksumMode() const { return checksum_mode_; }
+  // pages carry a checksum, not in files created before there were any
+  inline bool HasChecksums() const { return checksums_; }
+  // the file has no file header and no maps, page N is at N * PAGE_SIZE
+  inline bool IsLegacyLayout() const { return legacy_; }
+  // pages read corrupted: not matching their checksum, or not decompressing
+  inline uint64_t GetNumChecksumFailures() const {
+    return checksum_failures_;
+  }
+  // read only: the page in the mapped file, a page past the end reads as
+  // zeros, nullptr if it is corrupted. The memory can not be written
+  char *GetMappedPage(page_id_t page_id);
+  // read only: ask the kernel to read the pages ahead of their access
+  void PrefetchMappedPages(page_id_t page_id, size_t num_pages);
+
+  // submit a batch of page reads and writes without waiting for them
+  void SubmitPageIO(std::vector<PageIORequest> &requests);
+  std::future<bool> ReadPageAsync(page_id_t page_id, char *page_data);
+  std::future<bool> WritePageAsync(page_id_t page_id, char *page_data);
+  // URING, or THREAD_POOL if io_uring is not available
+  IOEngineType GetIOEngineType();
 
   void WriteLog(char *log_data, int size);
-  bool ReadLog(char *log_data, int size, int offset);
+  bool ReadLog(char *log_data, int size, int64_t offset);
+  // the first log offset still on disk, where recovery starts
+  int64_t GetLogStart();
+  // the offset the next log write goes to
+  inline int64_t GetLogSize() { return log_size_; }
+  // unlink the log files which end at or before offset, e.g. once they are
+  // archived, never the one written. Return the number of files unlinked.
+  // Nothing recovery still needs may lie below offset: with a log manager,
+  // go through LogManager::DiscardLog which finds the offset from an LSN
+  int DiscardLog(int64_t offset);
+  // roll over to a new log file past this many bytes, 0 to never roll over
+  inline void SetLogSegmentSize(int64_t size) { log_segment_size_ = size; }
 
-  page_id_t AllocatePage();
+  // the lowest free page id, ids of deallocated pages are reused. With an
+  // extent, its next page id, a new extent is reserved when it runs out.
+  // INVALID_PAGE_ID if read only
+  page_id_t AllocatePage(Extent *extent = nullptr);
+  // give back the page ids the extent did not hand out
+  void ReleaseExtent(Extent *extent);
   void DeallocatePage(page_id_t page_id);
+  bool IsAllocated(page_id_t page_id);
+  // allocate exactly page_id if it is free, e.g. to redo a new page
+  void ReservePage(page_id_t page_id);
+  // offline, no page I/O may run meanwhile: shrink the file to the last
+  // allocated page, return the number of page ids in use from now on
+  page_id_t Truncate();
 
   int GetNumFlushes() const;
   bool GetFlushState() const;
@@ -37,14 +217,156 @@ public:
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
 private:
-  int GetFileSize(const std::string &name);
-  // stream to write log file
-  std::fstream log_io_;
+  int64_t GetFileSize(const std::string &name);
+  // open or create a file for reading and writing, -1 on failure
+  int OpenFile(const std::string &name, int flags);
+  // a page ending at end was written
+  void GrowTo(int64_t end);
+  // the descriptor of the db file holding offset, the offset in it and the
+  // bytes left in it from there. A missing segment is created if create, else
+  // -1 is returned
+  int SegmentFd(off_t offset, bool create, off_t *local, size_t *left);
+  std::string SegmentName(size_t index) const;
+  // blocking I/O at an offset of the db, split between the segments. A
+  // missing segment reads as zeros
+  bool CompleteDbIO(bool is_write, char *data, size_t size, off_t offset);
+  // the size of a segmented db, up to the last segment
+  // should be called before any segment is written
+  void ScanSegments(page_id_t next_page_id);
+  // offline: unlink the segments from end on, and those with no page in use
+  // should be called when holding map_latch_
+  void TruncateSegments(int64_t end);
+  // force the segments written to disk
+  bool SyncSegments();
+  // turn O_DIRECT on for the db files open, false if it is not supported
+  bool EnableDirectIO();
+  // find the log files, open them and the last one to append to
+  void OpenLog();
+  std::string LogSegmentName(int64_t start) const;
+  // read count pages from first_page_id on, adjacent in the same file.
+  // valid[i]: page i was read, or is zeros never written, see ReadRun
+  bool ReadRun(page_id_t first_page_id, size_t count, char **buffers,
+               bool *valid);
+  // a page read past the end of file, or in a missing segment, is allocated
+  // and was not cut off the file
+  bool NeverWritten(page_id_t page_id);
+  // set the checksum at the end of the page
+  static void SetChecksum(char *page_data);
+  // false if the page read does not match its checksum, as far as the
+  // checksum mode looks
+  bool VerifyChecksum(page_id_t page_id, const char *page_data);
+  // compressed: read and write a page through its slot
+  bool ReadCompressedPage(page_id_t page_id, char *page_data);
+  bool WriteCompressedPage(page_id_t page_id, const char *page_data);
+  // compressed: a free slot of num_sectors, beyond the end of file if none
+  // should be called when holding slot_latch_
+  uint32_t AllocateSlot(uint32_t num_sectors);
+  // compressed: free the sectors from begin to end, header and map pages
+  // between them are skipped
+  // should be called when holding slot_latch_
+  void FreeSectors(uint32_t begin, uint32_t end);
+  // compressed: the page is written elsewhere or deallocated
+  // should be called when holding slot_latch_
+  void ReleaseSlot(page_id_t page_id);
+  // compressed: read the slot table and find the free sectors
+  void LoadSlotTable();
+  // compressed: make the pages and maps durable, then the slot table pointing
+  // to the pages, and reuse the slots freed before
+  void SyncSlotTable();
+  // file offsets of a page and of a map page
+  off_t PageOffset(page_id_t page_id) const;
+  static off_t MapOffset(size_t map_index);
+  // the lowest free page id, the file grows if there is none
+  // should be called when holding map_latch_
+  page_id_t FindFreePage();
+  // reserve the lowest run of EXTENT_SIZE free page ids for extent
+  // should be called when holding map_latch_
+  void ReserveExtent(Extent *extent);
+  // page ids up to next_page_id are tracked from now on
+  // should be called when holding map_latch_
+  void GrowPageMap(page_id_t next_page_id);
+  // read the file header and the maps of an existing file, false if it is
+  // not a db file. A file of the legacy layout has all its pages allocated
+  bool LoadPageMap();
+  // LoadPageMap of a file without the file header, false if it is not one of
+  // the legacy layout either
+  bool LoadLegacyLayout(const char *first_page);
+  // write the dirty map pages and the file header, nothing if legacy_
+  // should be called when holding map_latch_
+  void WritePageMap();
+  IOEngine *GetIOEngine();
+  // read only: map the db file and a page of zeros
+  void MapFile();
+  // log a rejected write, true if read only
+  bool RejectWrite(const char *what) const;
+  // descriptor to append to the last log file
+  int log_fd_;
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
+  std::atomic<int64_t> log_size_;
+  std::atomic<int64_t> log_segment_size_;
+  // log files by their first offset, protected by log_latch_
+  struct LogSegment {
+    int64_t start;
+    int fd;
+  };
+  std::mutex log_latch_;
+  std::vector<LogSegment> log_segments_;
+  // descriptor to read and write the db file
+  int db_fd_;
   std::string file_name_;
-  std::atomic<page_id_t> next_page_id_;
+  // cached, grows with writes past the end
+  std::atomic<int64_t> db_size_;
+  // segmented: descriptors of the segments, -1 if not open, the first one is
+  // db_fd_. Protected by segment_latch_
+  size_t segment_size_;
+  std::mutex segment_latch_;
+  std::vector<int> segment_fds_;
+  // the db size in the file header, the file was cut if it is smaller
+  int64_t synced_size_;
+  // no file header nor maps, see IsLegacyLayout
+  bool legacy_;
+  bool direct_io_;
+  // read only: the db file mapped as it was opened, and a page of zeros
+  bool read_only_;
+  char *mapping_;
+  size_t mapping_size_;
+  char *zero_page_;
+  // compressed: slot of each page, protected by slot_latch_
+  struct PageSlot {
+    uint32_t sector; // first sector in the db file
+    uint32_t size;   // bytes in the slot, 0 if never written
+  };
+  bool compressed_;
+  int slots_fd_;
+  std::string slots_name_;
+  std::mutex slot_latch_;
+  std::vector<PageSlot> slots_;
+  std::vector<bool> unsynced_; // the slot is not in the slot table on disk
+  bool slots_dirty_;
+  std::vector<uint32_t> free_slots_[9]; // free slots by number of sectors
+  std::vector<PageSlot> pending_free_;  // still in the slot table on disk
+  // pages written to the slots they were given, the slot table waits for them
+  // to be done before it is synced, and new ones wait for the sync to start
+  std::condition_variable slot_cv_;
+  size_t slot_writes_;
+  size_t slot_syncs_;
+  uint32_t end_sector_;                 // no slot from here on
+  std::atomic<uint64_t> pages_written_, bytes_in_, bytes_out_, compress_ns_;
+  std::atomic<uint64_t> pages_read_, decompress_ns_;
+  bool checksums_;
+  std::atomic<ChecksumMode> checksum_mode_;
+  std::atomic<uint64_t> checksum_reads_, checksum_failures_;
+  IOEngineType io_engine_type_;
+  std::once_flag io_engine_flag_;
+  IOEngine *io_engine_;
+  // page allocation, protected by map_latch_
+  std::mutex map_latch_;
+  std::vector<uint8_t> page_map_; // bitmaps of all the map pages
+  std::vector<uint8_t> reserved_; // page ids held by extents, not written
+  std::vector<bool> map_dirty_;   // map pages not written yet
+  page_id_t first_free_;          // no free page id below
+  page_id_t next_page_id_;        // no allocated page id from here on
+
   int num_flushes_;
   bool flush_log_;
   std::future<void> *flush_log_f_;
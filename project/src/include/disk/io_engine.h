@@ -0,0 +1,48 @@
+/**
+ * io_engine.h
+ *
+ * Abstract class for asynchronous positional I/O. A batch of requests is
+ * handed over at once and each request completes through its callback, so
+ * one thread keeps many reads and writes in flight.
+ */
+
+#pragma once
+
+#include <functional>
+#include <sys/types.h>
+#include <vector>
+
+namespace cmudb {
+
+// backend of the asynchronous I/O, AUTO prefers io_uring
+enum class IOEngineType { AUTO = 0, URING, THREAD_POOL };
+
+struct IORequest {
+  bool is_write;
+  int fd;
+  char *data;
+  size_t size;
+  off_t offset;
+  // called once on an I/O thread, ok is false on an I/O error. It should be
+  // short and must not wait for other requests of the engine
+  std::function<void(bool ok)> callback;
+};
+
+class IOEngine {
+public:
+  IOEngine() {}
+  virtual ~IOEngine() {}
+  // queue the requests and return without waiting for them. The data of a
+  // request must stay valid until its callback runs
+  virtual void Submit(std::vector<IORequest> &requests) = 0;
+  virtual IOEngineType GetType() const = 0;
+
+  // URING may fall back to THREAD_POOL if the kernel does not allow io_uring
+  static IOEngine *Create(IOEngineType type, size_t queue_depth);
+
+  // blocking I/O of the whole request, a read past the end of the file is
+  // zero filled, return false on an I/O error
+  static bool Complete(const IORequest &request, size_t done = 0);
+};
+
+} // namespace cmudb
@@ -0,0 +1,34 @@
+/**
+ * lz_codec.h
+ *
+ * Small LZ77 codec for pages, in the spirit of LZ4: no entropy coding, so
+ * both directions are a few cycles per byte. The input is a sequence of
+ * literal runs, each followed by a match copying from up to 64 KB back:
+ *  ------------------------------------------------------------------------
+ * | TOKEN | LITERAL LENGTH+ | LITERALS | OFFSET (2) | MATCH LENGTH+ | ...
+ *  ------------------------------------------------------------------------
+ * The high nibble of the token is the literal length, the low one the match
+ * length minus 4, a nibble of 15 is continued by bytes which are added until
+ * one is below 255. The last run has literals only.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace cmudb {
+
+class LZCodec {
+public:
+  // compress size bytes of src into dst, return the compressed size, or 0 if
+  // it is not below capacity
+  static size_t Compress(const char *src, size_t size, char *dst,
+                         size_t capacity);
+
+  // decompress size bytes of src into exactly dst_size bytes of dst, false if
+  // src is corrupted
+  static bool Decompress(const char *src, size_t size, char *dst,
+                         size_t dst_size);
+};
+
+} // namespace cmudb
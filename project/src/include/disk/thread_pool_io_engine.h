@@ -0,0 +1,37 @@
+/**
+ * thread_pool_io_engine.h
+ *
+ * Fallback asynchronous I/O: a fixed pool of threads doing blocking pread and
+ * pwrite, so at most one request per thread is in flight.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "disk/io_engine.h"
+
+namespace cmudb {
+
+class ThreadPoolIOEngine : public IOEngine {
+public:
+  explicit ThreadPoolIOEngine(size_t num_threads);
+  // pending requests are completed first
+  ~ThreadPoolIOEngine();
+
+  void Submit(std::vector<IORequest> &requests) override;
+  IOEngineType GetType() const override { return IOEngineType::THREAD_POOL; }
+
+private:
+  std::mutex latch_;
+  std::condition_variable cv_;
+  std::deque<IORequest> queue_;
+  bool stop_;
+  std::vector<std::thread> threads_;
+};
+
+} // namespace cmudb
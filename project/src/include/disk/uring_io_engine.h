@@ -0,0 +1,78 @@
+/**
+ * uring_io_engine.h
+ *
+ * Asynchronous I/O through io_uring, driven by raw system calls. Submit fills
+ * the submission ring and enters the kernel once per batch, a reaper thread
+ * waits for completions and runs the callbacks. At most queue_depth requests
+ * are in flight, Submit blocks for a free slot beyond that.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <sys/uio.h>
+#include <thread>
+#include <vector>
+
+#include "disk/io_engine.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace cmudb {
+
+class UringIOEngine : public IOEngine {
+public:
+  explicit UringIOEngine(size_t queue_depth);
+  // waits for the requests in flight
+  ~UringIOEngine();
+
+  // false if the ring could not be set up, e.g. io_uring is not supported or
+  // not allowed in this process
+  bool IsValid() const { return ring_fd_ != -1; }
+
+  void Submit(std::vector<IORequest> &requests) override;
+  IOEngineType GetType() const override { return IOEngineType::URING; }
+
+private:
+  // a request owned by the ring, its address is the user data of the entry
+  struct Pending {
+    IORequest request;
+    struct iovec iov;
+  };
+
+  // append one entry to the submission ring
+  // should be called when holding latch_
+  void Push(uint8_t opcode, Pending *pending);
+
+  // let the kernel consume the last count entries, the ones it refuses are
+  // completed synchronously
+  // should be called when holding latch_
+  void Enter(unsigned count);
+
+  // body of the reaper thread
+  void Reap();
+
+  void Unmap();
+
+  int ring_fd_;
+  unsigned sq_entries_;
+  // rings shared with the kernel
+  void *sq_ring_;
+  size_t sq_ring_size_;
+  void *cq_ring_;
+  size_t cq_ring_size_;
+  io_uring_sqe *sqes_;
+  size_t sqes_size_;
+  unsigned *sq_head_, *sq_tail_, *sq_mask_, *sq_array_;
+  unsigned *cq_head_, *cq_tail_, *cq_mask_;
+  io_uring_cqe *cqes_;
+
+  std::mutex latch_;           // the submission side
+  std::condition_variable cv_; // requests complete
+  size_t in_flight_;           // requests submitted and not yet completed
+  std::thread *reaper_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,100 @@
+/*
+ * concurrent_extendible_hash.h : in-memory extendible hash table for
+ * concurrent access
+ *
+ * Functionality: same as ExtendibleHash, but threads working on different
+ * buckets do not serialize on one mutex. Each bucket is a flat array whose
+ * keys fill whole cache lines, guarded by its own latch. The directory is
+ * guarded by a reader-writer latch, it is only write locked to double or
+ * halve its size and to merge buckets. Splitting a bucket locks that bucket
+ * alone, the directory slots pointing to it are only ever changed by the
+ * holder of its latch.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rwmutex.h"
+#include "hash/extendible_hash.h"
+#include "hash/hash_table.h"
+
+namespace cmudb {
+
+// only support unique key
+template <typename K, typename V>
+class ConcurrentExtendibleHash : public HashTable<K, V> {
+  struct Bucket {
+    Bucket(size_t capacity, size_t i, int d)
+        : keys(new K[capacity]), values(new V[capacity]), id(i), depth(d) {}
+    std::mutex latch;                 // protects everything below
+    std::unique_ptr<K[]> keys;        // flat key array, cache line multiple
+    std::unique_ptr<V[]> values;      // value of keys[i] is values[i]
+    size_t count = 0;                 // used slots of keys and values
+    std::vector<std::pair<K, V>> overflow; // only when depth can not grow
+    size_t id;                        // hash prefix of the bucket
+    int depth;                        // local depth
+    char pad_[CACHE_LINE_SIZE];       // keep latches of buckets apart
+  };
+
+public:
+  // constructor
+  explicit ConcurrentExtendibleHash(size_t size);
+
+  ~ConcurrentExtendibleHash();
+
+  // disable copy
+  ConcurrentExtendibleHash(const ConcurrentExtendibleHash &) = delete;
+  ConcurrentExtendibleHash &
+  operator=(const ConcurrentExtendibleHash &) = delete;
+
+  // helper function to generate hash addressing
+  size_t HashKey(const K &key);
+
+  // helper function to get global & local depth
+  int GetGlobalDepth() const;
+
+  int GetLocalDepth(int bucket_id) const;
+
+  int GetNumBuckets() const;
+
+  ExtendibleHashStats GetStats() const;
+
+  // slots of a bucket, the requested size rounded up to whole cache lines
+  size_t GetBucketCapacity() const { return capacity_; }
+
+  // lookup and modifier
+  bool Find(const K &key, V &value) override;
+
+  bool Remove(const K &key) override;
+
+  void Insert(const K &key, const V &value) override;
+
+  size_t Size() const override { return pair_count_; }
+
+private:
+  Bucket *LockBucket(size_t hash);
+  void Split(Bucket *bucket);
+  void Grow(int depth);
+  bool CanMerge(Bucket *bucket, Bucket *buddy) const;
+  void Merge(size_t hash);
+  static size_t Mask(int depth);
+
+  mutable RWMutex directory_latch_; // write locked to resize and to merge
+  const size_t capacity_;           // slots of a bucket
+  std::atomic<int> bucket_count_;   // number of buckets in use
+  int depth_;                       // global depth
+  std::atomic<size_t> pair_count_;  // key-value number in table
+  uint64_t merge_count_;            // buddy buckets merged
+  uint64_t shrink_count_;           // directory halvings
+  std::vector<std::atomic<Bucket *>> directory_;
+};
+
+} // namespace cmudb
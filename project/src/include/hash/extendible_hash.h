@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <cstdlib>
 #include <map>
 #include <memory>
@@ -20,6 +21,20 @@
 
 namespace cmudb {
 
+// directory size and bucket occupancy of an extendible hash table
+struct ExtendibleHashStats {
+  size_t directory_size = 0; // slots of the directory
+  int global_depth = 0;
+  size_t num_buckets = 0;    // buckets in use
+  size_t empty_buckets = 0;  // buckets in use without any item
+  size_t max_items = 0;      // items in the fullest bucket
+  size_t num_items = 0;      // key-value pairs
+  size_t bucket_size = 0;    // items of a bucket before it is split
+  double occupancy = 0;      // num_items / (num_buckets * bucket_size)
+  uint64_t merges = 0;       // buddy buckets merged so far
+  uint64_t shrinks = 0;      // times the directory was halved so far
+};
+
 // only support unique key
 template <typename K, typename V>
 class ExtendibleHash : public HashTable<K, V> {
@@ -49,6 +64,8 @@ public:
 
   int GetNumBuckets() const;
 
+  ExtendibleHashStats GetStats() const;
+
   // lookup and modifier
   bool Find(const K &key, V &value) override;
 
@@ -61,6 +78,8 @@ public:
 private:
   std::unique_ptr<Bucket> split(std::shared_ptr<Bucket> &);
   size_t bucketIndex(const K &key);
+  bool merge(size_t index);
+  void shrink();
   //void dump(const K &key);
 
   mutable std::mutex mutex_;  // to protect shared data structure
@@ -68,6 +87,8 @@ private:
   int bucket_count_;          // number of buckets in use
   int depth;                  // global depth
   size_t pair_count;          // key-value number in table
+  uint64_t merge_count_;      // buddy buckets merged
+  uint64_t shrink_count_;     // directory halvings
   std::vector<std::shared_ptr<Bucket>> directory_;  // smart pointer for auto memory management
 };
 
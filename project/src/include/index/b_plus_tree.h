@@ -7,6 +7,8 @@
  * (2) support insert & remove
  * (3) The structure should shrink and grow dynamically
  * (4) Implement index iterator for range scan
+ * (5) Pages are allocated from extents of the tree, so leaves split in key
+ *     order mostly follow each other in the file
  */
 
 #pragma once
@@ -80,6 +82,10 @@ private:
     BufferPoolManager *buffer;
   };
 
+  // read only descent, latch crabbing with page guards: one fetch and one
+  // unpin per level, the leaf is returned latched
+  ReadPageGuard FindLeafPageRead(const KeyType &key, bool leftMost = false);
+
   void StartNewTree(const KeyType &key, const ValueType &value);
 
   bool InsertIntoLeaf(const KeyType &key, const ValueType &value,
@@ -127,6 +133,7 @@ private:
   page_id_t root_page_id_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
+  Extent extent_; // page ids reserved for the next new pages
 };
 
 } // namespace cmudb
@@ -0,0 +1,94 @@
+/**
+ * extendible_hash_table.h
+ *
+ * Disk resident extendible hash table built from buffer pool pages, a
+ * directory page and bucket pages. A point lookup fetches the directory and
+ * one bucket, instead of one page per level of a B+ tree.
+ * (1) We only support unique key
+ * (2) support insert & remove, buckets split when full and merge when empty,
+ *     the directory doubles and halves with them
+ * (3) a bucket at the largest local depth chains overflow pages
+ *
+ * Lookups and changes that stay within one bucket share the table latch and
+ * latch the bucket page. Splits and merges hold the table latch exclusively.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/rwmutex.h"
+#include "concurrency/transaction.h"
+#include "index/generic_key.h"
+#include "page/hash_table_bucket_page.h"
+#include "page/hash_table_directory_page.h"
+
+namespace cmudb {
+
+#define EXTENDIBLE_HASH_TABLE_TYPE                                             \
+  ExtendibleHashTable<KeyType, ValueType, KeyComparator>
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+class ExtendibleHashTable {
+public:
+  explicit ExtendibleHashTable(const std::string &name,
+                               BufferPoolManager *buffer_pool_manager,
+                               const KeyComparator &comparator,
+                               page_id_t directory_page_id = INVALID_PAGE_ID);
+
+  // Returns true if no directory page was created yet
+  bool IsEmpty() const;
+
+  // Insert a key-value pair, return false if the key is already there
+  bool Insert(const KeyType &key, const ValueType &value,
+              Transaction *transaction = nullptr);
+
+  // Remove a key and its value
+  void Remove(const KeyType &key, Transaction *transaction = nullptr);
+
+  // return the value associated with a given key
+  bool GetValue(const KeyType &key, std::vector<ValueType> &result,
+                Transaction *transaction = nullptr);
+
+  // expose for test purpose
+  page_id_t GetDirectoryPageId() const { return directory_page_id_; }
+
+  uint32_t GetGlobalDepth();
+
+  uint32_t GetNumBuckets();
+
+  // check the directory invariants and that every key is in its bucket
+  bool Check();
+
+private:
+  typedef HashTableBucketPage<KeyType, ValueType, KeyComparator> BucketPage;
+
+  uint32_t Hash(const KeyType &key) const;
+
+  void StartNewTable();
+
+  bool InsertIntoBucket(const KeyType &key, const ValueType &value,
+                        page_id_t bucket_page_id, uint32_t local_depth,
+                        bool &full);
+
+  bool SplitInsert(const KeyType &key, const ValueType &value);
+
+  bool RemoveFromBucket(const KeyType &key, page_id_t bucket_page_id);
+
+  void Merge(uint32_t hash);
+
+  ReadPageGuard FetchRead(page_id_t page_id, const char *caller);
+  WritePageGuard FetchWrite(page_id_t page_id, const char *caller);
+  WritePageGuard NewWrite(page_id_t &page_id, const char *caller);
+
+  // member variable
+  std::string index_name_;
+  RWMutex table_latch_;          // exclusive for splits and merges
+  page_id_t directory_page_id_;  // set once, under the exclusive table latch
+  BufferPoolManager *buffer_pool_manager_;
+  KeyComparator comparator_;
+};
+
+} // namespace cmudb
@@ -0,0 +1,44 @@
+/**
+ * hash_table_index.h
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "index/extendible_hash_table.h"
+#include "index/index.h"
+
+namespace cmudb {
+
+#define HASH_TABLE_INDEX_TYPE                                                  \
+  HashTableIndex<KeyType, ValueType, KeyComparator>
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+class HashTableIndex : public Index {
+
+public:
+  HashTableIndex(IndexMetadata *metadata,
+                 BufferPoolManager *buffer_pool_manager,
+                 page_id_t directory_page_id = INVALID_PAGE_ID);
+
+  ~HashTableIndex() {}
+
+  void InsertEntry(const Tuple &key, RID rid,
+                   Transaction *transaction = nullptr) override;
+
+  void DeleteEntry(const Tuple &key,
+                   Transaction *transaction = nullptr) override;
+
+  void ScanKey(const Tuple &key, std::vector<RID> &result,
+               Transaction *transaction = nullptr) override;
+
+protected:
+  // comparator for key
+  KeyComparator comparator_;
+  // container
+  ExtendibleHashTable<KeyType, ValueType, KeyComparator> container_;
+};
+
+} // namespace cmudb
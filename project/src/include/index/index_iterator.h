@@ -17,10 +17,9 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 class IndexIterator {
 public:
   // you may define your own constructor based on your member variables
-  IndexIterator(BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *,
-                int, BufferPoolManager *);
-
-  ~IndexIterator();
+  // guard holds the read latched leaf, empty if the tree is empty
+  IndexIterator(ReadPageGuard &&guard, int index,
+                BufferPoolManager *buff_pool_manager);
 
   bool isEnd();
 
@@ -29,10 +28,15 @@ public:
   IndexIterator &operator++();
 
 private:
+  // keep the next PREFETCH_WINDOW leaves loading, renewed every half window
+  void Prefetch();
+
   // add your own private member variables here
+  ReadPageGuard guard_;     // latch and pin of leaf_
   BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *leaf_;
   int index_;
   BufferPoolManager *buff_pool_manager_;
+  size_t leaves_;   // number of leaves visited
 };
 
 } // namespace cmudb
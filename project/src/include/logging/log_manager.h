@@ -10,7 +10,9 @@
 #include <algorithm>
 #include <condition_variable>
 #include <future>
+#include <map>
 #include <mutex>
+#include <unordered_map>
 
 #include "disk/disk_manager.h"
 #include "logging/log_record.h"
@@ -20,8 +22,10 @@ namespace cmudb {
 class LogManager {
 public:
   explicit LogManager(DiskManager *disk_manager)
-      : promise(nullptr), flush_lsn_(0), next_lsn_(0), persistent_lsn_(INVALID_LSN),
-        offset_(0), disk_manager_(disk_manager) {
+      : promise(nullptr), flush_lsn_(INVALID_LSN), flush_first_lsn_(0),
+        next_lsn_(0), persistent_lsn_(INVALID_LSN), offset_(0),
+        flush_pending_(false), flush_running_(false), flush_thread_(nullptr),
+        disk_manager_(disk_manager) {
     log_buffer_ = new char[LOG_BUFFER_SIZE];
     flush_buffer_ = new char[LOG_BUFFER_SIZE];
   }
@@ -54,13 +58,23 @@ public:
 
   void WakeupFlushThread(std::promise<void> *promise);
 
+  // start a flush without waiting for it, never blocks on a forced flush
+  void RequestFlush();
+
+  // unlink the log files holding only records below lsn, the oldest LSN
+  // recovery still needs. Return the number of files unlinked
+  int DiscardLog(lsn_t lsn);
+
 private:
-  inline void swapBuffer();
+  inline bool swapBuffer(std::unique_lock<std::mutex> &lock);
+  void writeFlushBuffer();
 
   std::promise<void> *promise;
 
   // last log records in the flush_buffer_;
   lsn_t flush_lsn_;
+  // first log records in the flush_buffer_
+  lsn_t flush_first_lsn_;
 
   // atomic counter, record the next log sequence number
   std::atomic<lsn_t> next_lsn_;
@@ -74,15 +88,33 @@ private:
 
   int offset_;
 
+  // flush_buffer_ holds records the flush thread has not written yet
+  bool flush_pending_;
+
+  // the flush thread takes swapped buffers, otherwise a swap writes them
+  bool flush_running_;
+
+  // the BEGIN lsn of each transaction without COMMIT or ABORT yet
+  std::unordered_map<txn_id_t, lsn_t> active_txn_;
+
+  // first lsn of each buffer written -> its log offset
+  std::map<lsn_t, int64_t> flushed_offsets_;
+
   // latch to protect shared member variables
   std::mutex latch_;
 
+  // serialize force flush requests, there is only one promise slot
+  std::mutex wakeup_latch_;
+
   // flush thread
   std::thread *flush_thread_;
 
   // for notifying flush thread
   std::condition_variable cv_;
 
+  // for waiting until flush_buffer_ is written, before the next swap
+  std::condition_variable flushed_cv_;
+
   // disk manager
   DiskManager *disk_manager_;
 };
@@ -44,10 +44,10 @@ private:
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
 
   // mapping log sequence number to log file offset, for undo purpose
-  std::unordered_map<lsn_t, int> lsn_mapping_;
+  std::unordered_map<lsn_t, int64_t> lsn_mapping_;
 
   // log buffer related
-  int offset_;
+  int64_t offset_;
   char *log_buffer_;
 };
 
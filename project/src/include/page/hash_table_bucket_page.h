@@ -0,0 +1,71 @@
+/**
+ * hash_table_bucket_page.h
+ *
+ * Bucket of a disk resident extendible hash table, holding key and record id
+ * pairs in no particular order. Only support unique key. A bucket whose local
+ * depth can not grow any more chains overflow pages through NextPageId, every
+ * page of a chain but the first one holds at least one pair.
+ *
+ * Bucket page format:
+ *  ----------------------------------------------------------------------
+ * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
+ *  ----------------------------------------------------------------------
+ *
+ *  Header format (size in byte, 16 bytes in total):
+ *  ---------------------------------------------------------------
+ * | PageId (4) | LSN (4) | CurrentSize (4) | NextPageId (4) |
+ *  ---------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <utility>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+#define HASH_TABLE_BUCKET_TYPE                                                 \
+  HashTableBucketPage<KeyType, ValueType, KeyComparator>
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+class HashTableBucketPage {
+public:
+  // After creating a new bucket page from buffer pool, must call initialize
+  // method to set default values
+  void Init(page_id_t page_id);
+
+  page_id_t GetPageId() const { return page_id_; }
+
+  lsn_t GetLSN() const { return lsn_; }
+  void SetLSN(lsn_t lsn = INVALID_LSN) { lsn_ = lsn; }
+
+  page_id_t GetNextPageId() const { return next_page_id_; }
+  void SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+
+  int GetSize() const { return size_; }
+  static int GetMaxSize();
+  bool IsFull() const { return size_ == GetMaxSize(); }
+  bool IsEmpty() const { return size_ == 0; }
+
+  const KeyType &KeyAt(int index) const;
+  const ValueType &ValueAt(int index) const;
+
+  // array offset of key, -1 if it is not in this page
+  int KeyIndex(const KeyType &key, const KeyComparator &comparator) const;
+
+  // append a pair, the page must not be full
+  void Insert(const KeyType &key, const ValueType &value);
+
+  // the last pair takes the place of the removed one
+  void RemoveAt(int index);
+
+private:
+  page_id_t page_id_;
+  lsn_t lsn_;
+  int size_;
+  page_id_t next_page_id_;
+  std::pair<KeyType, ValueType> array_[0];
+};
+
+} // namespace cmudb
@@ -0,0 +1,71 @@
+/**
+ * hash_table_directory_page.h
+ *
+ * Directory of a disk resident extendible hash table. Slot i holds the page
+ * id of the bucket for hash values whose low GlobalDepth bits are i, and the
+ * local depth of that bucket. A bucket of local depth d is pointed to by every
+ * slot whose low d bits are equal.
+ *
+ * Directory page format (size in byte, 2572 bytes in total):
+ *  ---------------------------------------------------------------------
+ * | PageId (4) | LSN (4) | GlobalDepth (4) | BucketPageId (4) * 512 |
+ *  ---------------------------------------------------------------------
+ *  ----------------------
+ * | LocalDepth (1) * 512 |
+ *  ----------------------
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+#define HASH_DIRECTORY_MAX_DEPTH 9 // deepest directory fitting in a page
+#define HASH_DIRECTORY_ARRAY_SIZE (1 << HASH_DIRECTORY_MAX_DEPTH)
+
+class HashTableDirectoryPage {
+public:
+  // After creating a new directory page from buffer pool, must call
+  // initialize method to set default values
+  void Init(page_id_t page_id, page_id_t bucket_page_id);
+
+  page_id_t GetPageId() const { return page_id_; }
+
+  lsn_t GetLSN() const { return lsn_; }
+  void SetLSN(lsn_t lsn = INVALID_LSN) { lsn_ = lsn; }
+
+  // number of slots in use
+  uint32_t Size() const { return 1U << global_depth_; }
+
+  uint32_t GetGlobalDepth() const { return global_depth_; }
+  uint32_t GetGlobalDepthMask() const { return Size() - 1; }
+
+  // double the directory, the new upper half mirrors the lower half
+  void IncrGlobalDepth();
+  // halve the directory, return false if some bucket needs the full depth
+  bool DecrGlobalDepth();
+
+  page_id_t GetBucketPageId(uint32_t index) const;
+  void SetBucketPageId(uint32_t index, page_id_t bucket_page_id);
+
+  uint32_t GetLocalDepth(uint32_t index) const;
+  void SetLocalDepth(uint32_t index, uint32_t local_depth);
+
+  // slot of the bucket index was split from or split off
+  uint32_t GetBuddyIndex(uint32_t index) const;
+
+  // number of distinct buckets, for debug
+  uint32_t GetNumBuckets() const;
+
+private:
+  page_id_t page_id_;
+  lsn_t lsn_;
+  uint32_t global_depth_;
+  page_id_t bucket_page_ids_[HASH_DIRECTORY_ARRAY_SIZE];
+  uint8_t local_depths_[HASH_DIRECTORY_ARRAY_SIZE];
+};
+
+} // namespace cmudb
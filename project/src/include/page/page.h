@@ -4,6 +4,10 @@
  * Wrapper around actual data page in main memory and also contains bookkeeping
  * information used by buffer pool manager like pin_count/dirty_flag/page_id.
  * Use page as a basic unit within the database system
+ *
+ * The content lives in a frame of the buffer pool's arena, see frame_arena.h.
+ * When the db file is mapped read only, pages have no frame and point into the
+ * mapping instead.
  */
 
 #pragma once
@@ -16,12 +20,29 @@
 
 namespace cmudb {
 
+/*
+ * State of a buffer pool frame. Disk I/O is done without holding the buffer
+ * pool latch, the state tells concurrent requesters what the frame is doing.
+ */
+enum class FrameState {
+  FREE = 0,     // not holding any page
+  LOADING,      // reading page content from disk
+  RESIDENT,     // page content is valid
+  WRITING_BACK, // victim, writing old content back before reuse
+  FLUSHING      // page content is valid, a copy is being written to disk
+};
+
 class Page {
   friend class BufferPoolManager;
 
 public:
-  Page() { ResetMemory(); }
-  ~Page() {};
+  // frame: PAGE_SIZE bytes the page does not own. A page without frame has
+  // no content until it is pointed at one
+  explicit Page(char *frame = nullptr) : data_(frame) {
+    if (data_ != nullptr) {
+      ResetMemory();
+    }
+  }
 
   // disable copy
   Page(Page const &) = delete;
@@ -50,10 +71,11 @@ private:
   inline void ResetMemory() { memset(data_, 0, PAGE_SIZE); }
 
   // members
-  char data_[PAGE_SIZE]; // actual data
+  char *data_; // actual data, the frame or a mapped page
   page_id_t page_id_ = INVALID_PAGE_ID;
   int pin_count_ = 0;
   bool is_dirty_ = false;
+  FrameState state_ = FrameState::FREE;
   RWMutex rwlatch_;
 };
 
@@ -2,6 +2,9 @@
  * table_heap.h
  *
  * doubly-linked list of heap pages
+ *
+ * New pages come from an extent of the heap, so the list mostly runs forward
+ * through the file and a sequential scan reads it sequentially.
  */
 
 #pragma once
@@ -29,7 +32,9 @@ public:
             LogManager *log_manager, Transaction *txn);
 
   // for insert, if tuple is too large (>~page_size), return false
-  bool InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn);
+  // a bulk insert may pass a ring to keep the buffer pool unpolluted
+  bool InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
+                   ScanRing *ring = nullptr);
 
   bool MarkDelete(const RID &rid, Transaction *txn); // for delete
 
@@ -42,11 +47,13 @@ public:
                    Transaction *txn); // when commit delete or rollback insert
   void RollbackDelete(const RID &rid, Transaction *txn); // when rollback delete
 
-  bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn);
+  bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
+                ScanRing *ring = nullptr);
 
   bool DeleteTableHeap();
 
-  TableIterator begin(Transaction *txn);
+  // a sequential scan may pass a ring, which must outlive the iterator
+  TableIterator begin(Transaction *txn, ScanRing *ring = nullptr);
 
   TableIterator end();
 
@@ -60,6 +67,7 @@ private:
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_;
+  Extent extent_; // page ids reserved for the next new pages
 };
 
 } // namespace cmudb
@@ -8,6 +8,7 @@
 
 #include <cassert>
 
+#include "buffer/scan_ring.h"
 #include "common/rid.h"
 #include "table/tuple.h"
 
@@ -19,7 +20,13 @@ class TableIterator {
   friend class Cursor;
 
 public:
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  // pages are fetched through ring if not null
+  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                ScanRing *ring = nullptr);
+
+  TableIterator(const TableIterator &other);
+
+  TableIterator &operator=(const TableIterator &other);
 
   ~TableIterator() { delete tuple_; }
 
@@ -40,9 +47,15 @@ public:
   TableIterator operator++(int);
 
 private:
+  // keep the next PREFETCH_WINDOW pages of the chain loading, renewed every
+  // half window
+  void Prefetch(page_id_t page_id);
+
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  ScanRing *ring_;
+  size_t pages_;    // number of pages visited
 };
 
 } // namespace cmudb
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "catalog/schema.h"
 #include "concurrency/transaction_manager.h"
 #include "index/b_plus_tree_index.h"
+#include "index/hash_table_index.h"
 #include "logging/log_manager.h"
 #include "sqlite/sqlite3ext.h"
 #include "table/table_heap.h"
@@ -29,6 +30,11 @@ Index *ConstructIndex(IndexMetadata *metadata,
                       page_id_t root_id = INVALID_PAGE_ID);
 Transaction *GetTransaction();
 
+size_t GetBufferPoolSize();
+
+std::string ParseArguments(int argc, const char *const *argv,
+                           BufferPoolManager *buffer_pool_manager);
+
 /* API declaration */
 int VtabCreate(sqlite3 *db, void *pAux, int argc, const char *const *argv,
                sqlite3_vtab **ppVtab, char **pzErr);
@@ -71,8 +77,10 @@ public:
     // log related
     log_manager_ = new LogManager(disk_manager_);
 
-    buffer_pool_manager_ =
-        new BufferPoolManager(BUFFER_POOL_SIZE, disk_manager_, log_manager_);
+    size_t pool_size = GetBufferPoolSize();
+    buffer_pool_manager_ = new BufferPoolManager(
+        pool_size, disk_manager_, log_manager_,
+        BufferPoolManager::DefaultNumShards(pool_size));
 
     // txn related
     lock_manager_ = new LockManager(true); // S2PL
@@ -82,8 +90,9 @@ public:
   ~StorageEngine() {
     if (ENABLE_LOGGING)
       log_manager_->StopFlushThread();
-    delete disk_manager_;
+    // background threads of the buffer pool may still use the disk manager
     delete buffer_pool_manager_;
+    delete disk_manager_;
     delete log_manager_;
     delete lock_manager_;
     delete transaction_manager_;
@@ -172,7 +181,9 @@ public:
     return table_heap_->UpdateTuple(tuple, rid, GetTransaction());
   }
 
-  inline TableIterator begin() { return table_heap_->begin(GetTransaction()); }
+  inline TableIterator begin(ScanRing *ring = nullptr) {
+    return table_heap_->begin(GetTransaction(), ring);
+  }
 
   inline TableIterator end() { return table_heap_->end(); }
 
@@ -196,9 +207,9 @@ private:
 
 class Cursor {
 public:
+  // nothing is pinned until ScanTable starts the scan through ring_
   Cursor(VirtualTable *virtual_table)
-      : table_iterator_(virtual_table->begin()), virtual_table_(virtual_table) {
-  }
+      : table_iterator_(virtual_table->end()), virtual_table_(virtual_table) {}
 
   inline void SetScanFlag(bool is_index_scan) {
     is_index_scan_ = is_index_scan;
@@ -252,6 +263,9 @@ public:
     virtual_table_->index_->ScanKey(key, results);
   }
 
+  // restart a full table scan, recycling the frames of ring_
+  inline void ScanTable() { table_iterator_ = virtual_table_->begin(&ring_); }
+
 private:
   sqlite3_vtab_cursor base_; /* Base class - must be first */
   // for index scan
@@ -259,6 +273,7 @@ private:
   int offset_ = 0;
   // for sequential scan
   TableIterator table_iterator_;
+  ScanRing ring_;
   // flag to indicate which scan method is currently used
   bool is_index_scan_ = false;
   VirtualTable *virtual_table_;
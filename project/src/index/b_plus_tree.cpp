@@ -2,8 +2,10 @@
  * b_plus_tree.cpp
  */
 
+#include <fstream>
 #include <iostream>
 #include <string>
+#include <utility>
 
 #include "common/exception.h"
 #include "common/logger.h"
@@ -49,27 +51,19 @@ GetValue(const KeyType &key, std::vector<ValueType> &result,
   // for debug
   //__attribute__((unused)) auto checker = Checker{buffer_pool_manager_};
 
-  auto *leaf = FindLeafPage(key, false, Operation::READONLY, transaction);
-  bool ret = false;
-  if (leaf != nullptr) {
-    ValueType value;
-    if (leaf->Lookup(key, value, comparator_)) {
-      result.push_back(value);
-      ret = true;
-    }
-    UnlockUnpinPages(Operation::READONLY, transaction);
-
-    // in case of `transaction` is nullptr
-    if (transaction == nullptr) {
-      auto page_id = leaf->GetPageId();
-      // unlock and unpin
-      buffer_pool_manager_->FetchPage(page_id)->RUnlatch();
-      buffer_pool_manager_->UnpinPage(page_id, false);
-      // unpin again
-      buffer_pool_manager_->UnpinPage(page_id, false);
-    }
+  ReadPageGuard guard = FindLeafPageRead(key);
+  if (!guard.IsValid()) {
+    return false;
   }
-  return ret;
+  auto *leaf = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType,
+                                                  KeyComparator> *>(
+      guard.GetPage()->GetData());
+  ValueType value;
+  if (leaf->Lookup(key, value, comparator_)) {
+    result.push_back(value);
+    return true;
+  }
+  return false;
 }
 
 /*****************************************************************************
@@ -109,7 +103,8 @@ Insert(const KeyType &key, const ValueType &value, Transaction *transaction) {
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void BPlusTree<KeyType, ValueType, KeyComparator>::
 StartNewTree(const KeyType &key, const ValueType &value) {
-  auto *page = buffer_pool_manager_->NewPage(root_page_id_);
+  auto *page =
+      buffer_pool_manager_->NewPage(root_page_id_, nullptr, &extent_);
   if (page == nullptr) {
     throw Exception(EXCEPTION_TYPE_INDEX,
                     "all page are pinned while StartNewTree");
@@ -195,7 +190,7 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 template <typename N> N *BPlusTree<KeyType, ValueType, KeyComparator>::
 Split(N *node) {
   page_id_t page_id;
-  auto *page = buffer_pool_manager_->NewPage(page_id);
+  auto *page = buffer_pool_manager_->NewPage(page_id, nullptr, &extent_);
   if (page == nullptr) {
     throw Exception(EXCEPTION_TYPE_INDEX,
                     "all page are pinned while Split");
@@ -221,7 +216,8 @@ void BPlusTree<KeyType, ValueType, KeyComparator>::
 InsertIntoParent(BPlusTreePage *old_node, const KeyType &key,
                  BPlusTreePage *new_node, Transaction *transaction) {
   if (old_node->IsRootPage()) {
-    auto *page = buffer_pool_manager_->NewPage(root_page_id_);
+    auto *page =
+        buffer_pool_manager_->NewPage(root_page_id_, nullptr, &extent_);
     if (page == nullptr) {
       throw Exception(EXCEPTION_TYPE_INDEX,
                       "all page are pinned while InsertIntoParent");
@@ -265,7 +261,7 @@ InsertIntoParent(BPlusTreePage *old_node, const KeyType &key,
       // internal have no space and have to split
       // first make a copy of internal node, simplify split process
       page_id_t page_id;
-      auto *page = buffer_pool_manager_->NewPage(page_id);
+      auto *page = buffer_pool_manager_->NewPage(page_id, nullptr, &extent_);
       if (page == nullptr) {
         throw Exception(EXCEPTION_TYPE_INDEX,
                         "all page are pinned while InsertIntoParent");
@@ -593,7 +589,7 @@ IndexIterator<KeyType, ValueType, KeyComparator> BPlusTree<KeyType, ValueType, K
 Begin() {
   KeyType key{};
   return IndexIterator<KeyType, ValueType, KeyComparator>(
-      FindLeafPage(key, true), 0, buffer_pool_manager_);
+      FindLeafPageRead(key, true), 0, buffer_pool_manager_);
 }
 
 /*
@@ -604,13 +600,16 @@ Begin() {
 template <typename KeyType, typename ValueType, typename KeyComparator>
 IndexIterator<KeyType, ValueType, KeyComparator> BPlusTree<KeyType, ValueType, KeyComparator>::
 Begin(const KeyType &key) {
-  auto *leaf = FindLeafPage(key, false);
+  ReadPageGuard guard = FindLeafPageRead(key);
   int index = 0;
-  if (leaf != nullptr) {
+  if (guard.IsValid()) {
+    auto *leaf = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType,
+                                                    KeyComparator> *>(
+        guard.GetPage()->GetData());
     index = leaf->KeyIndex(key, comparator_);
   }
   return IndexIterator<KeyType, ValueType, KeyComparator>(
-      leaf, index, buffer_pool_manager_);
+      std::move(guard), index, buffer_pool_manager_);
 }
 
 /*****************************************************************************
@@ -761,6 +760,52 @@ FindLeafPage(const KeyType &key, bool leftMost, Operation op, Transaction *trans
                                             ValueType, KeyComparator> *>(node);
 }
 
+/*
+ * Read only version of FindLeafPage: the guard of the child replaces the one
+ * of its parent once the child is latched. Return an empty guard if the tree
+ * is empty
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+ReadPageGuard BPlusTree<KeyType, ValueType, KeyComparator>::
+FindLeafPageRead(const KeyType &key, bool leftMost) {
+  // empty B+ tree?
+  if (IsEmpty()) {
+    return ReadPageGuard();
+  }
+
+  // walk from root node
+  ReadPageGuard guard = buffer_pool_manager_->FetchPageRead(root_page_id_);
+  if (!guard.IsValid()) {
+    throw Exception(EXCEPTION_TYPE_INDEX,
+                    "all page are pinned while FindLeafPage");
+  }
+  auto *node = reinterpret_cast<BPlusTreePage *>(guard.GetPage()->GetData());
+  while (!node->IsLeafPage()) {
+    auto internal =
+        reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t,
+                                               KeyComparator> *>(node);
+    page_id_t parent_page_id = node->GetPageId(), child_page_id;
+    if (leftMost) {
+      child_page_id = internal->ValueAt(0);
+    } else {
+      child_page_id = internal->Lookup(key, comparator_);
+    }
+
+    // acquire S lock on child, then release S lock on parent
+    ReadPageGuard child = buffer_pool_manager_->FetchPageRead(child_page_id);
+    if (!child.IsValid()) {
+      throw Exception(EXCEPTION_TYPE_INDEX,
+                      "all page are pinned while FindLeafPage");
+    }
+    guard = std::move(child);
+
+    // sanity check, parent page id must match
+    node = reinterpret_cast<BPlusTreePage *>(guard.GetPage()->GetData());
+    assert(node->GetParentPageId() == parent_page_id);
+  }
+  return guard;
+}
+
 /*
  * Update/Insert root page id in header page(where page_id = 0, header_page is
  * defined under include/page/header_page.h)
@@ -777,7 +822,7 @@ UpdateRootPageId(bool insert_record) {
     throw Exception(EXCEPTION_TYPE_INDEX,
                     "all page are pinned while UpdateRootPageId");
   }
-  auto *header_page = reinterpret_cast<HeaderPage *>(page->GetData());
+  auto *header_page = static_cast<HeaderPage *>(page);
 
   if (insert_record) {
     // create a new record<index_name + root_page_id> in header_page
@@ -801,12 +846,13 @@ ToString(bool verbose) {
   }
   std::queue<BPlusTreePage *> todo, tmp;
   std::stringstream tree;
-  auto node = reinterpret_cast<BPlusTreePage *>(
-      buffer_pool_manager_->FetchPage(root_page_id_));
-  if (node == nullptr) {
+  auto *root = buffer_pool_manager_->FetchPage(root_page_id_);
+  if (root == nullptr) {
     throw Exception(EXCEPTION_TYPE_INDEX,
                     "all page are pinned while printing");
   }
+  // the frame points at the page, it is not the page
+  auto node = reinterpret_cast<BPlusTreePage *>(root->GetData());
   todo.push(node);
   bool first = true;
   while (!todo.empty()) {
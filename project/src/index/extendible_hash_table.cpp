@@ -0,0 +1,537 @@
+/**
+ * extendible_hash_table.cpp
+ */
+
+#include <string>
+
+#include "common/exception.h"
+#include "common/rid.h"
+#include "index/extendible_hash_table.h"
+#include "page/header_page.h"
+
+namespace cmudb {
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+EXTENDIBLE_HASH_TABLE_TYPE::ExtendibleHashTable(
+    const std::string &name, BufferPoolManager *buffer_pool_manager,
+    const KeyComparator &comparator, page_id_t directory_page_id)
+    : index_name_(name), directory_page_id_(directory_page_id),
+      buffer_pool_manager_(buffer_pool_manager), comparator_(comparator) {}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool EXTENDIBLE_HASH_TABLE_TYPE::IsEmpty() const {
+  return directory_page_id_ == INVALID_PAGE_ID;
+}
+
+/*****************************************************************************
+ * SEARCH
+ *****************************************************************************/
+/*
+ * Return the only value that associated with input key
+ * The directory is only read to find the bucket, the pages of an overflow
+ * chain are crabbed through
+ * @return : true means key exists
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool EXTENDIBLE_HASH_TABLE_TYPE::GetValue(const KeyType &key,
+                                          std::vector<ValueType> &result,
+                                          Transaction *transaction) {
+  table_latch_.RLock();
+  if (IsEmpty()) {
+    table_latch_.RUnlock();
+    return false;
+  }
+
+  page_id_t page_id;
+  {
+    ReadPageGuard guard = FetchRead(directory_page_id_, "GetValue");
+    auto *directory =
+        reinterpret_cast<const HashTableDirectoryPage *>(guard.GetData());
+    page_id = directory->GetBucketPageId(Hash(key) &
+                                         directory->GetGlobalDepthMask());
+  }
+
+  bool found = false;
+  ReadPageGuard guard;
+  while (page_id != INVALID_PAGE_ID && !found) {
+    guard = FetchRead(page_id, "GetValue");
+    auto *bucket = reinterpret_cast<const BucketPage *>(guard.GetData());
+    int index = bucket->KeyIndex(key, comparator_);
+    if (index != -1) {
+      result.push_back(bucket->ValueAt(index));
+      found = true;
+    }
+    page_id = bucket->GetNextPageId();
+  }
+  guard.Release();
+  table_latch_.RUnlock();
+  return found;
+}
+
+/*****************************************************************************
+ * INSERTION
+ *****************************************************************************/
+/*
+ * Insert constant key & value pair into hash table
+ * The bucket is changed under the shared table latch unless it has to be
+ * split, then the insert starts over under the exclusive table latch
+ * @return: since we only support unique key, if user try to insert duplicate
+ * keys return false, otherwise return true.
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool EXTENDIBLE_HASH_TABLE_TYPE::Insert(const KeyType &key,
+                                        const ValueType &value,
+                                        Transaction *transaction) {
+  table_latch_.RLock();
+  while (IsEmpty()) {
+    table_latch_.RUnlock();
+    table_latch_.WLock();
+    if (IsEmpty()) {
+      StartNewTable();
+    }
+    table_latch_.WUnlock();
+    table_latch_.RLock();
+  }
+
+  page_id_t bucket_page_id;
+  uint32_t local_depth;
+  {
+    ReadPageGuard guard = FetchRead(directory_page_id_, "Insert");
+    auto *directory =
+        reinterpret_cast<const HashTableDirectoryPage *>(guard.GetData());
+    uint32_t index = Hash(key) & directory->GetGlobalDepthMask();
+    bucket_page_id = directory->GetBucketPageId(index);
+    local_depth = directory->GetLocalDepth(index);
+  }
+  bool full = false;
+  bool inserted =
+      InsertIntoBucket(key, value, bucket_page_id, local_depth, full);
+  table_latch_.RUnlock();
+
+  if (full) {
+    table_latch_.WLock();
+    inserted = SplitInsert(key, value);
+    table_latch_.WUnlock();
+  }
+  return inserted;
+}
+
+/*
+ * Create the directory page with a single empty bucket, and record the
+ * directory page id in header page
+ * should be called when holding the exclusive table latch
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void EXTENDIBLE_HASH_TABLE_TYPE::StartNewTable() {
+  page_id_t directory_page_id;
+  page_id_t bucket_page_id;
+  WritePageGuard directory_guard = NewWrite(directory_page_id, "StartNewTable");
+  WritePageGuard bucket_guard = NewWrite(bucket_page_id, "StartNewTable");
+  reinterpret_cast<BucketPage *>(bucket_guard.GetData())->Init(bucket_page_id);
+  reinterpret_cast<HashTableDirectoryPage *>(directory_guard.GetData())
+      ->Init(directory_page_id, bucket_page_id);
+
+  auto *page = buffer_pool_manager_->FetchPage(HEADER_PAGE_ID);
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_INDEX,
+                    "all page are pinned while StartNewTable");
+  }
+  // create a new record<index_name + directory_page_id> in header_page
+  auto *header_page = static_cast<HeaderPage *>(page);
+  header_page->InsertRecord(index_name_, directory_page_id);
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+
+  directory_page_id_ = directory_page_id;
+}
+
+/*
+ * Insert into the first page of the bucket chain with room, after making sure
+ * the key is not in any of them. A full bucket which can still be split is
+ * left alone and full is set, otherwise an overflow page is chained
+ * The first page of the chain stays latched, so changes of one bucket are
+ * serialized
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool EXTENDIBLE_HASH_TABLE_TYPE::InsertIntoBucket(const KeyType &key,
+                                                  const ValueType &value,
+                                                  page_id_t bucket_page_id,
+                                                  uint32_t local_depth,
+                                                  bool &full) {
+  WritePageGuard head = FetchWrite(bucket_page_id, "Insert");
+  WritePageGuard room;    // first overflow page with room
+  WritePageGuard current; // overflow page being looked at
+  WritePageGuard *target_guard = nullptr;
+  BucketPage *target = nullptr;
+  auto *bucket = reinterpret_cast<BucketPage *>(head.GetData());
+  while (true) {
+    if (bucket->KeyIndex(key, comparator_) != -1) {
+      return false;
+    }
+    if (target == nullptr && !bucket->IsFull()) {
+      target = bucket;
+      if (current.IsValid()) {
+        room = std::move(current);
+        target_guard = &room;
+      } else {
+        target_guard = &head;
+      }
+    }
+    page_id_t next_page_id = bucket->GetNextPageId();
+    if (next_page_id == INVALID_PAGE_ID) {
+      break;
+    }
+    current = FetchWrite(next_page_id, "Insert");
+    bucket = reinterpret_cast<BucketPage *>(current.GetData());
+  }
+
+  if (target != nullptr) {
+    target->Insert(key, value);
+    target_guard->MarkDirty();
+    return true;
+  }
+  if (local_depth < HASH_DIRECTORY_MAX_DEPTH) {
+    full = true;
+    return false;
+  }
+
+  // chain an overflow page after the last one
+  page_id_t overflow_page_id;
+  WritePageGuard overflow = NewWrite(overflow_page_id, "Insert");
+  auto *overflow_bucket = reinterpret_cast<BucketPage *>(overflow.GetData());
+  overflow_bucket->Init(overflow_page_id);
+  overflow_bucket->Insert(key, value);
+  bucket->SetNextPageId(overflow_page_id);
+  (current.IsValid() ? current : head).MarkDirty();
+  return true;
+}
+
+/*
+ * Split the bucket of key until there is room for it, doubling the directory
+ * when the local depth reaches the global depth. The pairs with the next bit
+ * of their hash set go to a new bucket
+ * should be called when holding the exclusive table latch
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool EXTENDIBLE_HASH_TABLE_TYPE::SplitInsert(const KeyType &key,
+                                             const ValueType &value) {
+  uint32_t hash = Hash(key);
+  while (true) {
+    WritePageGuard directory_guard =
+        FetchWrite(directory_page_id_, "SplitInsert");
+    auto *directory =
+        reinterpret_cast<HashTableDirectoryPage *>(directory_guard.GetData());
+    uint32_t index = hash & directory->GetGlobalDepthMask();
+    page_id_t bucket_page_id = directory->GetBucketPageId(index);
+    uint32_t local_depth = directory->GetLocalDepth(index);
+
+    bool full = false;
+    bool inserted =
+        InsertIntoBucket(key, value, bucket_page_id, local_depth, full);
+    if (!full) {
+      return inserted;
+    }
+
+    if (local_depth == directory->GetGlobalDepth()) {
+      directory->IncrGlobalDepth();
+    }
+    page_id_t image_page_id;
+    WritePageGuard image_guard = NewWrite(image_page_id, "SplitInsert");
+    auto *image = reinterpret_cast<BucketPage *>(image_guard.GetData());
+    image->Init(image_page_id);
+    WritePageGuard bucket_guard = FetchWrite(bucket_page_id, "SplitInsert");
+    auto *bucket = reinterpret_cast<BucketPage *>(bucket_guard.GetData());
+
+    uint32_t bit = 1U << local_depth;
+    for (int i = 0; i < bucket->GetSize();) {
+      if (Hash(bucket->KeyAt(i)) & bit) {
+        image->Insert(bucket->KeyAt(i), bucket->ValueAt(i));
+        bucket->RemoveAt(i);
+      } else {
+        ++i;
+      }
+    }
+    for (uint32_t i = index & (bit - 1); i < directory->Size(); i += bit) {
+      directory->SetLocalDepth(i, local_depth + 1);
+      if (i & bit) {
+        directory->SetBucketPageId(i, image_page_id);
+      }
+    }
+    bucket_guard.MarkDirty();
+    image_guard.MarkDirty();
+    directory_guard.MarkDirty();
+  }
+}
+
+/*****************************************************************************
+ * REMOVE
+ *****************************************************************************/
+/*
+ * Delete key & value pair associated with input key
+ * The bucket is changed under the shared table latch. If it becomes empty it
+ * is merged under the exclusive table latch
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void EXTENDIBLE_HASH_TABLE_TYPE::Remove(const KeyType &key,
+                                        Transaction *transaction) {
+  table_latch_.RLock();
+  if (IsEmpty()) {
+    table_latch_.RUnlock();
+    return;
+  }
+
+  uint32_t hash = Hash(key);
+  page_id_t bucket_page_id;
+  uint32_t local_depth;
+  {
+    ReadPageGuard guard = FetchRead(directory_page_id_, "Remove");
+    auto *directory =
+        reinterpret_cast<const HashTableDirectoryPage *>(guard.GetData());
+    uint32_t index = hash & directory->GetGlobalDepthMask();
+    bucket_page_id = directory->GetBucketPageId(index);
+    local_depth = directory->GetLocalDepth(index);
+  }
+  bool merge = RemoveFromBucket(key, bucket_page_id) && local_depth > 0;
+  table_latch_.RUnlock();
+
+  if (merge) {
+    table_latch_.WLock();
+    Merge(hash);
+    table_latch_.WUnlock();
+  }
+}
+
+/*
+ * Remove key from the bucket chain, an overflow page left empty is unlinked
+ * and deleted. If the first page is left empty, the next one moves into it
+ * @return: true if the bucket is empty now
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool EXTENDIBLE_HASH_TABLE_TYPE::RemoveFromBucket(const KeyType &key,
+                                                  page_id_t bucket_page_id) {
+  WritePageGuard head = FetchWrite(bucket_page_id, "Remove");
+  auto *bucket = reinterpret_cast<BucketPage *>(head.GetData());
+  int index = bucket->KeyIndex(key, comparator_);
+  if (index != -1) {
+    bucket->RemoveAt(index);
+    head.MarkDirty();
+    page_id_t next_page_id = bucket->GetNextPageId();
+    if (bucket->IsEmpty() && next_page_id != INVALID_PAGE_ID) {
+      {
+        ReadPageGuard next = FetchRead(next_page_id, "Remove");
+        auto *next_bucket = reinterpret_cast<const BucketPage *>(next.GetData());
+        for (int i = 0; i < next_bucket->GetSize(); ++i) {
+          bucket->Insert(next_bucket->KeyAt(i), next_bucket->ValueAt(i));
+        }
+        bucket->SetNextPageId(next_bucket->GetNextPageId());
+      }
+      buffer_pool_manager_->DeletePage(next_page_id);
+    }
+    return bucket->IsEmpty();
+  }
+
+  // crab along the overflow pages, keeping the previous one to unlink
+  WritePageGuard previous;
+  WritePageGuard current;
+  BucketPage *previous_bucket = bucket;
+  page_id_t page_id = bucket->GetNextPageId();
+  while (page_id != INVALID_PAGE_ID) {
+    if (current.IsValid()) {
+      previous = std::move(current);
+      previous_bucket = reinterpret_cast<BucketPage *>(previous.GetData());
+    }
+    current = FetchWrite(page_id, "Remove");
+    auto *current_bucket = reinterpret_cast<BucketPage *>(current.GetData());
+    index = current_bucket->KeyIndex(key, comparator_);
+    if (index != -1) {
+      current_bucket->RemoveAt(index);
+      current.MarkDirty();
+      if (current_bucket->IsEmpty()) {
+        previous_bucket->SetNextPageId(current_bucket->GetNextPageId());
+        (previous.IsValid() ? previous : head).MarkDirty();
+        current.Release();
+        buffer_pool_manager_->DeletePage(page_id);
+      }
+      break;
+    }
+    page_id = current_bucket->GetNextPageId();
+  }
+  return false;
+}
+
+/*
+ * Merge the bucket of hash with its buddy while one of them is empty, the
+ * empty one is deleted. Then halve the directory as long as no bucket needs
+ * the global depth
+ * should be called when holding the exclusive table latch
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void EXTENDIBLE_HASH_TABLE_TYPE::Merge(uint32_t hash) {
+  WritePageGuard directory_guard = FetchWrite(directory_page_id_, "Merge");
+  auto *directory =
+      reinterpret_cast<HashTableDirectoryPage *>(directory_guard.GetData());
+  while (true) {
+    uint32_t index = hash & directory->GetGlobalDepthMask();
+    uint32_t local_depth = directory->GetLocalDepth(index);
+    if (local_depth == 0) {
+      break;
+    }
+    uint32_t buddy_index = directory->GetBuddyIndex(index);
+    if (directory->GetLocalDepth(buddy_index) != local_depth) {
+      break;
+    }
+    page_id_t bucket_page_id = directory->GetBucketPageId(index);
+    page_id_t buddy_page_id = directory->GetBucketPageId(buddy_index);
+    bool bucket_empty, buddy_empty;
+    {
+      ReadPageGuard guard = FetchRead(bucket_page_id, "Merge");
+      bucket_empty = reinterpret_cast<const BucketPage *>(guard.GetData())
+                         ->IsEmpty();
+    }
+    {
+      ReadPageGuard guard = FetchRead(buddy_page_id, "Merge");
+      buddy_empty = reinterpret_cast<const BucketPage *>(guard.GetData())
+                        ->IsEmpty();
+    }
+    if (!bucket_empty && !buddy_empty) {
+      break;
+    }
+
+    // the empty one goes away
+    page_id_t kept_page_id = bucket_empty ? buddy_page_id : bucket_page_id;
+    page_id_t gone_page_id = bucket_empty ? bucket_page_id : buddy_page_id;
+    uint32_t step = 1U << (local_depth - 1);
+    for (uint32_t i = index & (step - 1); i < directory->Size(); i += step) {
+      directory->SetBucketPageId(i, kept_page_id);
+      directory->SetLocalDepth(i, local_depth - 1);
+    }
+    buffer_pool_manager_->DeletePage(gone_page_id);
+    directory_guard.MarkDirty();
+  }
+
+  while (directory->DecrGlobalDepth()) {
+    directory_guard.MarkDirty();
+  }
+}
+
+/*****************************************************************************
+ * UTILITIES AND DEBUG
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint32_t EXTENDIBLE_HASH_TABLE_TYPE::GetGlobalDepth() {
+  table_latch_.RLock();
+  uint32_t global_depth = 0;
+  if (!IsEmpty()) {
+    ReadPageGuard guard = FetchRead(directory_page_id_, "GetGlobalDepth");
+    global_depth = reinterpret_cast<const HashTableDirectoryPage *>(
+                       guard.GetData())->GetGlobalDepth();
+  }
+  table_latch_.RUnlock();
+  return global_depth;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint32_t EXTENDIBLE_HASH_TABLE_TYPE::GetNumBuckets() {
+  table_latch_.RLock();
+  uint32_t num_buckets = 0;
+  if (!IsEmpty()) {
+    ReadPageGuard guard = FetchRead(directory_page_id_, "GetNumBuckets");
+    num_buckets = reinterpret_cast<const HashTableDirectoryPage *>(
+                      guard.GetData())->GetNumBuckets();
+  }
+  table_latch_.RUnlock();
+  return num_buckets;
+}
+
+/*
+ * For every slot: the local depth is at most the global depth, all slots
+ * sharing the low local depth bits point to the same bucket, and every key of
+ * the bucket chain hashes to the slot. Overflow pages only exist at the
+ * largest local depth and are never empty
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool EXTENDIBLE_HASH_TABLE_TYPE::Check() {
+  table_latch_.RLock();
+  bool ok = true;
+  if (!IsEmpty()) {
+    ReadPageGuard directory_guard = FetchRead(directory_page_id_, "Check");
+    auto *directory = reinterpret_cast<const HashTableDirectoryPage *>(
+        directory_guard.GetData());
+    for (uint32_t i = 0; i < directory->Size() && ok; ++i) {
+      uint32_t local_depth = directory->GetLocalDepth(i);
+      uint32_t mask = (1U << local_depth) - 1;
+      page_id_t page_id = directory->GetBucketPageId(i);
+      ok = local_depth <= directory->GetGlobalDepth() &&
+           directory->GetBucketPageId(i & mask) == page_id &&
+           directory->GetLocalDepth(i & mask) == local_depth;
+      // look into each bucket once, from its first slot
+      bool first_page = true;
+      while (ok && i <= mask && page_id != INVALID_PAGE_ID) {
+        ReadPageGuard guard = FetchRead(page_id, "Check");
+        auto *bucket = reinterpret_cast<const BucketPage *>(guard.GetData());
+        ok = first_page || (!bucket->IsEmpty() &&
+                            local_depth == HASH_DIRECTORY_MAX_DEPTH);
+        for (int j = 0; j < bucket->GetSize() && ok; ++j) {
+          ok = (Hash(bucket->KeyAt(j)) & mask) == i;
+        }
+        page_id = bucket->GetNextPageId();
+        first_page = false;
+      }
+    }
+  }
+  table_latch_.RUnlock();
+  return ok;
+}
+
+/*
+ * FNV-1a over the bytes of the key
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint32_t EXTENDIBLE_HASH_TABLE_TYPE::Hash(const KeyType &key) const {
+  auto *data = reinterpret_cast<const unsigned char *>(&key);
+  uint32_t hash = 2166136261U;
+  for (size_t i = 0; i < sizeof(KeyType); ++i) {
+    hash = (hash ^ data[i]) * 16777619U;
+  }
+  return hash;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+ReadPageGuard EXTENDIBLE_HASH_TABLE_TYPE::FetchRead(page_id_t page_id,
+                                                    const char *caller) {
+  ReadPageGuard guard = buffer_pool_manager_->FetchPageRead(page_id);
+  if (!guard.IsValid()) {
+    throw Exception(EXCEPTION_TYPE_INDEX,
+                    std::string("all page are pinned while ") + caller);
+  }
+  return guard;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+WritePageGuard EXTENDIBLE_HASH_TABLE_TYPE::FetchWrite(page_id_t page_id,
+                                                      const char *caller) {
+  WritePageGuard guard = buffer_pool_manager_->FetchPageWrite(page_id);
+  if (!guard.IsValid()) {
+    throw Exception(EXCEPTION_TYPE_INDEX,
+                    std::string("all page are pinned while ") + caller);
+  }
+  return guard;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+WritePageGuard EXTENDIBLE_HASH_TABLE_TYPE::NewWrite(page_id_t &page_id,
+                                                    const char *caller) {
+  WritePageGuard guard = buffer_pool_manager_->NewPageWrite(page_id);
+  if (!guard.IsValid()) {
+    throw Exception(EXCEPTION_TYPE_INDEX,
+                    std::string("all page are pinned while ") + caller);
+  }
+  return guard;
+}
+
+template class ExtendibleHashTable<GenericKey<4>, RID, GenericComparator<4>>;
+template class ExtendibleHashTable<GenericKey<8>, RID, GenericComparator<8>>;
+template class ExtendibleHashTable<GenericKey<16>, RID, GenericComparator<16>>;
+template class ExtendibleHashTable<GenericKey<32>, RID, GenericComparator<32>>;
+template class ExtendibleHashTable<GenericKey<64>, RID, GenericComparator<64>>;
+
+} // namespace cmudb
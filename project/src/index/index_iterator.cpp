@@ -1,7 +1,9 @@
 /**
  * index_iterator.cpp
  */
+#include <algorithm>
 #include <cassert>
+#include <utility>
 
 #include "index/index_iterator.h"
 
@@ -13,17 +15,17 @@ namespace cmudb {
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 IndexIterator<KeyType, ValueType, KeyComparator>::
-IndexIterator(BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *leaf,
-              int index_, BufferPoolManager *buff_pool_manager):
-    leaf_(leaf), index_(index_), buff_pool_manager_(buff_pool_manager) {}
-
-template <typename KeyType, typename ValueType, typename KeyComparator>
-IndexIterator<KeyType, ValueType, KeyComparator>::
-~IndexIterator() {
-  buff_pool_manager_->FetchPage(leaf_->GetPageId())->RUnlatch();
-  buff_pool_manager_->UnpinPage(leaf_->GetPageId(), false);
-  buff_pool_manager_->UnpinPage(leaf_->GetPageId(), false);
-};
+IndexIterator(ReadPageGuard &&guard, int index_,
+              BufferPoolManager *buff_pool_manager):
+    guard_(std::move(guard)), leaf_(nullptr), index_(index_),
+    buff_pool_manager_(buff_pool_manager), leaves_(0) {
+  if (guard_.IsValid()) {
+    leaf_ = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType,
+                                               KeyComparator> *>(
+        guard_.GetPage()->GetData());
+  }
+  Prefetch();
+}
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool IndexIterator<KeyType, ValueType, KeyComparator>::
@@ -46,31 +48,51 @@ IndexIterator<KeyType, ValueType, KeyComparator> &IndexIterator<KeyType, ValueTy
 operator++() {
   ++index_;
   if (index_ == leaf_->GetSize() && leaf_->GetNextPageId() != INVALID_PAGE_ID) {
-    // first unpin leaf_, then get the next leaf
     page_id_t next_page_id = leaf_->GetNextPageId();
 
-    auto *page = buff_pool_manager_->FetchPage(next_page_id);
-    if (page == nullptr) {
+    auto guard = buff_pool_manager_->FetchPageRead(next_page_id);
+    if (!guard.IsValid()) {
       throw Exception(EXCEPTION_TYPE_INDEX,
                       "all page are pinned while IndexIterator(operator++)");
     }
     // first acquire next page, then release previous page
-    page->RLatch();
-
-    buff_pool_manager_->FetchPage(leaf_->GetPageId())->RUnlatch();
-    buff_pool_manager_->UnpinPage(leaf_->GetPageId(), false);
-    buff_pool_manager_->UnpinPage(leaf_->GetPageId(), false);
+    guard_ = std::move(guard);
 
     auto next_leaf =
         reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType,
-                                           KeyComparator> *>(page->GetData());
+                                           KeyComparator> *>(
+            guard_.GetPage()->GetData());
     assert(next_leaf->IsLeafPage());
     index_ = 0;
     leaf_ = next_leaf;
+    ++leaves_;
+    Prefetch();
   }
   return *this;
 };
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void IndexIterator<KeyType, ValueType, KeyComparator>::
+Prefetch() {
+  size_t window = PREFETCH_WINDOW;
+  if (leaf_ == nullptr || leaf_->GetNextPageId() == INVALID_PAGE_ID ||
+      window == 0 || leaves_ % std::max(window / 2, size_t(1)) != 0) {
+    return;
+  }
+  buff_pool_manager_->PrefetchPage(
+      leaf_->GetNextPageId(), window, [](Page *page) {
+        page->RLatch();
+        auto leaf = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType,
+                                                       KeyComparator> *>(
+            page->GetData());
+        // the page may have been reused since the link was read
+        page_id_t next_page_id =
+            leaf->IsLeafPage() ? leaf->GetNextPageId() : INVALID_PAGE_ID;
+        page->RUnlatch();
+        return next_page_id;
+      });
+}
+
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
 template class IndexIterator<GenericKey<8>, RID, GenericComparator<8>>;
 template class IndexIterator<GenericKey<16>, RID, GenericComparator<16>>;
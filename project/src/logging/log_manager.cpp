@@ -2,6 +2,8 @@
  * log_manager.cpp
  */
 
+#include <cstring>
+
 #include "logging/log_manager.h"
 
 namespace cmudb {
@@ -15,26 +17,47 @@ namespace cmudb {
 void LogManager::RunFlushThread() {
   if (!ENABLE_LOGGING) {
     ENABLE_LOGGING = true;
+    {
+      std::lock_guard<std::mutex> lock(latch_);
+      flush_running_ = true;
+    }
 
     flush_thread_ = new std::thread([&]() {
-      while (ENABLE_LOGGING) {
+      while (true) {
         std::unique_lock<std::mutex> lock(latch_);
         // timeout?
-        if (cv_.wait_for(lock, LOG_TIMEOUT) == std::cv_status::timeout &&
-            offset_ != 0) {
-          swapBuffer();
+        if (!flush_pending_ && ENABLE_LOGGING &&
+            cv_.wait_for(lock, LOG_TIMEOUT) == std::cv_status::timeout &&
+            offset_ != 0 && !flush_pending_) {
+          swapBuffer(lock);
         }
+        if (!flush_pending_) {
+          if (!ENABLE_LOGGING) {
+            // swaps from now on write the buffer themselves
+            flush_running_ = false;
+            break;
+          }
+          continue;
+        }
+        // a swap waits for this write, flush_buffer_ is left alone meanwhile
         lsn_t delta = flush_lsn_;
+        lsn_t first = flush_first_lsn_;
+        std::promise<void> *flushed = promise;
+        promise = nullptr;
         lock.unlock();
 
-        if (ENABLE_LOGGING && !disk_manager_->GetFlushState()
-            && persistent_lsn_ + 1 != next_lsn_) {
-          disk_manager_->WriteLog(flush_buffer_, LOG_BUFFER_SIZE);
-          SetPersistentLSN(delta);
+        // only this thread writes the log
+        int64_t start = disk_manager_->GetLogSize();
+        disk_manager_->WriteLog(flush_buffer_, LOG_BUFFER_SIZE);
+        SetPersistentLSN(delta);
+        lock.lock();
+        flushed_offsets_[first] = start;
+        flush_pending_ = false;
+        lock.unlock();
+        flushed_cv_.notify_all();
 
-          if (promise != nullptr) {
-            promise->set_value();
-          }
+        if (flushed != nullptr) {
+          flushed->set_value();
         }
       }
     });
@@ -55,29 +78,65 @@ void LogManager::StopFlushThread() {
       lock.unlock();
       flush_thread_->join();
     }
+    delete flush_thread_;
+    flush_thread_ = nullptr;
   }
 }
 
 /*
+ * Wait until the previous flush buffer is written, then hand the records
+ * over to the flush thread, or write them right away when it is not running,
+ * e.g. before RunFlushThread or after StopFlushThread. Return false if there
+ * are none
  * should be called when holding the lock
  */
-inline void LogManager::swapBuffer() {
+inline bool LogManager::swapBuffer(std::unique_lock<std::mutex> &lock) {
+  flushed_cv_.wait(lock, [this]() { return !flush_pending_; });
+  if (offset_ == 0) {
+    return false;
+  }
+  // the whole buffer is written, recovery stops at the zeros after the last
+  // record instead of replaying what a previous flush left there
+  memset(log_buffer_ + offset_, 0, LOG_BUFFER_SIZE - offset_);
   char *tmp = log_buffer_;
   log_buffer_ = flush_buffer_;
   flush_buffer_ = tmp;
 
   offset_ = 0;
+  flush_first_lsn_ = flush_lsn_ + 1;
   flush_lsn_ = next_lsn_ - 1;
+  flush_pending_ = true;
+  if (!flush_running_) {
+    writeFlushBuffer();
+  }
+  return true;
+}
+
+/*
+ * Write flush_buffer_ without a flush thread, holding the lock
+ */
+void LogManager::writeFlushBuffer() {
+  int64_t start = disk_manager_->GetLogSize();
+  disk_manager_->WriteLog(flush_buffer_, LOG_BUFFER_SIZE);
+  SetPersistentLSN(flush_lsn_);
+  flushed_offsets_[flush_first_lsn_] = start;
+  flush_pending_ = false;
 }
 
 /*
  * wake up flush thread, only called by buffer pool manager
- * when it wants to force flush
+ * when it wants to force flush. The records appended so far are durable on
+ * return
  */
 void LogManager::WakeupFlushThread(std::promise<void> *promise) {
+  std::lock_guard<std::mutex> wakeup_lock(wakeup_latch_);
   {
-    std::lock_guard<std::mutex> lock(latch_);
-    swapBuffer();
+    std::unique_lock<std::mutex> lock(latch_);
+    if (!swapBuffer(lock) || !flush_pending_) {
+      // nothing new and the flush in progress was waited for, or the
+      // records were written without the flush thread
+      return;
+    }
     SetPromise(promise);
   }
 
@@ -88,7 +147,52 @@ void LogManager::WakeupFlushThread(std::promise<void> *promise) {
   if (promise != nullptr) {
     promise->get_future().wait();
   }
-  SetPromise(nullptr);
+}
+
+/*
+ * wake up flush thread without waiting, only called by buffer pool manager
+ * when it sees victims whose LSN is not durable yet. A flush in progress, or
+ * a forced one, does the job already: the records are taken by the next one
+ */
+void LogManager::RequestFlush() {
+  std::unique_lock<std::mutex> wakeup_lock(wakeup_latch_, std::try_to_lock);
+  if (!wakeup_lock.owns_lock()) {
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(latch_);
+    if (offset_ == 0 || flush_pending_) {
+      return;
+    }
+    swapBuffer(lock);
+  }
+  cv_.notify_one();
+}
+
+/*
+ * Unlink the log files holding only records below lsn. The caller passes the
+ * oldest LSN recovery still needs: the pages changed by the records below it
+ * are on disk, e.g. after FlushAllPages. The records of the active
+ * transactions and those not written yet are kept whatever lsn is
+ * @return: the number of files unlinked
+ */
+int LogManager::DiscardLog(lsn_t lsn) {
+  int64_t offset;
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    for (auto &txn : active_txn_) {
+      lsn = std::min(lsn, txn.second);
+    }
+    // the buffer written holding lsn, or the last one written before it
+    auto it = flushed_offsets_.upper_bound(lsn);
+    if (it == flushed_offsets_.begin()) {
+      return 0;
+    }
+    --it;
+    offset = it->second;
+    flushed_offsets_.erase(flushed_offsets_.begin(), it);
+  }
+  return disk_manager_->DiscardLog(offset);
 }
 
 /*
@@ -112,11 +216,11 @@ void LogManager::WakeupFlushThread(std::promise<void> *promise) {
  *
  */
 lsn_t LogManager::AppendLogRecord(LogRecord &log_record) {
-  std::lock_guard<std::mutex> lock(latch_);
+  std::unique_lock<std::mutex> lock(latch_);
 
   // log_buffer is almost full?
   if (offset_ + log_record.size_ > LOG_BUFFER_SIZE) {
-    swapBuffer();
+    swapBuffer(lock);
     // wake up flush thread
     cv_.notify_one();
   }
@@ -124,6 +228,14 @@ lsn_t LogManager::AppendLogRecord(LogRecord &log_record) {
   // First, serialize the must have fields(20 bytes in total)
   log_record.lsn_ = next_lsn_++;
 
+  // undo follows an active transaction back to its BEGIN
+  if (log_record.log_record_type_ == LogRecordType::BEGIN) {
+    active_txn_.emplace(log_record.txn_id_, log_record.lsn_);
+  } else if (log_record.log_record_type_ == LogRecordType::COMMIT ||
+             log_record.log_record_type_ == LogRecordType::ABORT) {
+    active_txn_.erase(log_record.txn_id_);
+  }
+
   // for begin/commit/abort, we are done
   memcpy(log_buffer_ + offset_, &log_record, LogRecord::HEADER_SIZE);
   int pos = offset_ + LogRecord::HEADER_SIZE;
@@ -154,6 +266,8 @@ lsn_t LogManager::AppendLogRecord(LogRecord &log_record) {
   } else if (log_record.log_record_type_ == LogRecordType::NEWPAGE) {
     // for new page
     memcpy(log_buffer_ + pos, &log_record.prev_page_id_, sizeof(page_id_t));
+    memcpy(log_buffer_ + pos + sizeof(page_id_t), &log_record.page_id_,
+           sizeof(page_id_t));
   }
 
   offset_ += log_record.size_;
@@ -56,6 +56,8 @@ bool LogRecovery::DeserializeLogRecord(const char *data,
   case LogRecordType::NEWPAGE: {
     log_record.prev_page_id_ = *reinterpret_cast<const page_id_t *>(
         data + LogRecord::HEADER_SIZE);
+    log_record.page_id_ = *reinterpret_cast<const page_id_t *>(
+        data + LogRecord::HEADER_SIZE + sizeof(page_id_t));
     break;
   }
   default:break;
@@ -71,8 +73,8 @@ bool LogRecovery::DeserializeLogRecord(const char *data,
  *lsn_mapping_ table
  */
 void LogRecovery::Redo() {
-  // no checkpoint support, always replay history from start
-  offset_ = 0;
+  // no checkpoint support, replay history from the oldest log file kept
+  offset_ = disk_manager_->GetLogStart();
 
   // ENABLE_LOGGING must be false when recovery
   assert(ENABLE_LOGGING == false);
@@ -150,35 +152,36 @@ void LogRecovery::Redo() {
 
         } else if (log.GetLogRecordType() == LogRecordType::NEWPAGE) {
           page_id_t pre_page_id = log.prev_page_id_;
-          TablePage *page;
+          page_id_t page_id = log.page_id_;
+          // page ids are reused, the allocation may not have been persisted
+          // before the crash
+          disk_manager_->ReservePage(page_id);
+          auto *page = reinterpret_cast<TablePage *>(
+              buffer_pool_manager_->FetchPage(page_id));
+          assert(page != nullptr);
 
-          // the first page
-          if (pre_page_id == INVALID_PAGE_ID) {
-            page = reinterpret_cast<TablePage *>(
-                buffer_pool_manager_->NewPage(pre_page_id));
-            assert(page != nullptr);
+          // log is newer than disk page?
+          if (log.GetLSN() > page->GetLSN()) {
             page->WLatch();
-            page->Init(pre_page_id, PAGE_SIZE, INVALID_PAGE_ID, nullptr, nullptr);
+            page->Init(page_id, PAGE_DATA_SIZE, pre_page_id, nullptr, nullptr);
+            page->SetLSN(log.GetLSN());
             page->WUnlatch();
-          } else {
+          }
+          buffer_pool_manager_->UnpinPage(page_id, true);
+
+          // link it after the previous page
+          if (pre_page_id != INVALID_PAGE_ID) {
             page = reinterpret_cast<TablePage *>(
                 buffer_pool_manager_->FetchPage(pre_page_id));
             assert(page != nullptr);
-
-            if (page->GetNextPageId() == INVALID_PAGE_ID) {
-              // alloc a new page
-              page_id_t new_page_id;
-              auto *new_page = reinterpret_cast<TablePage *>(
-                  buffer_pool_manager_->NewPage(new_page_id));
-              assert(new_page != nullptr);
+            bool linked = page->GetNextPageId() == page_id;
+            if (!linked) {
               page->WLatch();
-              page->SetNextPageId(new_page_id);
+              page->SetNextPageId(page_id);
               page->WUnlatch();
-
-              buffer_pool_manager_->UnpinPage(new_page_id, false);
             }
+            buffer_pool_manager_->UnpinPage(pre_page_id, !linked);
           }
-          buffer_pool_manager_->UnpinPage(pre_page_id, true);
         }
       }
       buffer_offset_ += log.GetSize();
@@ -198,12 +201,14 @@ void LogRecovery::Undo() {
   char buffer[PAGE_SIZE];
 
   for (auto it = active_txn_.begin(); it != active_txn_.end(); ++it) {
-    auto offset_ = lsn_mapping_[it->second];
+    auto mapping = lsn_mapping_.find(it->second);
     LogRecord log;
 
-    // read log record, undo it, then get the pre_lsn
-    disk_manager_->ReadLog(buffer, offset_, PAGE_SIZE);
-    while (DeserializeLogRecord(buffer, log)) {
+    // read log record, undo it, then get the pre_lsn. The log before the
+    // BEGIN of an active transaction is never discarded
+    while (mapping != lsn_mapping_.end() &&
+           disk_manager_->ReadLog(buffer, PAGE_SIZE, mapping->second) &&
+           DeserializeLogRecord(buffer, log)) {
       if (log.log_record_type_ == LogRecordType::BEGIN) {
         // current txn is done
         break;
@@ -251,8 +256,7 @@ void LogRecovery::Undo() {
         buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
       }
 
-      offset_ = lsn_mapping_[log.prev_lsn_];
-      disk_manager_->ReadLog(buffer, offset_, PAGE_SIZE);
+      mapping = lsn_mapping_.find(log.prev_lsn_);
     }
   }
 
@@ -29,7 +29,7 @@ Init(page_id_t page_id, page_id_t parent_id) {
   SetParentPageId(parent_id);
 
   // set max page size, header is 24bytes
-  int size = (PAGE_SIZE - sizeof(BPlusTreeInternalPage))/
+  int size = (PAGE_DATA_SIZE - sizeof(BPlusTreeInternalPage))/
       (sizeof(KeyType) + sizeof(ValueType));
   SetMaxSize(size);
 }
@@ -36,7 +36,7 @@ Init(page_id_t page_id, page_id_t parent_id) {
   SetNextPageId(INVALID_PAGE_ID);
 
   // set max page size, header is 28bytes
-  int size = (PAGE_SIZE - sizeof(BPlusTreeLeafPage))/
+  int size = (PAGE_DATA_SIZE - sizeof(BPlusTreeLeafPage))/
       (sizeof(KeyType) + sizeof(ValueType));
   SetMaxSize(size);
 }
@@ -0,0 +1,74 @@
+/**
+ * hash_table_bucket_page.cpp
+ */
+
+#include <cassert>
+
+#include "common/rid.h"
+#include "index/generic_key.h"
+#include "page/hash_table_bucket_page.h"
+
+namespace cmudb {
+
+/*
+ * Init method after creating a new bucket or overflow page
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_BUCKET_TYPE::Init(page_id_t page_id) {
+  page_id_ = page_id;
+  lsn_ = INVALID_LSN;
+  size_ = 0;
+  next_page_id_ = INVALID_PAGE_ID;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+int HASH_TABLE_BUCKET_TYPE::GetMaxSize() {
+  return (PAGE_DATA_SIZE - sizeof(HashTableBucketPage)) /
+         sizeof(std::pair<KeyType, ValueType>);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+const KeyType &HASH_TABLE_BUCKET_TYPE::KeyAt(int index) const {
+  assert(0 <= index && index < size_);
+  return array_[index].first;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+const ValueType &HASH_TABLE_BUCKET_TYPE::ValueAt(int index) const {
+  assert(0 <= index && index < size_);
+  return array_[index].second;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+int HASH_TABLE_BUCKET_TYPE::KeyIndex(const KeyType &key,
+                                     const KeyComparator &comparator) const {
+  for (int i = 0; i < size_; ++i) {
+    if (comparator(key, array_[i].first) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_BUCKET_TYPE::Insert(const KeyType &key,
+                                    const ValueType &value) {
+  assert(!IsFull());
+  array_[size_].first = key;
+  array_[size_].second = value;
+  ++size_;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_BUCKET_TYPE::RemoveAt(int index) {
+  assert(0 <= index && index < size_);
+  array_[index] = array_[--size_];
+}
+
+template class HashTableBucketPage<GenericKey<4>, RID, GenericComparator<4>>;
+template class HashTableBucketPage<GenericKey<8>, RID, GenericComparator<8>>;
+template class HashTableBucketPage<GenericKey<16>, RID, GenericComparator<16>>;
+template class HashTableBucketPage<GenericKey<32>, RID, GenericComparator<32>>;
+template class HashTableBucketPage<GenericKey<64>, RID, GenericComparator<64>>;
+
+} // namespace cmudb
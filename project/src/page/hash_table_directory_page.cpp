@@ -0,0 +1,89 @@
+/**
+ * hash_table_directory_page.cpp
+ */
+
+#include <cassert>
+
+#include "page/hash_table_directory_page.h"
+
+namespace cmudb {
+
+/*
+ * Init method after creating a new directory page, a single bucket of local
+ * depth 0 takes every key
+ */
+void HashTableDirectoryPage::Init(page_id_t page_id,
+                                  page_id_t bucket_page_id) {
+  page_id_ = page_id;
+  lsn_ = INVALID_LSN;
+  global_depth_ = 0;
+  bucket_page_ids_[0] = bucket_page_id;
+  local_depths_[0] = 0;
+}
+
+void HashTableDirectoryPage::IncrGlobalDepth() {
+  assert(global_depth_ < HASH_DIRECTORY_MAX_DEPTH);
+  uint32_t size = Size();
+  for (uint32_t i = 0; i < size; ++i) {
+    bucket_page_ids_[i + size] = bucket_page_ids_[i];
+    local_depths_[i + size] = local_depths_[i];
+  }
+  ++global_depth_;
+}
+
+bool HashTableDirectoryPage::DecrGlobalDepth() {
+  if (global_depth_ == 0) {
+    return false;
+  }
+  for (uint32_t i = 0; i < Size(); ++i) {
+    if (local_depths_[i] == global_depth_) {
+      return false;
+    }
+  }
+  --global_depth_;
+  return true;
+}
+
+page_id_t HashTableDirectoryPage::GetBucketPageId(uint32_t index) const {
+  assert(index < Size());
+  return bucket_page_ids_[index];
+}
+
+void HashTableDirectoryPage::SetBucketPageId(uint32_t index,
+                                             page_id_t bucket_page_id) {
+  assert(index < Size());
+  bucket_page_ids_[index] = bucket_page_id;
+}
+
+uint32_t HashTableDirectoryPage::GetLocalDepth(uint32_t index) const {
+  assert(index < Size());
+  return local_depths_[index];
+}
+
+void HashTableDirectoryPage::SetLocalDepth(uint32_t index,
+                                           uint32_t local_depth) {
+  assert(index < Size() && local_depth <= global_depth_);
+  local_depths_[index] = static_cast<uint8_t>(local_depth);
+}
+
+uint32_t HashTableDirectoryPage::GetBuddyIndex(uint32_t index) const {
+  uint32_t local_depth = GetLocalDepth(index);
+  assert(local_depth > 0);
+  return index ^ (1U << (local_depth - 1));
+}
+
+/*
+ * a bucket is counted at the first slot pointing to it, the one below
+ * 2^local depth
+ */
+uint32_t HashTableDirectoryPage::GetNumBuckets() const {
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < Size(); ++i) {
+    if (i < (1U << local_depths_[i])) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+} // namespace cmudb
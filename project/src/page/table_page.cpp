@@ -16,7 +16,7 @@ void TablePage::Init(page_id_t page_id, size_t page_size,
   memcpy(GetData(), &page_id, 4); // set page_id
   if (ENABLE_LOGGING) {
     LogRecord log(txn->GetTransactionId(), txn->GetPrevLSN(),
-                  LogRecordType::NEWPAGE, prev_page_id);
+                  LogRecordType::NEWPAGE, prev_page_id, page_id);
     lsn_t lsn = log_manager->AppendLogRecord(log);
     txn->SetPrevLSN(lsn);
     SetLSN(lsn);
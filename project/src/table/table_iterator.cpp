@@ -2,19 +2,39 @@
  * table_iterator.cpp
  */
 
+#include <algorithm>
 #include <cassert>
 
 #include "table/table_heap.h"
 
 namespace cmudb {
 
-TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
+TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                             ScanRing *ring)
+    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn), ring_(ring),
+      pages_(0) {
   if (rid.GetPageId() != INVALID_PAGE_ID) {
-    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
+    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_, ring_);
+    Prefetch(rid.GetPageId());
   }
 };
 
+// deep copy, each iterator owns its tuple
+TableIterator::TableIterator(const TableIterator &other)
+    : table_heap_(other.table_heap_), tuple_(new Tuple(*other.tuple_)),
+      txn_(other.txn_), ring_(other.ring_), pages_(other.pages_) {}
+
+TableIterator &TableIterator::operator=(const TableIterator &other) {
+  if (this != &other) {
+    table_heap_ = other.table_heap_;
+    *tuple_ = *other.tuple_;
+    txn_ = other.txn_;
+    ring_ = other.ring_;
+    pages_ = other.pages_;
+  }
+  return *this;
+}
+
 const Tuple &TableIterator::operator*() {
   assert(*this != table_heap_->end());
   return *tuple_;
@@ -25,23 +45,27 @@ Tuple *TableIterator::operator->() {
   return tuple_;
 }
 
+/*
+ * The tuple is read from the page the next rid was found on, which is
+ * fetched and latched only once
+ */
 TableIterator &TableIterator::operator++() {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
-  auto cur_page = static_cast<TablePage *>(
-      buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
-  assert(cur_page != nullptr); // all pages are pinned
-  cur_page->RLatch();
+  ReadPageGuard guard =
+      buffer_pool_manager->FetchPageRead(tuple_->rid_.GetPageId(), ring_);
+  assert(guard.IsValid()); // all pages are pinned
+  auto cur_page = static_cast<TablePage *>(guard.GetPage());
 
   RID next_tuple_rid;
   if (!cur_page->GetNextTupleRid(tuple_->rid_,
                                  next_tuple_rid)) { // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(
-          buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
-      cur_page->RUnlatch();
-      buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
-      cur_page = next_page;
-      cur_page->RLatch();
+      guard = buffer_pool_manager->FetchPageRead(cur_page->GetNextPageId(),
+                                                 ring_);
+      assert(guard.IsValid());
+      cur_page = static_cast<TablePage *>(guard.GetPage());
+      ++pages_;
+      Prefetch(cur_page->GetPageId());
       if (cur_page->GetFirstTupleRid(next_tuple_rid))
         break;
     }
@@ -49,11 +73,8 @@ TableIterator &TableIterator::operator++() {
   tuple_->rid_ = next_tuple_rid;
 
   if (*this != table_heap_->end()) {
-    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
+    cur_page->GetTuple(tuple_->rid_, *tuple_, txn_, table_heap_->lock_manager_);
   }
-  // release until copy the tuple
-  cur_page->RUnlatch();
-  buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
   return *this;
 }
 
@@ -63,4 +84,21 @@ TableIterator TableIterator::operator++(int) {
   return clone;
 }
 
+void TableIterator::Prefetch(page_id_t page_id) {
+  size_t window = PREFETCH_WINDOW;
+  if (window == 0 || pages_ % std::max(window / 2, size_t(1)) != 0) {
+    return;
+  }
+  // the chain starts at page_id, which the scan is reading already
+  table_heap_->buffer_pool_manager_->PrefetchPage(
+      page_id, window + 1, [](Page *page) {
+        auto table_page = static_cast<TablePage *>(page);
+        table_page->RLatch();
+        page_id_t next_page_id = table_page->GetNextPageId();
+        table_page->RUnlatch();
+        return next_page_id;
+      },
+      ring_);
+}
+
 } // namespace cmudb
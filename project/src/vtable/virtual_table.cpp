@@ -2,6 +2,7 @@
  * virtual_table.cpp
  */
 #include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <sys/stat.h>
@@ -36,14 +37,26 @@ int VtabCreate(sqlite3 *db, void *pAux, int argc, const char *const *argv,
   schema_string = schema_string.substr(1, (schema_string.size() - 2));
   Schema *schema = ParseCreateStatement(schema_string);
 
-  // parse arg[4](string that defines table index)
+  // parse arg[4..](string that defines table index, then settings)
   Index *index = nullptr;
-  if (argc > 4) {
-    std::string index_string(argv[4]);
-    index_string = index_string.substr(1, (index_string.size() - 2));
+  IndexMetadata *index_metadata = nullptr;
+  try {
+    std::string index_string =
+        ParseArguments(argc, argv, buffer_pool_manager);
+    if (!index_string.empty()) {
+      index_metadata =
+          ParseIndexStatement(index_string, std::string(argv[2]), schema);
+    }
+  } catch (Exception &e) {
+    // e.g. an unknown setting or index type, report it instead of unwinding
+    // into sqlite
+    *pzErr = sqlite3_mprintf("%s", e.what());
+    buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, false);
+    delete schema;
+    return SQLITE_ERROR;
+  }
+  if (index_metadata != nullptr) {
     // create index object, allocate memory space
-    IndexMetadata *index_metadata =
-        ParseIndexStatement(index_string, std::string(argv[2]), schema);
     index = ConstructIndex(index_metadata, buffer_pool_manager);
   }
   // create table object, allocate memory space
@@ -81,14 +94,24 @@ int VtabConnect(sqlite3 *db, void *pAux, int argc, const char *const *argv,
       static_cast<HeaderPage *>(buffer_pool_manager->FetchPage(HEADER_PAGE_ID));
   page_id_t table_root_id;
   header_page->GetRootId(std::string(argv[2]), table_root_id);
-  // parse arg[4](string that defines table index)
+  // parse arg[4..](string that defines table index, then settings)
   Index *index = nullptr;
-  if (argc > 4) {
-    std::string index_string(argv[4]);
-    index_string = index_string.substr(1, (index_string.size() - 2));
+  IndexMetadata *index_metadata = nullptr;
+  try {
+    std::string index_string =
+        ParseArguments(argc, argv, buffer_pool_manager);
+    if (!index_string.empty()) {
+      index_metadata =
+          ParseIndexStatement(index_string, std::string(argv[2]), schema);
+    }
+  } catch (Exception &e) {
+    *pzErr = sqlite3_mprintf("%s", e.what());
+    buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, false);
+    delete schema;
+    return SQLITE_ERROR;
+  }
+  if (index_metadata != nullptr) {
     // create index object, allocate memory space
-    IndexMetadata *index_metadata =
-        ParseIndexStatement(index_string, std::string(argv[2]), schema);
     // Retrieve index root page info from header page
     page_id_t index_root_id;
     header_page->GetRootId(index_metadata->GetName(), index_root_id);
@@ -196,6 +219,10 @@ int VtabFilter(sqlite3_vtab_cursor *pVtabCursor, int idxNum, const char *idxStr,
     key_schema = cursor->GetKeySchema();
     Tuple scan_tuple = ConstructTuple(key_schema, argv);
     cursor->ScanKey(scan_tuple);
+  } else {
+    // full scan should not evict the working set of others
+    cursor->SetScanFlag(false);
+    cursor->ScanTable();
   }
   return SQLITE_OK;
 }
@@ -359,7 +386,13 @@ __declspec(dllexport)
   bool is_file_exist = (stat(db_file_name.c_str(), &buffer) == 0);
 
   // init storage engine
-  storage_engine_ = new StorageEngine(db_file_name);
+  try {
+    storage_engine_ = new StorageEngine(db_file_name);
+  } catch (Exception &e) {
+    // e.g. not a db file, report it instead of unwinding into sqlite
+    *pzErrMsg = sqlite3_mprintf("%s", e.what());
+    return SQLITE_ERROR;
+  }
   // start the logging
   storage_engine_->log_manager_->RunFlushThread();
   // create header page from BufferPoolManager if necessary
@@ -451,6 +484,20 @@ IndexMetadata *ParseIndexStatement(std::string &sql,
   index_name = sql.substr(0, n);
   sql = sql.substr(n + 1);
 
+  // optional data structure after the columns, e.g. 'foo_pk a using hash'
+  IndexType index_type = IndexType::BPLUSTREE;
+  n = sql.find(" using ");
+  if (n != std::string::npos) {
+    std::string type = sql.substr(n + 7);
+    StringUtility::Trim(type);
+    if (type == "hash") {
+      index_type = IndexType::HASH;
+    } else if (type != "btree") {
+      throw Exception(EXCEPTION_TYPE_INDEX, "unknown index type " + type);
+    }
+    sql = sql.substr(0, n);
+  }
+
   std::vector<std::string> tok = StringUtility::Split(sql, ',');
   // iterate through returned result
   for (std::string &t : tok) {
@@ -463,7 +510,7 @@ IndexMetadata *ParseIndexStatement(std::string &sql,
     throw Exception(EXCEPTION_TYPE_INDEX, "can't create index, format error");
 
   IndexMetadata *metadata =
-      new IndexMetadata(index_name, table_name, schema, key_attrs);
+      new IndexMetadata(index_name, table_name, schema, key_attrs, index_type);
 
   // LOG_DEBUG("%s", metadata->ToString().c_str());
   return metadata;
@@ -504,7 +551,8 @@ Tuple ConstructTuple(Schema *schema, sqlite3_value **argv) {
   return tuple;
 }
 
-// serve the functionality of index factory
+// serve the functionality of index factory, root_id is the directory page
+// of a hash index
 Index *ConstructIndex(IndexMetadata *metadata,
                       BufferPoolManager *buffer_pool_manager,
                       page_id_t root_id) {
@@ -514,6 +562,25 @@ Index *ConstructIndex(IndexMetadata *metadata,
   // for each varchar attribute, we assume the largest size is 16 bytes
   key_size += 16 * key_schema->GetUnlinedColumnCount();
 
+  if (metadata->GetIndexType() == IndexType::HASH) {
+    if (key_size <= 4) {
+      return new HashTableIndex<GenericKey<4>, RID, GenericComparator<4>>(
+          metadata, buffer_pool_manager, root_id);
+    } else if (key_size <= 8) {
+      return new HashTableIndex<GenericKey<8>, RID, GenericComparator<8>>(
+          metadata, buffer_pool_manager, root_id);
+    } else if (key_size <= 16) {
+      return new HashTableIndex<GenericKey<16>, RID, GenericComparator<16>>(
+          metadata, buffer_pool_manager, root_id);
+    } else if (key_size <= 32) {
+      return new HashTableIndex<GenericKey<32>, RID, GenericComparator<32>>(
+          metadata, buffer_pool_manager, root_id);
+    } else {
+      return new HashTableIndex<GenericKey<64>, RID, GenericComparator<64>>(
+          metadata, buffer_pool_manager, root_id);
+    }
+  }
+
   if (key_size <= 4) {
     return new BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>(
         metadata, buffer_pool_manager, root_id);
@@ -534,4 +601,57 @@ Index *ConstructIndex(IndexMetadata *metadata,
 
 Transaction *GetTransaction() { return global_transaction_; }
 
+/*
+ * Number of buffer pool frames, taken from the VTABLE_BUFFER_POOL_SIZE
+ * environment variable if set, BUFFER_POOL_SIZE otherwise
+ */
+size_t GetBufferPoolSize() {
+  const char *env = getenv("VTABLE_BUFFER_POOL_SIZE");
+  if (env != nullptr) {
+    size_t pool_size = strtoul(env, nullptr, 10);
+    if (pool_size > 0) {
+      return pool_size;
+    }
+  }
+  return BUFFER_POOL_SIZE;
+}
+
+/*
+ * Arguments following the schema: a quoted index definition and unquoted
+ * settings, e.g.
+ * CREATE VIRTUAL TABLE foo USING vtable('a int', 'foo_pk a',
+ *                                       buffer_pool_size=64)
+ * Settings are applied right away, return the index definition without
+ * quotes or an empty string
+ */
+std::string ParseArguments(int argc, const char *const *argv,
+                           BufferPoolManager *buffer_pool_manager) {
+  std::string index_string;
+  for (int i = 4; i < argc; ++i) {
+    std::string arg(argv[i]);
+    StringUtility::Trim(arg);
+    if (arg.size() >= 2 && (arg[0] == '\'' || arg[0] == '"')) {
+      // remove the very first and last character
+      if (index_string.empty()) {
+        index_string = arg.substr(1, (arg.size() - 2));
+      }
+      continue;
+    }
+    std::vector<std::string> tok = StringUtility::Split(arg, '=');
+    if (tok.size() != 2) {
+      throw Exception(EXCEPTION_TYPE_SYNTAX, "bad argument " + arg);
+    }
+    if (tok[0] == "buffer_pool_size") {
+      size_t pool_size = strtoul(tok[1].c_str(), nullptr, 10);
+      if (!buffer_pool_manager->Resize(pool_size)) {
+        throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE,
+                        "bad buffer pool size " + tok[1]);
+      }
+    } else {
+      throw Exception(EXCEPTION_TYPE_SYNTAX, "unknown setting " + tok[0]);
+    }
+  }
+  return index_string;
+}
+
 } // namespace cmudb
@@ -0,0 +1,158 @@
+/**
+ * arc_replacer_test.cpp
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "buffer/arc_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "buffer/replacer_test_util.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ARCReplacerTest, SampleTest) {
+  ARCReplacer<int> arc_replacer(3);
+  int value;
+
+  // frame i holds page 10 + i
+  for (int i = 0; i < 3; ++i) {
+    arc_replacer.RecordAccess(i, 10 + i);
+    arc_replacer.Insert(i);
+  }
+  EXPECT_EQ(3, arc_replacer.Size());
+
+  // page 10 is used again and moves to T2
+  arc_replacer.Erase(0);
+  arc_replacer.RecordAccess(0, 10);
+  arc_replacer.Insert(0);
+
+  // T1 is over its target, the LRU page of T1 goes to B1
+  arc_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  EXPECT_EQ(0, arc_replacer.GetTarget());
+
+  // page 11 comes back: ghost hit in B1, T1 should have been larger
+  arc_replacer.RecordAccess(1, 11);
+  EXPECT_EQ(1, arc_replacer.GetTarget());
+  arc_replacer.Insert(1);
+
+  // T1 is at its target now, evict from T2 and remember page 10 in B2
+  arc_replacer.Victim(value);
+  EXPECT_EQ(0, value);
+
+  // page 10 comes back: ghost hit in B2, T1 should have been smaller
+  arc_replacer.RecordAccess(0, 10);
+  EXPECT_EQ(0, arc_replacer.GetTarget());
+
+  // pinned values are never evicted
+  EXPECT_EQ(true, arc_replacer.Erase(2));
+  EXPECT_EQ(true, arc_replacer.Victim(value));
+  EXPECT_EQ(1, value);
+  EXPECT_EQ(false, arc_replacer.Victim(value));
+  EXPECT_EQ(0, arc_replacer.Size());
+}
+
+TEST(ARCReplacerTest, PeekTest) {
+  ARCReplacer<int> arc_replacer(10);
+  for (int i = 0; i < 10; ++i) {
+    arc_replacer.RecordAccess(i, i);
+    arc_replacer.Insert(i);
+  }
+  for (int i = 1; i < 10; i += 3) {
+    arc_replacer.RecordAccess(i, i);
+  }
+  arc_replacer.Erase(2);
+  ExpectPeekMatchesVictims(arc_replacer);
+}
+
+TEST(ARCReplacerTest, EvictTest) {
+  ARCReplacer<int> arc_replacer(3);
+  int value;
+  for (int i = 0; i < 3; ++i) {
+    arc_replacer.RecordAccess(i, 10 + i);
+    arc_replacer.Insert(i);
+  }
+
+  // evicting a chosen value remembers its page like Victim does
+  EXPECT_EQ(true, arc_replacer.Evict(2));
+  EXPECT_EQ(false, arc_replacer.Evict(2));
+  EXPECT_EQ(2, arc_replacer.Size());
+  arc_replacer.RecordAccess(2, 12);
+  EXPECT_EQ(1, arc_replacer.GetTarget());
+
+  // not evictable
+  arc_replacer.Erase(0);
+  EXPECT_EQ(false, arc_replacer.Evict(0));
+  arc_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  EXPECT_EQ(false, arc_replacer.Victim(value));
+}
+
+TEST(ARCReplacerTest, BenchmarkTest) {
+  const int num_frames = 32;
+  const int num_hot = 24;
+  const int num_cold = 200;
+  std::mt19937 gen(15445);
+
+  // reporting: point lookups on a hot set interleaved with full scans
+  std::uniform_int_distribution<int> hot(0, num_hot - 1);
+  std::vector<std::pair<int, bool>> frequency;
+  for (int cycle = 0; cycle < 50; ++cycle) {
+    for (int i = 0; i < 200; ++i) {
+      frequency.emplace_back(hot(gen), true);
+    }
+    for (int page_id = 0; page_id < num_cold; ++page_id) {
+      frequency.emplace_back(num_hot + page_id, false);
+    }
+  }
+
+  // OLTP: the working set drifts, recently created pages are the hot ones
+  std::vector<std::pair<int, bool>> recency;
+  for (int page_id = 0; page_id < 4000; ++page_id) {
+    recency.emplace_back(10000 + page_id, false);
+    std::uniform_int_distribution<int> recent(std::max(0, page_id - 24),
+                                              page_id);
+    for (int i = 0; i < 4; ++i) {
+      recency.emplace_back(10000 + recent(gen), true);
+    }
+  }
+
+  // the workload shifts during the day
+  std::vector<std::pair<int, bool>> mixed;
+  for (int i = 0; i < 2; ++i) {
+    mixed.insert(mixed.end(), frequency.begin(), frequency.end());
+    mixed.insert(mixed.end(), recency.begin(), recency.end());
+  }
+
+  std::vector<std::pair<int, bool>> *workloads[] = {&frequency, &recency,
+                                                     &mixed};
+  const char *names[] = {"frequency", "recency", "mixed"};
+  double lru_ratios[3], lru_k_ratios[3], arc_ratios[3];
+  for (int i = 0; i < 3; ++i) {
+    LRUReplacer<int> lru;
+    LRUKReplacer<int> lru_k;
+    ARCReplacer<int> arc(num_frames);
+    double lru_ratio = HitRatio(lru, num_frames, *workloads[i]);
+    double lru_k_ratio = HitRatio(lru_k, num_frames, *workloads[i]);
+    double arc_ratio = HitRatio(arc, num_frames, *workloads[i]);
+    printf("%s hit ratio: lru %.3f, lru-2 %.3f, arc %.3f\n", names[i],
+           lru_ratio, lru_k_ratio, arc_ratio);
+    lru_ratios[i] = lru_ratio;
+    lru_k_ratios[i] = lru_k_ratio;
+    arc_ratios[i] = arc_ratio;
+  }
+  // ARC follows LRU-2 on the frequency workload, LRU on the recency one
+  // and beats both once the workload shifts
+  EXPECT_GT(arc_ratios[0], lru_ratios[0]);
+  EXPECT_GT(arc_ratios[1], lru_k_ratios[1]);
+  EXPECT_GT(arc_ratios[1], 0.9 * lru_ratios[1]);
+  EXPECT_GT(arc_ratios[2], lru_ratios[2]);
+  EXPECT_GT(arc_ratios[2], lru_k_ratios[2]);
+}
+
+} // namespace cmudb
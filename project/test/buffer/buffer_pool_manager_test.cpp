@@ -2,13 +2,31 @@
  * buffer_pool_manager_test.cpp
  */
 
+#include <chrono>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
 
 namespace cmudb {
 
+// wait until the read-ahead thread has carried out num_requests requests
+static bool WaitForPrefetches(BufferPoolManager *bpm, uint64_t num_requests) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (bpm->GetStats().prefetches < num_requests) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
 TEST(BufferPoolManagerTest, SampleTest) {
   page_id_t temp_page_id;
 
@@ -48,4 +66,880 @@ TEST(BufferPoolManagerTest, SampleTest) {
   remove("test.db");
 }
 
+TEST(BufferPoolManagerTest, ClockReplacerTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager, nullptr, 1,
+                                                 ReplacerType::CLOCK);
+
+  auto page_zero = bpm->NewPage(temp_page_id);
+  ASSERT_NE(nullptr, page_zero);
+  strcpy(page_zero->GetData(), "Hello");
+
+  for (int i = 1; i < 10; ++i) {
+    EXPECT_NE(nullptr, bpm->NewPage(temp_page_id));
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(temp_page_id));
+
+  // unpin the first five pages and evict them all
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(true, bpm->UnpinPage(i, true));
+  }
+  page_id_t first_new = INVALID_PAGE_ID;
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_NE(nullptr, bpm->NewPage(temp_page_id));
+    if (first_new == INVALID_PAGE_ID) {
+      first_new = temp_page_id;
+    }
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(temp_page_id));
+
+  // make room again and read page zero back from disk
+  EXPECT_EQ(true, bpm->UnpinPage(first_new, false));
+  page_zero = bpm->FetchPage(0);
+  ASSERT_NE(nullptr, page_zero);
+  EXPECT_EQ(0, strcmp(page_zero->GetData(), "Hello"));
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, ScanRingTest) {
+  const int num_cold = 64;
+  const int num_hot = 8;
+  page_id_t temp_page_id;
+  char data[PAGE_SIZE];
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(16, disk_manager);
+
+  // a large cold table, then the hot pages of everybody else
+  for (int i = 0; i < num_cold + num_hot; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+
+  // scan the cold table through a ring
+  ScanRing ring;
+  for (int i = 0; i < num_cold; ++i) {
+    auto page = bpm->FetchPage(i, &ring);
+    ASSERT_NE(nullptr, page);
+    snprintf(data, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), data));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+  EXPECT_GT(ring.Size(), 0);
+  EXPECT_LE(ring.Size(), ring.GetCapacity());
+
+  // read-ahead of the scan goes through the ring as well
+  bpm->PrefetchPage(0, 8, nullptr, &ring);
+  ASSERT_TRUE(WaitForPrefetches(bpm, 1));
+
+  // hot pages must still be in the pool: a reload would see the garbage
+  memset(data, 0, PAGE_SIZE);
+  strcpy(data, "garbage");
+  for (int i = num_cold; i < num_cold + num_hot; ++i) {
+    disk_manager->WritePage(i, data);
+  }
+  for (int i = num_cold; i < num_cold + num_hot; ++i) {
+    auto page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(data, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), data));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, PageCleanerTest) {
+  const int num_pages = 16;
+  page_id_t temp_page_id;
+  char data[PAGE_SIZE];
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(num_pages, disk_manager);
+
+  // a quarter of the pool is allowed to stay dirty
+  bpm->RunPageCleaner(0.25, 0.5, 10000);
+  for (int i = 0; i < num_pages; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+  }
+  // pinned pages are never cleaned
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(0, bpm->GetNumDirty());
+  for (int i = 0; i < num_pages; ++i) {
+    EXPECT_EQ(true, bpm->UnpinPage(i, true));
+  }
+  EXPECT_EQ(num_pages, bpm->GetNumDirty());
+
+  for (int i = 0; i < 100 && bpm->GetNumDirty() > num_pages / 4; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  bpm->StopPageCleaner();
+  EXPECT_LE(bpm->GetNumDirty(), num_pages / 4);
+  EXPECT_GT(bpm->GetNumDirty(), 0);
+
+  // cleaned pages are on disk, and they are the coldest ones
+  int num_clean = num_pages - bpm->GetNumDirty();
+  for (int i = 0; i < num_clean; ++i) {
+    disk_manager->ReadPage(i, data);
+    char expected[PAGE_SIZE];
+    snprintf(expected, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(data, expected));
+  }
+
+  // eviction of clean pages does not touch the dirty counter
+  for (int i = 0; i < num_clean; ++i) {
+    EXPECT_NE(nullptr, bpm->NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, false));
+  }
+  EXPECT_EQ(num_pages - num_clean, bpm->GetNumDirty());
+  EXPECT_EQ(true, bpm->FlushPage(num_pages - 1));
+  EXPECT_EQ(num_pages - num_clean - 1, bpm->GetNumDirty());
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, PrefetchTest) {
+  const int num_pages = 40;
+  const int depth = 8;
+  page_id_t temp_page_id;
+  char data[PAGE_SIZE];
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(32, disk_manager);
+
+  // a chain of pages, the link is at the end of each page
+  auto next = [](Page *page) {
+    return *reinterpret_cast<page_id_t *>(page->GetData() + PAGE_DATA_SIZE -
+                                          sizeof(page_id_t));
+  };
+  for (int i = 0; i < num_pages; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    *reinterpret_cast<page_id_t *>(page->GetData() + PAGE_DATA_SIZE -
+                                   sizeof(page_id_t)) =
+        i + 1 < num_pages ? i + 1 : INVALID_PAGE_ID;
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+
+  // the head of the chain has been evicted, read it ahead
+  bpm->PrefetchPage(0, depth, next);
+  ASSERT_TRUE(WaitForPrefetches(bpm, 1));
+
+  // prefetched pages must be in the pool: a reload would see the garbage
+  memset(data, 0, PAGE_SIZE);
+  strcpy(data, "garbage");
+  for (int i = 0; i < depth; ++i) {
+    disk_manager->WritePage(i, data);
+  }
+  for (int i = 0; i < depth; ++i) {
+    auto page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(data, PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), data));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+// page ids not allocated are not read ahead, no frame is taken for them
+TEST(BufferPoolManagerTest, PrefetchUnallocatedTest) {
+  page_id_t temp_page_id;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(2, disk_manager);
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(temp_page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, false));
+  }
+
+  bpm->PrefetchPage(2, 1);
+  ASSERT_TRUE(WaitForPrefetches(bpm, 1));
+  EXPECT_EQ(0u, bpm->GetStats().evictions);
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_NE(nullptr, bpm->FetchPage(i));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+  EXPECT_EQ(2u, bpm->GetStats().hits);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, ShardedTest) {
+  const int num_threads = 4;
+  const int num_pages = 64;
+  page_id_t temp_page_id;
+
+  for (auto replacer_type : {ReplacerType::LRU, ReplacerType::CLOCK,
+                             ReplacerType::LRUK, ReplacerType::ARC}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm =
+        new BufferPoolManager(16, disk_manager, nullptr, 4, replacer_type);
+    EXPECT_EQ(4, bpm->GetNumShards());
+
+    // every page gets its own id as content
+    for (int i = 0; i < num_pages; ++i) {
+      auto page = bpm->NewPage(temp_page_id);
+      ASSERT_NE(nullptr, page);
+      EXPECT_EQ(i, temp_page_id);
+      snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+      EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+    }
+
+    // concurrent fetch/unpin, pages are evicted and read back all the time
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; ++tid) {
+      threads.push_back(std::thread([bpm, tid]() {
+        char expected[PAGE_SIZE];
+        for (int round = 0; round < 20; ++round) {
+          for (int i = tid; i < num_pages; i += num_threads) {
+            auto page = bpm->FetchPage(i);
+            ASSERT_NE(nullptr, page);
+            snprintf(expected, PAGE_SIZE, "page %d", i);
+            EXPECT_EQ(0, strcmp(page->GetData(), expected));
+            EXPECT_EQ(true, bpm->UnpinPage(i, false));
+          }
+        }
+      }));
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    delete bpm;
+    delete disk_manager;
+    remove("test.db");
+  }
+}
+
+TEST(BufferPoolManagerTest, ConcurrentIOTest) {
+  const int num_threads = 4;
+  const int num_pages = 32;
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(8, disk_manager, nullptr, 2);
+
+  for (int i = 0; i < num_pages; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+
+  // all threads hit the same pages, so loads and write-backs of a frame are
+  // seen by other requesters, while one thread keeps flushing
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([bpm]() {
+      char expected[PAGE_SIZE];
+      for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < num_pages; ++i) {
+          auto page = bpm->FetchPage(i);
+          if (page == nullptr) {
+            // every frame of the shard is pinned by other threads
+            continue;
+          }
+          snprintf(expected, PAGE_SIZE, "page %d", i);
+          EXPECT_EQ(0, strcmp(page->GetData(), expected));
+          EXPECT_EQ(true, bpm->UnpinPage(i, true));
+        }
+      }
+    }));
+  }
+  threads.push_back(std::thread([bpm]() {
+    for (int round = 0; round < 20; ++round) {
+      for (int i = 0; i < num_pages; ++i) {
+        bpm->FlushPage(i);
+      }
+    }
+  }));
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, ResizeTest) {
+  page_id_t temp_page_id;
+  char data[PAGE_SIZE];
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(8, disk_manager, nullptr, 2);
+
+  // fill the pool with pinned pages
+  std::vector<page_id_t> page_ids;
+  for (int i = 0; i < 8; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", temp_page_id);
+    page_ids.push_back(temp_page_id);
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(temp_page_id));
+
+  // grow online, the new frames are usable right away
+  EXPECT_EQ(false, bpm->Resize(1));
+  EXPECT_EQ(true, bpm->Resize(16));
+  EXPECT_EQ(16, bpm->GetPoolSize());
+  for (int i = 0; i < 8; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", temp_page_id);
+    page_ids.push_back(temp_page_id);
+  }
+
+  // unpin half of the pages, then shrink: those go at once, dirty or not,
+  // the pinned ones follow when they are unpinned
+  for (size_t i = 0; i < page_ids.size(); i += 2) {
+    EXPECT_EQ(true, bpm->UnpinPage(page_ids[i], true));
+  }
+  EXPECT_EQ(true, bpm->Resize(4));
+  EXPECT_EQ(4, bpm->GetPoolSize());
+  for (size_t i = 1; i < page_ids.size(); i += 2) {
+    EXPECT_EQ(true, bpm->UnpinPage(page_ids[i], true));
+  }
+
+  // exactly 4 frames are left
+  std::vector<page_id_t> pinned;
+  for (int i = 0; i < 4; ++i) {
+    auto page = bpm->FetchPage(page_ids[i]);
+    ASSERT_NE(nullptr, page);
+    pinned.push_back(page_ids[i]);
+  }
+  int misses = 0;
+  for (size_t i = 4; i < page_ids.size(); ++i) {
+    if (bpm->FetchPage(page_ids[i]) == nullptr) {
+      ++misses;
+    } else {
+      pinned.push_back(page_ids[i]);
+    }
+  }
+  EXPECT_EQ(4, pinned.size());
+  EXPECT_EQ(page_ids.size() - 4, misses);
+  for (auto page_id : pinned) {
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+
+  // nothing was lost on the way
+  for (auto page_id : page_ids) {
+    auto page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(data, PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(0, strcmp(page->GetData(), data));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, DirectIOTest) {
+  page_id_t temp_page_id;
+  char data[PAGE_SIZE];
+
+  remove("test.db");
+  DiskManager *disk_manager =
+      new DiskManager("test.db", IOEngineType::AUTO, false, false, 0, true);
+  BufferPoolManager *bpm = new BufferPoolManager(8, disk_manager, nullptr, 2);
+  EXPECT_EQ(8 * PAGE_SIZE, bpm->GetFrameMemory());
+
+  // frames are aligned, they are read and written as they are
+  std::vector<page_id_t> page_ids;
+  for (int i = 0; i < 32; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(page->GetData()) % PAGE_SIZE);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", temp_page_id);
+    page_ids.push_back(temp_page_id);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  for (auto page_id : page_ids) {
+    auto page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(data, PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(0, strcmp(page->GetData(), data));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(0u, disk_manager->GetNumChecksumFailures());
+
+  // the memory grows with the pool, and is kept when it shrinks
+  EXPECT_EQ(true, bpm->Resize(16));
+  EXPECT_EQ(16 * PAGE_SIZE, bpm->GetFrameMemory());
+  EXPECT_EQ(true, bpm->Resize(4));
+  EXPECT_EQ(true, bpm->Resize(12));
+  EXPECT_EQ(16 * PAGE_SIZE, bpm->GetFrameMemory());
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, StatsTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(4, disk_manager, nullptr, 2);
+
+  // 8 new pages in 4 frames: the last 4 evict the first 4, which are dirty
+  for (int i = 0; i < 8; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  BufferPoolStats stats = bpm->GetStats();
+  EXPECT_EQ(0, stats.hits);
+  EXPECT_EQ(0, stats.misses);
+  EXPECT_EQ(4, stats.evictions);
+  EXPECT_EQ(4, stats.dirty_writebacks);
+  EXPECT_EQ(8, stats.pin_count_histogram[0]);
+
+  bpm->ResetStats();
+  // pages 4-7 are resident, page 7 is pinned 3 times
+  for (int i = 4; i < 8; ++i) {
+    EXPECT_NE(nullptr, bpm->FetchPage(i));
+  }
+  EXPECT_NE(nullptr, bpm->FetchPage(7));
+  EXPECT_NE(nullptr, bpm->FetchPage(7));
+  stats = bpm->GetStats();
+  EXPECT_EQ(6, stats.hits);
+  EXPECT_EQ(0, stats.misses);
+  EXPECT_EQ(4, stats.pin_count_histogram[0]);
+  EXPECT_EQ(1, stats.pin_count_histogram[1]);
+  EXPECT_EQ(1, stats.pin_count_histogram[2]);
+  EXPECT_EQ(stats.hits, bpm->GetStats(0).hits + bpm->GetStats(1).hits);
+
+  // page 0 is a miss, its frame is taken from page 4, which is clean now
+  for (int i = 4; i < 7; ++i) {
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+  EXPECT_EQ(true, bpm->FlushPage(4));
+  EXPECT_NE(nullptr, bpm->FetchPage(0));
+  stats = bpm->GetStats();
+  EXPECT_EQ(1, stats.misses);
+  EXPECT_EQ(1, stats.flushes);
+  EXPECT_EQ(1, stats.evictions);
+  EXPECT_EQ(0, stats.dirty_writebacks);
+  EXPECT_EQ(0, stats.wal_waits);
+
+  bpm->ResetStats();
+  stats = bpm->GetStats();
+  EXPECT_EQ(0, stats.hits + stats.misses + stats.evictions + stats.flushes);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, WALVictimTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(4, disk_manager, log_manager);
+  // no flush thread, the test decides what is durable
+  ENABLE_LOGGING = true;
+  log_manager->SetPersistentLSN(6);
+
+  // in LRU order: dirty lsn 10, dirty lsn 5, clean, dirty lsn 7
+  lsn_t lsns[] = {10, 5, INVALID_LSN, 7};
+  for (int i = 0; i < 4; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    page->SetLSN(lsns[i]);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, lsns[i] != INVALID_LSN));
+  }
+  EXPECT_EQ(true, bpm->FlushPage(2));
+  bpm->ResetStats();
+
+  // the clean page goes first, then the durable one
+  EXPECT_NE(nullptr, bpm->NewPage(temp_page_id));
+  EXPECT_NE(nullptr, bpm->NewPage(temp_page_id));
+  EXPECT_NE(nullptr, bpm->FetchPage(0));
+  EXPECT_NE(nullptr, bpm->FetchPage(3));
+  BufferPoolStats stats = bpm->GetStats();
+  EXPECT_EQ(2, stats.hits);
+  EXPECT_EQ(2, stats.evictions);
+  EXPECT_EQ(1, stats.dirty_writebacks);
+  EXPECT_EQ(0, stats.eviction_wal_waits);
+
+  // once the log caught up, the replacement order is back
+  EXPECT_EQ(true, bpm->UnpinPage(0, false));
+  EXPECT_EQ(true, bpm->UnpinPage(3, false));
+  log_manager->SetPersistentLSN(10);
+  bpm->ResetStats();
+  EXPECT_NE(nullptr, bpm->NewPage(temp_page_id));
+  EXPECT_NE(nullptr, bpm->FetchPage(3));
+  stats = bpm->GetStats();
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(1, stats.dirty_writebacks);
+  EXPECT_EQ(0, stats.eviction_wal_waits);
+
+  ENABLE_LOGGING = false;
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BufferPoolManagerTest, FlushAllPagesTest) {
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager, nullptr, 2);
+
+  for (int i = 0; i < 8; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    // the even pages stay pinned, they are part of the checkpoint too
+    if (i % 2 == 0) {
+      EXPECT_EQ(page, bpm->FetchPage(temp_page_id));
+    }
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  EXPECT_EQ(8, bpm->GetNumDirty());
+  bpm->FlushAllPages();
+  EXPECT_EQ(0, bpm->GetNumDirty());
+  EXPECT_EQ(8, bpm->GetStats().flushes);
+
+  // every page is on disk, without any eviction
+  DiskManager *reader = new DiskManager("test.db");
+  char buffer[PAGE_SIZE];
+  for (int i = 0; i < 8; ++i) {
+    reader->ReadPage(i, buffer);
+    EXPECT_EQ("page " + std::to_string(i), std::string(buffer));
+  }
+
+  delete reader;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BufferPoolManagerTest, SequentialReadTest) {
+  const int num_pages = 64;
+  page_id_t temp_page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(16, disk_manager, nullptr, 4);
+  for (int i = 0; i < num_pages; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  bpm->FlushAllPages();
+  delete bpm;
+
+  // a quarter of the pool is read on each sequential miss
+  bpm = new BufferPoolManager(64, disk_manager, nullptr, 4);
+  for (int i = 0; i < 2 * num_pages / 4; ++i) {
+    auto page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(i), std::string(page->GetData()));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+  // the first miss is not known to be sequential
+  BufferPoolStats stats = bpm->GetStats();
+  EXPECT_EQ(3, stats.misses);
+  EXPECT_EQ(2 * num_pages / 4 - 3, stats.hits);
+
+  // random misses read one page each
+  bpm->ResetStats();
+  for (int i = num_pages - 1; i >= 2 * num_pages / 4 + 16; i -= 2) {
+    auto page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(i), std::string(page->GetData()));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+  EXPECT_EQ(8, bpm->GetStats().misses);
+  EXPECT_EQ(0, bpm->GetStats().hits);
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BufferPoolManagerTest, ReadOnlyTest) {
+  page_id_t temp_page_id;
+  remove("test.db");
+  remove("test.log");
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  for (int i = 0; i < 20; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  bpm->FlushAllPages();
+  delete bpm;
+  delete disk_manager;
+
+  // pages are read through the mapping, in more pages than frames
+  disk_manager = new DiskManager("test.db", IOEngineType::AUTO, true);
+  EXPECT_TRUE(disk_manager->IsReadOnly());
+  bpm = new BufferPoolManager(4, disk_manager, nullptr, 2);
+  for (int round = 0; round < 2; ++round) {
+    for (int i = 0; i < 20; ++i) {
+      auto page = bpm->FetchPage(i);
+      ASSERT_NE(nullptr, page);
+      EXPECT_EQ("page " + std::to_string(i), std::string(page->GetData()));
+      EXPECT_EQ(disk_manager->GetMappedPage(i), page->GetData());
+      EXPECT_EQ(true, bpm->UnpinPage(i, false));
+    }
+  }
+  // a page past the end which was never allocated is not read
+  EXPECT_EQ(nullptr, bpm->FetchPage(100));
+
+  // nothing can be changed
+  EXPECT_EQ(nullptr, bpm->NewPage(temp_page_id));
+  EXPECT_EQ(INVALID_PAGE_ID, temp_page_id);
+  EXPECT_FALSE(bpm->DeletePage(3));
+  char data[PAGE_SIZE] = "garbage";
+  EXPECT_FALSE(disk_manager->WritePage(3, data));
+  EXPECT_FALSE(disk_manager->WritePageAsync(3, data).get());
+  bpm->PrefetchPage(0, 20);
+  auto page = bpm->FetchPage(3);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ("page 3", std::string(page->GetData()));
+  EXPECT_EQ(true, bpm->UnpinPage(3, false));
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// pages whose write fails stay dirty and in the pool
+TEST(BufferPoolManagerTest, WriteFailureTest) {
+  page_id_t temp_page_id;
+  remove("test.db");
+  remove("test.log");
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  for (int i = 0; i < 8; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  bpm->FlushAllPages();
+  delete bpm;
+  delete disk_manager;
+
+  // not mapped, so that the frames can be changed; every write is rejected
+  disk_manager = new DiskManager("test.db", IOEngineType::AUTO, true, false,
+                                 0, true);
+  bpm = new BufferPoolManager(4, disk_manager, nullptr, 1);
+  for (int i = 0; i < 4; ++i) {
+    auto page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "new page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(i, true));
+  }
+  EXPECT_EQ(4, bpm->GetNumDirty());
+
+  // a single page, then a batch
+  EXPECT_FALSE(bpm->FlushPage(0));
+  EXPECT_EQ(4, bpm->GetNumDirty());
+  bpm->FlushAllPages();
+  EXPECT_EQ(4, bpm->GetNumDirty());
+
+  // no dirty frame can be evicted
+  EXPECT_EQ(nullptr, bpm->FetchPage(4));
+  for (int i = 0; i < 4; ++i) {
+    auto page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("new page " + std::to_string(i), std::string(page->GetData()));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+  EXPECT_EQ(4, bpm->GetNumDirty());
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a corrupted page is never handed out, and its frame is not lost
+TEST(BufferPoolManagerTest, CorruptPageTest) {
+  page_id_t temp_page_id;
+  remove("test.db");
+  remove("test.log");
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  for (int i = 0; i < 8; ++i) {
+    auto page = bpm->NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+  }
+  bpm->FlushAllPages();
+  delete bpm;
+  delete disk_manager;
+
+  // flip a byte of page 3, after the file header and the map page
+  FILE *file = fopen("test.db", "r+b");
+  ASSERT_NE(nullptr, file);
+  fseek(file, (3 + 2) * PAGE_SIZE + 100, SEEK_SET);
+  fputc('x', file);
+  fclose(file);
+
+  disk_manager = new DiskManager("test.db");
+  bpm = new BufferPoolManager(4, disk_manager, nullptr, 1);
+  EXPECT_EQ(nullptr, bpm->FetchPage(3));
+  EXPECT_EQ(1u, disk_manager->GetNumChecksumFailures());
+  // the frame is free again, all four can be pinned
+  for (int i : {0, 4, 5, 6}) {
+    auto page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(i), std::string(page->GetData()));
+  }
+  for (int i : {0, 4, 5, 6}) {
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+
+  delete bpm;
+
+  // read ahead by a sequential miss, and by a prefetch
+  bpm = new BufferPoolManager(16, disk_manager, nullptr, 1);
+  EXPECT_NE(nullptr, bpm->FetchPage(1));
+  EXPECT_EQ(true, bpm->UnpinPage(1, false));
+  EXPECT_NE(nullptr, bpm->FetchPage(2));
+  EXPECT_EQ(true, bpm->UnpinPage(2, false));
+  EXPECT_EQ(2u, disk_manager->GetNumChecksumFailures());
+  bpm->PrefetchPage(3);
+  ASSERT_TRUE(WaitForPrefetches(bpm, 1));
+  EXPECT_EQ(3u, disk_manager->GetNumChecksumFailures());
+  EXPECT_EQ(nullptr, bpm->FetchPage(3));
+  EXPECT_EQ(4u, disk_manager->GetNumChecksumFailures());
+  delete bpm;
+  delete disk_manager;
+
+  // and through the mapping
+  disk_manager = new DiskManager("test.db", IOEngineType::AUTO, true);
+  ASSERT_TRUE(disk_manager->IsMapped());
+  bpm = new BufferPoolManager(4, disk_manager, nullptr, 1);
+  EXPECT_EQ(nullptr, bpm->FetchPage(3));
+  for (int i : {0, 4, 5, 6}) {
+    ASSERT_NE(nullptr, bpm->FetchPage(i));
+  }
+  for (int i : {0, 4, 5, 6}) {
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// repeated full scans of a file four times larger than the pool, in pages
+// per second
+double ScanBenchmark(bool read_only, int num_pages, int num_scans,
+                     ChecksumMode mode = ChecksumMode::ALWAYS) {
+  DiskManager disk_manager("test.db", IOEngineType::AUTO, read_only);
+  disk_manager.SetChecksumMode(mode);
+  BufferPoolManager bpm(num_pages / 4, &disk_manager);
+  uint64_t sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int scan = 0; scan < num_scans; ++scan) {
+    for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+      auto page = bpm.FetchPage(page_id);
+      EXPECT_NE(nullptr, page);
+      // look at every tuple slot of the page
+      for (int i = 0; i < PAGE_SIZE; i += 64) {
+        sum += page->GetData()[i];
+      }
+      bpm.UnpinPage(page_id, false);
+    }
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  EXPECT_EQ(static_cast<uint64_t>(num_scans) * num_pages * 'x' *
+                (PAGE_SIZE / 64),
+            sum);
+  return num_scans * num_pages / elapsed.count();
+}
+
+TEST(BufferPoolManagerTest, ReadOnlyBenchmarkTest) {
+  const int num_pages = 4096;
+  const int num_scans = 10;
+  remove("test.db");
+  remove("test.log");
+  {
+    DiskManager disk_manager("test.db");
+    char data[PAGE_SIZE];
+    memset(data, 'x', PAGE_SIZE);
+    for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+      disk_manager.WritePage(disk_manager.AllocatePage(), data);
+    }
+  }
+
+  // the file is in the page cache after the first scan of either
+  double copied = ScanBenchmark(false, num_pages, num_scans);
+  double mapped = ScanBenchmark(true, num_pages, num_scans);
+  printf("scan: %8.0f pages/s read into frames, %8.0f pages/s mapped\n",
+         copied, mapped);
+
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BufferPoolManagerTest, ChecksumBenchmarkTest) {
+  const int num_pages = 4096;
+  const int num_scans = 10;
+  remove("test.db");
+  remove("test.log");
+  {
+    DiskManager disk_manager("test.db");
+    char data[PAGE_SIZE];
+    memset(data, 'x', PAGE_SIZE);
+    for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+      disk_manager.WritePage(disk_manager.AllocatePage(), data);
+    }
+  }
+
+  // every fetch misses, a quarter of the pages fit in the pool
+  ScanBenchmark(false, num_pages, 1, ChecksumMode::OFF);
+  double off = ScanBenchmark(false, num_pages, num_scans, ChecksumMode::OFF);
+  double sampled =
+      ScanBenchmark(false, num_pages, num_scans, ChecksumMode::SAMPLED);
+  double always =
+      ScanBenchmark(false, num_pages, num_scans, ChecksumMode::ALWAYS);
+  printf("checksums: %8.0f pages/s off, %8.0f pages/s sampled, %8.0f pages/s "
+         "always, %.1f%% overhead\n",
+         off, sampled, always, (off / always - 1) * 100);
+
+  remove("test.db");
+  remove("test.log");
+}
+
 } // namespace cmudb
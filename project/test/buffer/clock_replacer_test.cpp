@@ -0,0 +1,190 @@
+/**
+ * clock_replacer_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "buffer/replacer_test_util.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ClockReplacerTest, SampleTest) {
+  ClockReplacer<int> clock_replacer;
+
+  // push element into replacer
+  clock_replacer.Insert(1);
+  clock_replacer.Insert(2);
+  clock_replacer.Insert(3);
+  clock_replacer.Insert(4);
+  clock_replacer.Insert(5);
+  clock_replacer.Insert(6);
+  clock_replacer.Insert(1);
+  EXPECT_EQ(6, clock_replacer.Size());
+
+  // every reference bit is set, the first sweep clears them all and the
+  // victims come out in slot order
+  int value;
+  clock_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+
+  // pop element from replacer
+  EXPECT_EQ(false, clock_replacer.Erase(3));
+  EXPECT_EQ(true, clock_replacer.Erase(4));
+  EXPECT_EQ(2, clock_replacer.Size());
+
+  // 5 gets a second chance after being used again
+  clock_replacer.Insert(5);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(6, value);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(5, value);
+  EXPECT_EQ(false, clock_replacer.Victim(value));
+  EXPECT_EQ(0, clock_replacer.Size());
+}
+
+TEST(ClockReplacerTest, SecondChanceTest) {
+  ClockReplacer<int> clock_replacer;
+  int value;
+
+  for (int i = 0; i < 4; ++i) {
+    clock_replacer.Insert(i);
+  }
+  // clears all reference bits and evicts 0, hand stops at 1
+  clock_replacer.Victim(value);
+  EXPECT_EQ(0, value);
+
+  // 1 is referenced again, so 2 is the next victim
+  clock_replacer.Insert(1);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+}
+
+TEST(ClockReplacerTest, PeekTest) {
+  ClockReplacer<int> clock_replacer;
+  int value;
+  for (int i = 0; i < 10; ++i) {
+    clock_replacer.Insert(i);
+  }
+  // clear all reference bits, then set some of them again
+  clock_replacer.Victim(value);
+  clock_replacer.Insert(3);
+  clock_replacer.Insert(7);
+  clock_replacer.Erase(5);
+  ExpectPeekMatchesVictims(clock_replacer);
+}
+
+// an erased value gives its slot back, the next new value takes its place in
+// the sweep order instead of going to the end
+TEST(ClockReplacerTest, SlotReuseTest) {
+  ClockReplacer<int> clock_replacer;
+  int value;
+  for (int i = 0; i < 3; ++i) {
+    clock_replacer.Insert(i);
+  }
+  EXPECT_EQ(true, clock_replacer.Erase(1));
+  EXPECT_EQ(false, clock_replacer.Erase(1));
+  clock_replacer.Insert(3);
+
+  std::vector<int> victims;
+  while (clock_replacer.Victim(value)) {
+    victims.push_back(value);
+  }
+  EXPECT_EQ(std::vector<int>({0, 3, 2}), victims);
+
+  // victims gave their slots back too, the last freed is taken first
+  for (int i = 4; i < 7; ++i) {
+    clock_replacer.Insert(i);
+  }
+  victims.clear();
+  while (clock_replacer.Victim(value)) {
+    victims.push_back(value);
+  }
+  EXPECT_EQ(std::vector<int>({6, 5, 4}), victims);
+}
+
+TEST(ClockReplacerTest, ConcurrentTest) {
+  const int num_threads = 4;
+  const int num_values = 256;
+  ClockReplacer<int> clock_replacer;
+
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([&clock_replacer, tid]() {
+      for (int round = 0; round < 100; ++round) {
+        for (int i = tid; i < num_values; i += num_threads) {
+          clock_replacer.Insert(i);
+          clock_replacer.Erase(i);
+          clock_replacer.Insert(i);
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_values, clock_replacer.Size());
+
+  int value;
+  std::vector<bool> seen(num_values, false);
+  for (int i = 0; i < num_values; ++i) {
+    EXPECT_EQ(true, clock_replacer.Victim(value));
+    EXPECT_EQ(false, seen[value]);
+    seen[value] = true;
+  }
+  EXPECT_EQ(false, clock_replacer.Victim(value));
+}
+
+// pin/unpin churn as done by the buffer pool, on both policies
+template <typename R> double PinUnpinBenchmark(int num_threads) {
+  const int num_values = 1024;
+  const int rounds = 200;
+  R replacer;
+  for (int i = 0; i < num_values; ++i) {
+    replacer.Insert(i);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([&replacer, tid, num_threads]() {
+      for (int round = 0; round < rounds; ++round) {
+        for (int i = tid; i < num_values; i += num_threads) {
+          replacer.Erase(i);
+          replacer.Insert(i);
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  EXPECT_EQ(num_values, replacer.Size());
+  return elapsed.count();
+}
+
+TEST(ClockReplacerTest, BenchmarkTest) {
+  for (int num_threads : {1, 4}) {
+    double lru = PinUnpinBenchmark<LRUReplacer<int>>(num_threads);
+    double clock = PinUnpinBenchmark<ClockReplacer<int>>(num_threads);
+    printf("pin/unpin %d thread(s): lru %.2f ms, clock %.2f ms\n", num_threads,
+           lru, clock);
+  }
+}
+
+} // namespace cmudb
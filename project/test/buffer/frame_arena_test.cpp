@@ -0,0 +1,61 @@
+/**
+ * frame_arena_test.cpp
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <set>
+
+#include "buffer/frame_arena.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(FrameArenaTest, SampleTest) {
+  FrameArena arena;
+  EXPECT_EQ(nullptr, arena.Allocate());
+  EXPECT_TRUE(arena.Reserve(10));
+  EXPECT_EQ(10 * PAGE_SIZE, arena.GetReservedBytes());
+
+  std::set<char *> frames;
+  for (int i = 0; i < 10; ++i) {
+    char *frame = arena.Allocate();
+    ASSERT_NE(nullptr, frame);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(frame) % PAGE_SIZE);
+    memset(frame, i, PAGE_SIZE);
+    frames.insert(frame);
+  }
+  EXPECT_EQ(10, frames.size());
+  EXPECT_EQ(nullptr, arena.Allocate());
+
+  // a freed frame is reused before anything is mapped
+  char *frame = *frames.begin();
+  arena.Free(frame);
+  EXPECT_TRUE(arena.Reserve(1));
+  EXPECT_EQ(10 * PAGE_SIZE, arena.GetReservedBytes());
+  EXPECT_EQ(frame, arena.Allocate());
+
+  // only the frames missing are mapped
+  arena.Free(frame);
+  EXPECT_TRUE(arena.Reserve(3));
+  EXPECT_EQ(12 * PAGE_SIZE, arena.GetReservedBytes());
+  EXPECT_EQ(3, arena.GetNumFreeFrames());
+}
+
+TEST(FrameArenaTest, HugePageTest) {
+  // with or without reserved huge pages, chunks are whole huge pages
+  FrameArena arena(true);
+  EXPECT_TRUE(arena.Reserve(3));
+  EXPECT_EQ(HUGE_PAGE_SIZE, arena.GetReservedBytes());
+  EXPECT_EQ(HUGE_PAGE_SIZE / PAGE_SIZE, arena.GetNumFreeFrames());
+  char *first = arena.Allocate();
+  for (size_t i = 1; i < HUGE_PAGE_SIZE / PAGE_SIZE; ++i) {
+    char *frame = arena.Allocate();
+    ASSERT_NE(nullptr, frame);
+    memset(frame, 1, PAGE_SIZE);
+  }
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(first) % PAGE_SIZE);
+  EXPECT_EQ(nullptr, arena.Allocate());
+}
+
+} // namespace cmudb
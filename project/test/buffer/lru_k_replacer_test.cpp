@@ -0,0 +1,145 @@
+/**
+ * lru_k_replacer_test.cpp
+ */
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "buffer/replacer_test_util.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer<int> lru_k_replacer(2, 0);
+
+  // 1 and 2 are accessed twice, the others once
+  for (int i = 1; i <= 4; ++i) {
+    lru_k_replacer.RecordAccess(i, i);
+  }
+  lru_k_replacer.RecordAccess(2, 2);
+  lru_k_replacer.RecordAccess(1, 1);
+  for (int i = 1; i <= 4; ++i) {
+    lru_k_replacer.Insert(i);
+  }
+  EXPECT_EQ(4, lru_k_replacer.Size());
+
+  // infinite distance first, oldest first access first
+  int value;
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(4, value);
+  // the 2nd most recent access of 1 is older than the one of 2
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+
+  // pinned values can not be evicted
+  EXPECT_EQ(true, lru_k_replacer.Erase(2));
+  EXPECT_EQ(false, lru_k_replacer.Erase(2));
+  EXPECT_EQ(false, lru_k_replacer.Victim(value));
+  EXPECT_EQ(0, lru_k_replacer.Size());
+
+  // history survives a pin, but is lost on eviction
+  lru_k_replacer.Insert(2);
+  lru_k_replacer.Insert(5);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(5, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+}
+
+TEST(LRUKReplacerTest, CorrelatedTest) {
+  LRUKReplacer<int> lru_k_replacer(2, 1);
+  int value;
+
+  // back to back accesses of 1 count once
+  lru_k_replacer.RecordAccess(1, 1);
+  lru_k_replacer.RecordAccess(1, 1);
+  lru_k_replacer.RecordAccess(1, 1);
+  lru_k_replacer.RecordAccess(2, 2);
+  lru_k_replacer.RecordAccess(3, 3);
+  lru_k_replacer.RecordAccess(2, 2);
+  lru_k_replacer.Insert(1);
+  lru_k_replacer.Insert(2);
+  lru_k_replacer.Insert(3);
+
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+}
+
+TEST(LRUKReplacerTest, NewPageTest) {
+  LRUKReplacer<int> lru_k_replacer(2, 0);
+  int value;
+
+  // frame 0 is hot, frame 1 is not
+  lru_k_replacer.RecordAccess(0, 10);
+  lru_k_replacer.RecordAccess(1, 11);
+  lru_k_replacer.RecordAccess(0, 10);
+  // frame 0 now holds another page, its history must not be inherited
+  lru_k_replacer.RecordAccess(0, 12);
+  lru_k_replacer.Insert(0);
+  lru_k_replacer.Insert(1);
+
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+}
+
+TEST(LRUKReplacerTest, PeekTest) {
+  LRUKReplacer<int> lru_k_replacer(2, 0);
+  for (int i = 0; i < 10; ++i) {
+    lru_k_replacer.RecordAccess(i, i);
+  }
+  for (int i = 9; i >= 0; i -= 2) {
+    lru_k_replacer.RecordAccess(i, i);
+  }
+  for (int i = 0; i < 10; ++i) {
+    lru_k_replacer.Insert(i);
+  }
+  lru_k_replacer.Erase(4);
+  ExpectPeekMatchesVictims(lru_k_replacer);
+}
+
+TEST(LRUKReplacerTest, BenchmarkTest) {
+  const int num_frames = 32;
+  const int num_hot = 24;
+  const int num_cold = 200;
+  const int tuples_per_page = 4;
+
+  // point lookups on a hot set (think B+tree inner pages) interleaved with
+  // full scans over a cold table, each scanned page is pinned once per tuple
+  std::mt19937 gen(15445);
+  std::uniform_int_distribution<int> hot(0, num_hot - 1);
+  std::vector<std::pair<int, bool>> workload;
+  for (int cycle = 0; cycle < 50; ++cycle) {
+    for (int i = 0; i < 200; ++i) {
+      workload.emplace_back(hot(gen), true);
+    }
+    for (int page_id = 0; page_id < num_cold; ++page_id) {
+      for (int i = 0; i < tuples_per_page; ++i) {
+        workload.emplace_back(num_hot + page_id, false);
+      }
+    }
+  }
+
+  LRUReplacer<int> lru;
+  ClockReplacer<int> clock;
+  LRUKReplacer<int> lru_k;
+  double lru_ratio = HitRatio(lru, num_frames, workload);
+  double clock_ratio = HitRatio(clock, num_frames, workload);
+  double lru_k_ratio = HitRatio(lru_k, num_frames, workload);
+  printf("point lookup hit ratio: lru %.3f, clock %.3f, lru-2 %.3f\n",
+         lru_ratio, clock_ratio, lru_k_ratio);
+  EXPECT_GT(lru_k_ratio, lru_ratio);
+  EXPECT_GT(lru_k_ratio, 0.95);
+}
+
+} // namespace cmudb
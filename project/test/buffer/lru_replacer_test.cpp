@@ -5,6 +5,7 @@
 #include <cstdio>
 
 #include "buffer/lru_replacer.h"
+#include "buffer/replacer_test_util.h"
 #include "gtest/gtest.h"
 
 namespace cmudb {
@@ -71,4 +72,14 @@ TEST(LRUReplacerTest, BasicTest) {
   }
 }
 
+TEST(LRUReplacerTest, PeekTest) {
+  LRUReplacer<int> lru_replacer;
+  for (int i = 0; i < 10; ++i) {
+    lru_replacer.Insert(i);
+  }
+  lru_replacer.Insert(3);
+  lru_replacer.Erase(5);
+  ExpectPeekMatchesVictims(lru_replacer);
+}
+
 } // namespace cmudb
@@ -0,0 +1,81 @@
+/**
+ * page_guard_test.cpp
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(PageGuardTest, SampleTest) {
+  page_id_t page_id;
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(2, disk_manager);
+
+  {
+    WritePageGuard guard = bpm->NewPageWrite(page_id);
+    ASSERT_EQ(true, guard.IsValid());
+    EXPECT_EQ(page_id, guard.GetPageId());
+    EXPECT_EQ(1, guard.GetPage()->GetPinCount());
+    strcpy(guard.GetData(), "Hello");
+  }
+  // unpinned as dirty
+  EXPECT_EQ(1, bpm->GetNumDirty());
+
+  {
+    ReadPageGuard first = bpm->FetchPageRead(page_id);
+    ReadPageGuard second = bpm->FetchPageRead(page_id);
+    EXPECT_EQ(2, first.GetPage()->GetPinCount());
+    EXPECT_EQ(0, strcmp(first.GetData(), "Hello"));
+
+    // moving hands the pin over without touching the pool
+    ReadPageGuard moved(std::move(first));
+    EXPECT_EQ(false, first.IsValid());
+    EXPECT_EQ(2, moved.GetPage()->GetPinCount());
+    second.Release();
+    EXPECT_EQ(false, second.IsValid());
+    EXPECT_EQ(1, moved.GetPage()->GetPinCount());
+    // releasing twice is harmless
+    second.Release();
+    EXPECT_EQ(1, moved.GetPage()->GetPinCount());
+  }
+  EXPECT_EQ(true, bpm->FlushPage(page_id));
+  EXPECT_EQ(0, bpm->GetNumDirty());
+
+  {
+    // a write guard is clean unless told otherwise
+    WritePageGuard guard = bpm->FetchPageWrite(page_id);
+    ASSERT_EQ(true, guard.IsValid());
+  }
+  EXPECT_EQ(0, bpm->GetNumDirty());
+
+  {
+    // move assignment releases the page held so far
+    page_id_t other_page_id;
+    WritePageGuard guard = bpm->NewPageWrite(other_page_id);
+    Page *other = guard.GetPage();
+    guard = bpm->FetchPageWrite(page_id);
+    EXPECT_EQ(0, other->GetPinCount());
+    EXPECT_EQ(page_id, guard.GetPageId());
+    guard.MarkDirty();
+
+    // other is written back to make room, then all frames are pinned
+    page_id_t temp_page_id;
+    WritePageGuard third = bpm->NewPageWrite(temp_page_id);
+    EXPECT_EQ(true, third.IsValid());
+    EXPECT_EQ(false, bpm->NewPageWrite(temp_page_id).IsValid());
+    EXPECT_EQ(false, bpm->FetchPageRead(other_page_id).IsValid());
+  }
+  EXPECT_EQ(2, bpm->GetNumDirty());
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+} // namespace cmudb
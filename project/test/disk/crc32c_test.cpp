@@ -0,0 +1,68 @@
+/**
+ * crc32c_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "common/config.h"
+#include "disk/crc32c.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(CRC32CTest, ValueTest) {
+  // the check value of CRC-32C
+  EXPECT_EQ(0xe3069283u, CRC32C::Compute("123456789", 9));
+  EXPECT_EQ(0xe3069283u, CRC32C::ComputeWithTable("123456789", 9));
+  EXPECT_EQ(0u, CRC32C::Compute("", 0));
+
+  // both ways agree, whatever the size and alignment
+  std::vector<char> data(PAGE_SIZE + 8);
+  unsigned int seed = 15445;
+  for (auto &c : data) {
+    c = static_cast<char>(rand_r(&seed));
+  }
+  for (size_t offset = 0; offset < 8; ++offset) {
+    for (size_t size : {1, 7, 8, 9, 100, PAGE_SIZE}) {
+      EXPECT_EQ(CRC32C::ComputeWithTable(&data[offset], size),
+                CRC32C::Compute(&data[offset], size));
+    }
+  }
+  // a single bit flip is caught
+  uint32_t crc = CRC32C::Compute(data.data(), PAGE_SIZE);
+  data[PAGE_SIZE / 2] ^= 1;
+  EXPECT_NE(crc, CRC32C::Compute(data.data(), PAGE_SIZE));
+}
+
+TEST(CRC32CTest, BenchmarkTest) {
+  const int num_pages = 10000;
+  std::vector<char> data(PAGE_SIZE, 'x');
+  uint32_t sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_pages; ++i) {
+    data[i % PAGE_SIZE] = static_cast<char>(i);
+    sum += CRC32C::Compute(data.data(), PAGE_SIZE);
+  }
+  std::chrono::duration<double, std::nano> hardware =
+      std::chrono::steady_clock::now() - start;
+  // the same pages again
+  data.assign(PAGE_SIZE, 'x');
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_pages; ++i) {
+    data[i % PAGE_SIZE] = static_cast<char>(i);
+    sum -= CRC32C::ComputeWithTable(data.data(), PAGE_SIZE);
+  }
+  std::chrono::duration<double, std::nano> table =
+      std::chrono::steady_clock::now() - start;
+  printf("crc32c: %.0f ns/page %s, %.0f ns/page with the table\n",
+         hardware.count() / num_pages,
+         CRC32C::HasHardware() ? "with crc32" : "without crc32",
+         table.count() / num_pages);
+  EXPECT_EQ(0u, sum);
+}
+
+} // namespace cmudb
@@ -0,0 +1,972 @@
+/**
+ * disk_manager_test.cpp
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#include "common/exception.h"
+#include "disk/disk_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(DiskManagerTest, ReadWriteTest) {
+  char data[PAGE_SIZE], buffer[PAGE_SIZE];
+  remove("test.db");
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+
+  // a page which was never written reads as zeros
+  memset(buffer, 'x', PAGE_SIZE);
+  disk_manager->ReadPage(3, buffer);
+  for (int i = 0; i < PAGE_SIZE; ++i) {
+    EXPECT_EQ(0, buffer[i]);
+  }
+
+  strcpy(data, "A test string.");
+  disk_manager->WritePage(0, data);
+  disk_manager->WritePage(5, data);
+  disk_manager->ReadPage(0, buffer);
+  EXPECT_EQ(0, memcmp(buffer, data, PAGE_DATA_SIZE));
+  // the hole before page 5 reads as zeros too
+  disk_manager->ReadPage(3, buffer);
+  EXPECT_EQ(0, buffer[0]);
+  disk_manager->SyncPages();
+  delete disk_manager;
+
+  // and everything is there after reopening
+  disk_manager = new DiskManager("test.db");
+  disk_manager->ReadPage(5, buffer);
+  EXPECT_EQ(0, memcmp(buffer, data, PAGE_DATA_SIZE));
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, LogTest) {
+  // the log is written from two buffers in turn
+  char log_buffer[2][LOG_BUFFER_SIZE];
+  char buffer[LOG_BUFFER_SIZE];
+  remove("test.db");
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+
+  EXPECT_FALSE(disk_manager->ReadLog(buffer, LOG_BUFFER_SIZE, 0));
+  memset(log_buffer[0], 'a', 100);
+  memset(log_buffer[1], 'b', 100);
+  disk_manager->WriteLog(log_buffer[0], 100);
+  disk_manager->WriteLog(log_buffer[1], 100);
+  EXPECT_EQ(2, disk_manager->GetNumFlushes());
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  EXPECT_TRUE(disk_manager->ReadLog(buffer, LOG_BUFFER_SIZE, 0));
+  EXPECT_EQ('a', buffer[99]);
+  EXPECT_EQ('b', buffer[100]);
+  EXPECT_EQ(0, buffer[200]);
+  EXPECT_TRUE(disk_manager->ReadLog(buffer, 50, 150));
+  EXPECT_EQ('b', buffer[49]);
+  EXPECT_FALSE(disk_manager->ReadLog(buffer, LOG_BUFFER_SIZE, 200));
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, LogSegmentTest) {
+  char log_buffer[2][LOG_BUFFER_SIZE];
+  char buffer[LOG_BUFFER_SIZE];
+  remove("test.db");
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  disk_manager->SetLogSegmentSize(100);
+
+  // a file is full once it holds 100 bytes, records are not split
+  for (int i = 0; i < 5; ++i) {
+    memset(log_buffer[i % 2], 'a' + i, 64);
+    disk_manager->WriteLog(log_buffer[i % 2], 64);
+  }
+  struct stat st;
+  EXPECT_EQ(0, stat("test.log", &st));
+  EXPECT_EQ(128, st.st_size);
+  EXPECT_EQ(0, stat("test.log.128", &st));
+  EXPECT_EQ(128, st.st_size);
+  EXPECT_EQ(0, stat("test.log.256", &st));
+  EXPECT_EQ(64, st.st_size);
+  delete disk_manager;
+
+  // the offsets go on from one file into the next
+  disk_manager = new DiskManager("test.db");
+  EXPECT_TRUE(disk_manager->ReadLog(buffer, LOG_BUFFER_SIZE, 0));
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ('a' + i, buffer[i * 64]);
+    EXPECT_EQ('a' + i, buffer[i * 64 + 63]);
+  }
+  EXPECT_EQ(0, buffer[320]);
+  EXPECT_TRUE(disk_manager->ReadLog(buffer, 100, 100));
+  EXPECT_EQ('b', buffer[27]);
+  EXPECT_EQ('c', buffer[28]);
+  EXPECT_FALSE(disk_manager->ReadLog(buffer, LOG_BUFFER_SIZE, 320));
+
+  // the files before offset 200 are archived
+  EXPECT_EQ(0, disk_manager->GetLogStart());
+  EXPECT_EQ(1, disk_manager->DiscardLog(200));
+  EXPECT_NE(0, stat("test.log", &st));
+  EXPECT_EQ(128, disk_manager->GetLogStart());
+  EXPECT_TRUE(disk_manager->ReadLog(buffer, 64, 192));
+  EXPECT_EQ('d', buffer[0]);
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(128, disk_manager->GetLogStart());
+  EXPECT_TRUE(disk_manager->ReadLog(buffer, 64, 256));
+  EXPECT_EQ('e', buffer[0]);
+  // the last file is never discarded
+  EXPECT_EQ(1, disk_manager->DiscardLog(1000));
+  EXPECT_EQ(256, disk_manager->GetLogStart());
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log.256");
+}
+
+// log offsets go past what an int holds
+TEST(DiskManagerTest, LargeLogOffsetTest) {
+  const int64_t start = 1LL << 32;
+  const std::string name = "test.log." + std::to_string(start);
+  char buffer[64];
+  remove("test.db");
+  remove("test.log");
+  FILE *file = fopen(name.c_str(), "w");
+  ASSERT_NE(nullptr, file);
+  fputs("abcd", file);
+  fclose(file);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(start, disk_manager->GetLogStart());
+  EXPECT_EQ(start + 4, disk_manager->GetLogSize());
+  EXPECT_TRUE(disk_manager->ReadLog(buffer, 2, start + 2));
+  EXPECT_EQ('c', buffer[0]);
+  EXPECT_EQ('d', buffer[1]);
+  EXPECT_FALSE(disk_manager->ReadLog(buffer, 2, start + 4));
+  delete disk_manager;
+
+  remove("test.db");
+  remove(name.c_str());
+}
+
+TEST(DiskManagerTest, AllocateTest) {
+  remove("test.db");
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+
+  for (page_id_t page_id = 0; page_id < 10; ++page_id) {
+    EXPECT_EQ(page_id, disk_manager->AllocatePage());
+  }
+  // the lowest free page id is reused first
+  disk_manager->DeallocatePage(5);
+  disk_manager->DeallocatePage(3);
+  EXPECT_FALSE(disk_manager->IsAllocated(3));
+  EXPECT_EQ(3, disk_manager->AllocatePage());
+  EXPECT_EQ(5, disk_manager->AllocatePage());
+  EXPECT_EQ(10, disk_manager->AllocatePage());
+
+  // the map survives a restart
+  char data[PAGE_SIZE], buffer[PAGE_SIZE];
+  strcpy(data, "A test string.");
+  disk_manager->WritePage(7, data);
+  disk_manager->DeallocatePage(2);
+  delete disk_manager;
+  disk_manager = new DiskManager("test.db");
+  EXPECT_TRUE(disk_manager->IsAllocated(10));
+  EXPECT_FALSE(disk_manager->IsAllocated(2));
+  disk_manager->ReadPage(7, buffer);
+  EXPECT_EQ(0, memcmp(buffer, data, PAGE_DATA_SIZE));
+  EXPECT_EQ(2, disk_manager->AllocatePage());
+  EXPECT_EQ(11, disk_manager->AllocatePage());
+
+  // pages beyond the first map page
+  for (page_id_t page_id = 12; page_id < PAGES_PER_MAP + 10; ++page_id) {
+    disk_manager->AllocatePage();
+  }
+  disk_manager->WritePage(PAGES_PER_MAP + 5, data);
+  disk_manager->SyncPages();
+  delete disk_manager;
+  disk_manager = new DiskManager("test.db");
+  EXPECT_TRUE(disk_manager->IsAllocated(PAGES_PER_MAP + 9));
+  EXPECT_EQ(PAGES_PER_MAP + 10, disk_manager->AllocatePage());
+  disk_manager->ReadPage(PAGES_PER_MAP + 5, buffer);
+  EXPECT_EQ(0, memcmp(buffer, data, PAGE_DATA_SIZE));
+  disk_manager->ReadPage(7, buffer);
+  EXPECT_EQ(0, memcmp(buffer, data, PAGE_DATA_SIZE));
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, TruncateTest) {
+  remove("test.db");
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+
+  char data[PAGE_SIZE];
+  memset(data, 'x', PAGE_SIZE);
+  for (page_id_t page_id = 0; page_id < 100; ++page_id) {
+    EXPECT_EQ(page_id, disk_manager->AllocatePage());
+    disk_manager->WritePage(page_id, data);
+  }
+  disk_manager->SyncPages();
+  struct stat stat_buf;
+  stat("test.db", &stat_buf);
+  // file header, map page and the pages
+  EXPECT_EQ(102 * PAGE_SIZE, stat_buf.st_size);
+
+  // only the free tail goes away
+  for (page_id_t page_id = 40; page_id < 100; ++page_id) {
+    if (page_id != 50) {
+      disk_manager->DeallocatePage(page_id);
+    }
+  }
+  EXPECT_EQ(51, disk_manager->Truncate());
+  stat("test.db", &stat_buf);
+  EXPECT_EQ(53 * PAGE_SIZE, stat_buf.st_size);
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(40, disk_manager->AllocatePage());
+  disk_manager->DeallocatePage(40);
+  disk_manager->DeallocatePage(50);
+  EXPECT_EQ(40, disk_manager->Truncate());
+  EXPECT_EQ(40, disk_manager->AllocatePage());
+  EXPECT_EQ(41, disk_manager->AllocatePage());
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, ExtentTest) {
+  remove("test.db");
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+
+  EXPECT_EQ(0, disk_manager->AllocatePage());
+  // two objects allocating in turn still get runs of their own
+  Extent extent_a, extent_b;
+  for (page_id_t i = 0; i < EXTENT_SIZE; ++i) {
+    EXPECT_EQ(EXTENT_SIZE + i, disk_manager->AllocatePage(&extent_a));
+    EXPECT_EQ(2 * EXTENT_SIZE + i, disk_manager->AllocatePage(&extent_b));
+  }
+  for (page_id_t i = 0; i < 2; ++i) {
+    EXPECT_EQ(3 * EXTENT_SIZE + i, disk_manager->AllocatePage(&extent_a));
+    EXPECT_EQ(4 * EXTENT_SIZE + i, disk_manager->AllocatePage(&extent_b));
+  }
+  // the file is preallocated up to the end of the last extent
+  struct stat stat_buf;
+  stat("test.db", &stat_buf);
+  EXPECT_LE(5 * EXTENT_SIZE * PAGE_SIZE, stat_buf.st_size);
+
+  // single pages fill the gap before the first extent, then skip the
+  // reserved page ids
+  for (page_id_t page_id = 1; page_id < EXTENT_SIZE; ++page_id) {
+    EXPECT_EQ(page_id, disk_manager->AllocatePage());
+  }
+  EXPECT_EQ(5 * EXTENT_SIZE, disk_manager->AllocatePage());
+  EXPECT_FALSE(disk_manager->IsAllocated(3 * EXTENT_SIZE + 2));
+
+  // released page ids are free again
+  disk_manager->ReleaseExtent(&extent_a);
+  EXPECT_EQ(3 * EXTENT_SIZE + 2, disk_manager->AllocatePage());
+  EXPECT_EQ(6 * EXTENT_SIZE, disk_manager->AllocatePage(&extent_a));
+  delete disk_manager;
+
+  // and so are the ones of extents which were not released
+  disk_manager = new DiskManager("test.db");
+  EXPECT_TRUE(disk_manager->IsAllocated(4 * EXTENT_SIZE + 1));
+  EXPECT_FALSE(disk_manager->IsAllocated(4 * EXTENT_SIZE + 2));
+  EXPECT_EQ(3 * EXTENT_SIZE + 3, disk_manager->AllocatePage());
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+}
+
+// the file is opened again while the disk manager which allocated the pages
+// is still open, as if it had crashed
+TEST(DiskManagerTest, CrashAllocateTest) {
+  remove("test.db");
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+
+  for (page_id_t page_id = 0; page_id < 10; ++page_id) {
+    EXPECT_EQ(page_id, disk_manager->AllocatePage());
+  }
+  Extent extent;
+  EXPECT_EQ(EXTENT_SIZE, disk_manager->AllocatePage(&extent));
+  EXPECT_EQ(EXTENT_SIZE + 1, disk_manager->AllocatePage(&extent));
+  disk_manager->SyncPages();
+  // after the checkpoint, left to recovery
+  EXPECT_EQ(10, disk_manager->AllocatePage());
+
+  DiskManager *recovered = new DiskManager("test.db");
+  for (page_id_t page_id = 0; page_id < 10; ++page_id) {
+    EXPECT_TRUE(recovered->IsAllocated(page_id));
+  }
+  EXPECT_FALSE(recovered->IsAllocated(10));
+  // the ids left in the extent are leaked, never handed out twice
+  EXPECT_TRUE(recovered->IsAllocated(EXTENT_SIZE + 1));
+  EXPECT_TRUE(recovered->IsAllocated(2 * EXTENT_SIZE - 1));
+  Extent next;
+  EXPECT_EQ(10, recovered->AllocatePage());
+  EXPECT_EQ(2 * EXTENT_SIZE, recovered->AllocatePage(&next));
+  delete recovered;
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+}
+
+// a file which is not a db file is left as it is
+TEST(DiskManagerTest, UnknownFormatTest) {
+  remove("test.db");
+  remove("test.log");
+  char data[PAGE_SIZE];
+  memset(data, 'x', PAGE_SIZE);
+  FILE *file = fopen("test.db", "w");
+  ASSERT_NE(nullptr, file);
+  EXPECT_EQ(1, fwrite(data, PAGE_SIZE, 1, file));
+  fclose(file);
+
+  EXPECT_THROW(DiskManager("test.db"), Exception);
+  EXPECT_THROW(DiskManager("test.db", IOEngineType::AUTO, true), Exception);
+  char buffer[PAGE_SIZE];
+  file = fopen("test.db", "r");
+  ASSERT_NE(nullptr, file);
+  EXPECT_EQ(1, fread(buffer, PAGE_SIZE, 1, file));
+  fclose(file);
+  EXPECT_EQ(0, memcmp(buffer, data, PAGE_SIZE));
+  struct stat stat_buf;
+  EXPECT_NE(0, stat("test.log", &stat_buf));
+
+  remove("test.db");
+  remove("test.log");
+}
+
+// a file written before there was a file header is read and written in place
+TEST(DiskManagerTest, LegacyLayoutTest) {
+  remove("test.db");
+  remove("test.log");
+  char data[3][PAGE_SIZE];
+  memset(data[0], 0, PAGE_SIZE);
+  int32_t record_count = 1;
+  memcpy(data[0], &record_count, sizeof(record_count));
+  memset(data[1], 'a', PAGE_SIZE);
+  memset(data[2], 'b', PAGE_SIZE);
+  FILE *file = fopen("test.db", "w");
+  ASSERT_NE(nullptr, file);
+  EXPECT_EQ(3, fwrite(data, PAGE_SIZE, 3, file));
+  fclose(file);
+
+  char buffer[PAGE_SIZE];
+  DiskManager *disk_manager = new DiskManager("test.db");
+  EXPECT_TRUE(disk_manager->IsLegacyLayout());
+  EXPECT_FALSE(disk_manager->HasChecksums());
+  EXPECT_TRUE(disk_manager->ReadPage(1, buffer));
+  EXPECT_EQ(0, memcmp(buffer, data[1], PAGE_SIZE));
+  EXPECT_TRUE(disk_manager->IsAllocated(2));
+  page_id_t page_id = disk_manager->AllocatePage();
+  EXPECT_EQ(3, page_id);
+  memset(buffer, 'c', PAGE_SIZE);
+  EXPECT_TRUE(disk_manager->WritePage(page_id, buffer));
+  disk_manager->SyncPages();
+  delete disk_manager;
+
+  // nothing but the page was written
+  struct stat stat_buf;
+  EXPECT_EQ(0, stat("test.db", &stat_buf));
+  EXPECT_EQ(4 * PAGE_SIZE, stat_buf.st_size);
+  disk_manager = new DiskManager("test.db", IOEngineType::AUTO, true);
+  EXPECT_TRUE(disk_manager->IsLegacyLayout());
+  EXPECT_TRUE(disk_manager->ReadPage(0, buffer));
+  EXPECT_EQ(0, memcmp(buffer, data[0], PAGE_SIZE));
+  EXPECT_TRUE(disk_manager->ReadPage(3, buffer));
+  EXPECT_EQ('c', buffer[PAGE_SIZE - 1]);
+  EXPECT_EQ('b', disk_manager->GetMappedPage(2)[0]);
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, ReadPagesTest) {
+  remove("test.db");
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+
+  // the run crosses the second map page and ends past the end of file
+  const page_id_t first_page_id = PAGES_PER_MAP - 3;
+  const size_t count = 8;
+  char data[PAGE_SIZE];
+  for (page_id_t page_id = first_page_id; page_id < first_page_id + 6;
+       ++page_id) {
+    memset(data, page_id % 100, PAGE_SIZE);
+    disk_manager->WritePage(page_id, data);
+  }
+  std::vector<char> buffer(count * PAGE_SIZE, 'x');
+  std::vector<char *> buffers;
+  for (size_t i = 0; i < count; ++i) {
+    buffers.push_back(&buffer[i * PAGE_SIZE]);
+  }
+  disk_manager->ReadPages(first_page_id, count, buffers.data());
+  for (size_t i = 0; i < count; ++i) {
+    char expected = i < 6 ? (first_page_id + i) % 100 : 0;
+    EXPECT_EQ(expected, buffers[i][0]);
+    EXPECT_EQ(expected, buffers[i][PAGE_DATA_SIZE - 1]);
+  }
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, SegmentTest) {
+  remove("test.db");
+  remove("test.log");
+  // the file header, a map page and 6 pages, then 8 pages in each segment
+  const size_t segment_size = 8 * PAGE_SIZE;
+  DiskManager *disk_manager = new DiskManager(
+      "test.db", IOEngineType::AUTO, false, false, segment_size);
+  EXPECT_EQ(segment_size, disk_manager->GetSegmentSize());
+  char data[PAGE_SIZE] = {0}, buffer[PAGE_SIZE];
+  for (page_id_t page_id = 0; page_id < 31; ++page_id) {
+    EXPECT_EQ(page_id, disk_manager->AllocatePage());
+    snprintf(data, PAGE_SIZE, "page %d", page_id);
+    disk_manager->WritePage(page_id, data);
+  }
+  disk_manager->SyncPages();
+  struct stat st;
+  EXPECT_EQ(0, stat("test.db", &st));
+  EXPECT_EQ(static_cast<off_t>(segment_size), st.st_size);
+  EXPECT_EQ(0, stat("test.db.3", &st));
+  EXPECT_EQ(0, stat("test.db.4", &st));
+
+  // a run and an asynchronous batch across segments
+  std::vector<char> run(8 * PAGE_SIZE);
+  std::vector<char *> buffers;
+  for (size_t i = 0; i < 8; ++i) {
+    buffers.push_back(&run[i * PAGE_SIZE]);
+  }
+  disk_manager->ReadPages(3, 8, buffers.data());
+  for (size_t i = 0; i < 8; ++i) {
+    snprintf(data, PAGE_SIZE, "page %zu", i + 3);
+    EXPECT_STREQ(data, buffers[i]);
+  }
+  snprintf(data, PAGE_SIZE, "page %d again", 13);
+  EXPECT_TRUE(disk_manager->WritePageAsync(13, data).get());
+  EXPECT_TRUE(disk_manager->ReadPageAsync(13, buffer).get());
+  EXPECT_STREQ(data, buffer);
+  delete disk_manager;
+
+  // the layout is kept, whatever the caller asks
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(segment_size, disk_manager->GetSegmentSize());
+  disk_manager->ReadPage(29, buffer);
+  EXPECT_STREQ("page 29", buffer);
+
+  // segment 2 holds pages 14 to 21, segment 4 page 30
+  for (page_id_t page_id = 14; page_id < 22; ++page_id) {
+    disk_manager->DeallocatePage(page_id);
+  }
+  disk_manager->DeallocatePage(30);
+  EXPECT_EQ(30, disk_manager->Truncate());
+  EXPECT_NE(0, stat("test.db.2", &st));
+  EXPECT_EQ(0, stat("test.db.3", &st));
+  EXPECT_NE(0, stat("test.db.4", &st));
+  disk_manager->ReadPage(14, buffer);
+  EXPECT_EQ(0, buffer[0]);
+  disk_manager->ReadPage(22, buffer);
+  EXPECT_STREQ("page 22", buffer);
+  delete disk_manager;
+
+  // the missing segment comes back when one of its pages is written
+  disk_manager = new DiskManager("test.db");
+  disk_manager->ReadPage(28, buffer);
+  EXPECT_STREQ("page 28", buffer);
+  EXPECT_EQ(14, disk_manager->AllocatePage());
+  snprintf(data, PAGE_SIZE, "page %d", 14);
+  disk_manager->WritePage(14, data);
+  disk_manager->ReadPage(14, buffer);
+  EXPECT_STREQ(data, buffer);
+  EXPECT_EQ(0, stat("test.db.2", &st));
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.db.1");
+  remove("test.db.2");
+  remove("test.db.3");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, DirectIOTest) {
+  remove("test.db");
+  remove("test.log");
+  // segments are opened with O_DIRECT as they show up
+  const size_t segment_size = 8 * PAGE_SIZE;
+  DiskManager *disk_manager =
+      new DiskManager("test.db", IOEngineType::AUTO, false, false,
+                      segment_size, true);
+  if (!disk_manager->IsDirectIO()) {
+    std::cout << "no direct I/O on this file system" << std::endl;
+  }
+  // buffers off the page alignment go through a copy
+  std::vector<char> storage(17 * PAGE_SIZE);
+  char *data = &storage[1];
+  char *buffer = &storage[PAGE_SIZE + 2];
+  for (page_id_t page_id = 0; page_id < 16; ++page_id) {
+    EXPECT_EQ(page_id, disk_manager->AllocatePage());
+    snprintf(data, PAGE_SIZE, "page %d", page_id);
+    disk_manager->WritePage(page_id, data);
+  }
+  disk_manager->ReadPage(5, buffer);
+  EXPECT_STREQ("page 5", buffer);
+  std::vector<char *> buffers;
+  for (size_t i = 0; i < 12; ++i) {
+    buffers.push_back(&storage[3 * PAGE_SIZE + i * (PAGE_SIZE + 1)]);
+  }
+  disk_manager->ReadPages(2, 12, buffers.data());
+  for (size_t i = 0; i < 12; ++i) {
+    snprintf(data, PAGE_SIZE, "page %zu", i + 2);
+    EXPECT_STREQ(data, buffers[i]);
+  }
+  snprintf(data, PAGE_SIZE, "page %d again", 9);
+  EXPECT_TRUE(disk_manager->WritePageAsync(9, data).get());
+  memset(buffer, 0, PAGE_SIZE);
+  EXPECT_TRUE(disk_manager->ReadPageAsync(9, buffer).get());
+  EXPECT_STREQ(data, buffer);
+  EXPECT_EQ(0u, disk_manager->GetNumChecksumFailures());
+  delete disk_manager;
+
+  // the same file through the page cache, and read only without mapping
+  disk_manager = new DiskManager("test.db");
+  EXPECT_FALSE(disk_manager->IsDirectIO());
+  disk_manager->ReadPage(9, buffer);
+  EXPECT_STREQ("page 9 again", buffer);
+  delete disk_manager;
+  disk_manager = new DiskManager("test.db", IOEngineType::AUTO, true, false,
+                                 0, true);
+  EXPECT_EQ(!disk_manager->IsDirectIO(), disk_manager->IsMapped());
+  disk_manager->ReadPage(15, buffer);
+  EXPECT_STREQ("page 15", buffer);
+  EXPECT_EQ(0u, disk_manager->GetNumChecksumFailures());
+  delete disk_manager;
+
+  // compressed pages are not aligned, the page cache is used
+  remove("test.db");
+  disk_manager = new DiskManager("test.db", IOEngineType::AUTO, false, true,
+                                 0, true);
+  EXPECT_FALSE(disk_manager->IsDirectIO());
+  delete disk_manager;
+
+  for (size_t i = 1; i < 4; ++i) {
+    remove(("test.db." + std::to_string(i)).c_str());
+  }
+  remove("test.db");
+  remove("test.slots");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, ChecksumTest) {
+  remove("test.db");
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  char data[PAGE_SIZE], buffer[PAGE_SIZE];
+  memset(data, 'c', PAGE_SIZE);
+  for (page_id_t page_id = 0; page_id < 2 * CHECKSUM_SAMPLE_RATE;
+       ++page_id) {
+    disk_manager->WritePage(page_id, data);
+  }
+  // the page of the caller is not changed
+  EXPECT_EQ('c', data[PAGE_SIZE - 1]);
+  EXPECT_TRUE(disk_manager->HasChecksums());
+  EXPECT_TRUE(disk_manager->ReadPage(0, buffer));
+  EXPECT_EQ(0, memcmp(buffer, data, PAGE_DATA_SIZE));
+  // never written: zeros, fine if the page is allocated
+  EXPECT_FALSE(disk_manager->ReadPage(4 * CHECKSUM_SAMPLE_RATE, buffer));
+  EXPECT_FALSE(disk_manager->ReadPageAsync(4 * CHECKSUM_SAMPLE_RATE, buffer)
+                   .get());
+  disk_manager->ReservePage(4 * CHECKSUM_SAMPLE_RATE);
+  EXPECT_TRUE(disk_manager->ReadPage(4 * CHECKSUM_SAMPLE_RATE, buffer));
+  EXPECT_TRUE(disk_manager->ReadPageAsync(4 * CHECKSUM_SAMPLE_RATE, buffer)
+                  .get());
+  EXPECT_EQ(0u, disk_manager->GetNumChecksumFailures());
+  delete disk_manager;
+
+  // flip a byte of every page behind the back of the disk manager
+  FILE *file = fopen("test.db", "r+b");
+  ASSERT_NE(nullptr, file);
+  for (page_id_t page_id = 0; page_id < 2 * CHECKSUM_SAMPLE_RATE;
+       ++page_id) {
+    fseek(file, (page_id + 2) * PAGE_SIZE + 100, SEEK_SET);
+    fputc('d', file);
+  }
+  fclose(file);
+
+  disk_manager = new DiskManager("test.db");
+  EXPECT_FALSE(disk_manager->ReadPage(0, buffer));
+  EXPECT_EQ(1u, disk_manager->GetNumChecksumFailures());
+  EXPECT_FALSE(disk_manager->ReadPageAsync(1, buffer).get());
+  EXPECT_EQ(2u, disk_manager->GetNumChecksumFailures());
+
+  disk_manager->SetChecksumMode(ChecksumMode::OFF);
+  EXPECT_TRUE(disk_manager->ReadPage(0, buffer));
+  EXPECT_TRUE(disk_manager->ReadPageAsync(1, buffer).get());
+  EXPECT_EQ(2u, disk_manager->GetNumChecksumFailures());
+
+  disk_manager->SetChecksumMode(ChecksumMode::SAMPLED);
+  for (page_id_t page_id = 0; page_id < 2 * CHECKSUM_SAMPLE_RATE;
+       ++page_id) {
+    disk_manager->ReadPage(page_id, buffer);
+  }
+  EXPECT_EQ(4u, disk_manager->GetNumChecksumFailures());
+
+  // a run of pages tells which ones are corrupted
+  disk_manager->SetChecksumMode(ChecksumMode::ALWAYS);
+  std::vector<char> pages(4 * PAGE_SIZE);
+  std::vector<char *> buffers;
+  for (int i = 0; i < 4; ++i) {
+    buffers.push_back(&pages[i * PAGE_SIZE]);
+  }
+  bool valid[4];
+  // past the end of file, allocated and never written
+  disk_manager->ReservePage(2 * CHECKSUM_SAMPLE_RATE);
+  disk_manager->ReservePage(2 * CHECKSUM_SAMPLE_RATE + 1);
+  EXPECT_FALSE(disk_manager->ReadPages(2 * CHECKSUM_SAMPLE_RATE - 2, 4,
+                                       buffers.data(), valid));
+  EXPECT_FALSE(valid[0]);
+  EXPECT_FALSE(valid[1]);
+  EXPECT_TRUE(valid[2]);
+  EXPECT_TRUE(valid[3]);
+
+  // rewriting the page repairs it
+  disk_manager->WritePage(0, data);
+  EXPECT_TRUE(disk_manager->ReadPage(0, buffer));
+  EXPECT_EQ(6u, disk_manager->GetNumChecksumFailures());
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+}
+
+// a file cut short loses pages, they are not read back as empty ones
+TEST(DiskManagerTest, TruncatedFileTest) {
+  remove("test.db");
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  char data[PAGE_SIZE], buffer[PAGE_SIZE];
+  memset(data, 'c', PAGE_SIZE);
+  for (page_id_t page_id = 0; page_id < 4; ++page_id) {
+    EXPECT_EQ(page_id, disk_manager->AllocatePage());
+    EXPECT_TRUE(disk_manager->WritePage(page_id, data));
+  }
+  delete disk_manager;
+
+  // page 2 in the middle, page 3 is gone
+  EXPECT_EQ(0, truncate("test.db", 4 * PAGE_SIZE + 100));
+  disk_manager = new DiskManager("test.db");
+  disk_manager->SetChecksumMode(ChecksumMode::OFF);
+  EXPECT_TRUE(disk_manager->ReadPage(1, buffer));
+  EXPECT_FALSE(disk_manager->ReadPage(2, buffer));
+  EXPECT_FALSE(disk_manager->ReadPage(3, buffer));
+  EXPECT_FALSE(disk_manager->ReadPageAsync(2, buffer).get());
+  bool valid[4];
+  std::vector<char> pages(4 * PAGE_SIZE);
+  std::vector<char *> buffers;
+  for (int i = 0; i < 4; ++i) {
+    buffers.push_back(&pages[i * PAGE_SIZE]);
+  }
+  EXPECT_FALSE(disk_manager->ReadPages(0, 4, buffers.data(), valid));
+  EXPECT_TRUE(valid[0]);
+  EXPECT_TRUE(valid[1]);
+  EXPECT_FALSE(valid[2]);
+  EXPECT_FALSE(valid[3]);
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+}
+
+// a file created before there were checksums uses the whole page
+TEST(DiskManagerTest, NoChecksumTest) {
+  remove("test.db");
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  delete disk_manager;
+  // clear the flag in the file header
+  FILE *file = fopen("test.db", "r+b");
+  ASSERT_NE(nullptr, file);
+  uint32_t flags = 0;
+  fseek(file, 12, SEEK_SET);
+  EXPECT_EQ(1, fwrite(&flags, sizeof(flags), 1, file));
+  fclose(file);
+
+  char data[PAGE_SIZE], buffer[PAGE_SIZE];
+  memset(data, 'c', PAGE_SIZE);
+  disk_manager = new DiskManager("test.db");
+  EXPECT_FALSE(disk_manager->HasChecksums());
+  EXPECT_EQ(0, disk_manager->AllocatePage());
+  disk_manager->WritePage(0, data);
+  EXPECT_TRUE(disk_manager->ReadPage(0, buffer));
+  EXPECT_EQ(0, memcmp(buffer, data, PAGE_SIZE));
+  delete disk_manager;
+
+  // still without after a restart
+  disk_manager = new DiskManager("test.db");
+  EXPECT_FALSE(disk_manager->HasChecksums());
+  EXPECT_TRUE(disk_manager->ReadPage(0, buffer));
+  EXPECT_EQ(0, memcmp(buffer, data, PAGE_SIZE));
+  EXPECT_EQ(0u, disk_manager->GetNumChecksumFailures());
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, CompressionTest) {
+  remove("test.db");
+  remove("test.log");
+  remove("test.slots");
+  DiskManager *disk_manager =
+      new DiskManager("test.db", IOEngineType::AUTO, false, true);
+  EXPECT_TRUE(disk_manager->IsCompressed());
+
+  // pages which compress, and one which does not
+  char data[PAGE_SIZE] = {0}, buffer[PAGE_SIZE];
+  for (page_id_t page_id = 0; page_id < 10; ++page_id) {
+    EXPECT_EQ(page_id, disk_manager->AllocatePage());
+    snprintf(data, PAGE_SIZE, "page %d", page_id);
+    disk_manager->WritePage(page_id, data);
+  }
+  unsigned int seed = 15445;
+  for (size_t i = 0; i < PAGE_SIZE; ++i) {
+    data[i] = static_cast<char>(rand_r(&seed));
+  }
+  disk_manager->WritePage(9, data);
+  disk_manager->SyncPages();
+  struct stat st;
+  EXPECT_EQ(0, stat("test.db", &st));
+  EXPECT_GT(12 * PAGE_SIZE, st.st_size);
+
+  // a page which grows moves to another slot
+  disk_manager->WritePage(0, data);
+  CompressionStats stats = disk_manager->GetCompressionStats();
+  EXPECT_EQ(12u, stats.pages_written);
+  EXPECT_EQ(12u * PAGE_SIZE, stats.bytes_in);
+  EXPECT_GT(3u * PAGE_SIZE, stats.bytes_out);
+  delete disk_manager;
+
+  // the format is kept, whatever the caller asks
+  disk_manager = new DiskManager("test.db");
+  EXPECT_TRUE(disk_manager->IsCompressed());
+  disk_manager->ReadPage(0, buffer);
+  EXPECT_EQ(0, memcmp(buffer, data, PAGE_DATA_SIZE));
+  disk_manager->ReadPage(9, buffer);
+  EXPECT_EQ(0, memcmp(buffer, data, PAGE_DATA_SIZE));
+  memset(data, 0, PAGE_SIZE);
+  for (page_id_t page_id = 1; page_id < 9; ++page_id) {
+    snprintf(data, PAGE_SIZE, "page %d", page_id);
+    disk_manager->ReadPage(page_id, buffer);
+    EXPECT_EQ(0, memcmp(buffer, data, PAGE_DATA_SIZE));
+  }
+  // never written
+  disk_manager->ReadPage(20, buffer);
+  EXPECT_EQ(0, buffer[0]);
+  EXPECT_EQ(0, buffer[PAGE_SIZE - 1]);
+
+  // the slots freed by a sync are reused, the file stops growing
+  int64_t size = 0;
+  for (int round = 0; round < 10; ++round) {
+    for (page_id_t page_id = 0; page_id < 10; ++page_id) {
+      snprintf(data, PAGE_SIZE, "page %d round %d", page_id, round);
+      disk_manager->WritePage(page_id, data);
+    }
+    disk_manager->SyncPages();
+    if (round == 0) {
+      EXPECT_EQ(0, stat("test.db", &st));
+      size = st.st_size;
+    }
+  }
+  EXPECT_EQ(0, stat("test.db", &st));
+  EXPECT_GE(size, st.st_size);
+  delete disk_manager;
+
+  // a read only replica reads the compressed pages too
+  disk_manager = new DiskManager("test.db", IOEngineType::AUTO, true);
+  EXPECT_TRUE(disk_manager->IsCompressed());
+  EXPECT_FALSE(disk_manager->IsMapped());
+  disk_manager->ReadPage(3, buffer);
+  EXPECT_STREQ("page 3 round 9", buffer);
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+  remove("test.slots");
+}
+
+// the slot table is synced while pages are written, a replica opened after
+// each sync finds every page it points to
+TEST(DiskManagerTest, CompressionSyncTest) {
+  const int num_threads = 4;
+  const int pages_per_thread = 8;
+  remove("test.db");
+  remove("test.log");
+  remove("test.slots");
+  DiskManager *disk_manager =
+      new DiskManager("test.db", IOEngineType::AUTO, false, true);
+  char data[PAGE_SIZE] = {0};
+  for (int i = 0; i < num_threads * pages_per_thread; ++i) {
+    page_id_t page_id = disk_manager->AllocatePage();
+    snprintf(data, PAGE_SIZE, "page %d", page_id);
+    disk_manager->WritePage(page_id, data);
+  }
+  disk_manager->SyncPages();
+
+  std::atomic<bool> done(false);
+  std::vector<std::thread> writers;
+  for (int t = 0; t < num_threads; ++t) {
+    writers.emplace_back([&, t]() {
+      char page[PAGE_SIZE] = {0};
+      // the size changes from round to round, and so do the slots
+      for (int round = 0; !done; ++round) {
+        for (int i = 0; i < pages_per_thread; ++i) {
+          page_id_t page_id = t * pages_per_thread + i;
+          int n = snprintf(page, PAGE_SIZE, "page %d", page_id);
+          unsigned int seed = round;
+          for (int j = n + 1; j < n + 1 + round % 5 * 500; ++j) {
+            page[j] = static_cast<char>(rand_r(&seed));
+          }
+          disk_manager->WritePage(page_id, page);
+        }
+      }
+    });
+  }
+
+  char buffer[PAGE_SIZE];
+  for (int sync = 0; sync < 20; ++sync) {
+    disk_manager->SyncPages();
+    DiskManager replica("test.db", IOEngineType::AUTO, true);
+    for (page_id_t page_id = 0; page_id < num_threads * pages_per_thread;
+         ++page_id) {
+      replica.ReadPage(page_id, buffer);
+      snprintf(data, PAGE_SIZE, "page %d", page_id);
+      EXPECT_STREQ(data, buffer);
+    }
+    EXPECT_EQ(0, replica.GetNumChecksumFailures());
+  }
+  done = true;
+  for (auto &writer : writers) {
+    writer.join();
+  }
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+  remove("test.slots");
+}
+
+TEST(DiskManagerTest, CompressionBenchmark) {
+  remove("test.db");
+  remove("test.log");
+  remove("test.slots");
+  DiskManager *disk_manager =
+      new DiskManager("test.db", IOEngineType::AUTO, false, true);
+
+  // tuples of a table with varchar columns, numbered and mostly alike
+  const page_id_t num_pages = 1000;
+  char data[PAGE_SIZE], buffer[PAGE_SIZE];
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    memset(data, 0, PAGE_SIZE);
+    size_t offset = 0;
+    for (int i = 0; offset + 64 < PAGE_SIZE; ++i) {
+      offset += snprintf(data + offset, 64, "%08d|customer#%06d|ACTIVE|",
+                         page_id * 100 + i, (page_id * 37 + i) % 5000) + 1;
+    }
+    disk_manager->WritePage(page_id, data);
+  }
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    disk_manager->ReadPage(page_id, buffer);
+  }
+  CompressionStats stats = disk_manager->GetCompressionStats();
+  std::cout << "compression ratio "
+            << static_cast<double>(stats.bytes_in) / stats.bytes_out
+            << ", compress " << stats.compress_ns / stats.pages_written
+            << " ns/page, decompress "
+            << stats.decompress_ns / stats.pages_read << " ns/page"
+            << std::endl;
+  EXPECT_EQ(static_cast<uint64_t>(num_pages), stats.pages_read);
+  EXPECT_LT(stats.bytes_out * 2, stats.bytes_in);
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+  remove("test.slots");
+}
+
+TEST(DiskManagerTest, ConcurrentTest) {
+  remove("test.db");
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+
+  // neighbouring pages are written by different threads
+  const int num_threads = 4;
+  const int num_pages = 400;
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([disk_manager, tid]() {
+      char data[PAGE_SIZE], buffer[PAGE_SIZE];
+      for (int round = 0; round < 3; ++round) {
+        for (page_id_t page_id = tid; page_id < num_pages;
+             page_id += num_threads) {
+          memset(data, page_id + round, PAGE_SIZE);
+          disk_manager->WritePage(page_id, data);
+          disk_manager->ReadPage(page_id, buffer);
+          EXPECT_EQ(0, memcmp(buffer, data, PAGE_DATA_SIZE));
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // then every thread reads all the pages
+  threads.clear();
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([disk_manager]() {
+      char buffer[PAGE_SIZE];
+      for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+        disk_manager->ReadPage(page_id, buffer);
+        EXPECT_EQ((char)(page_id + 2), buffer[0]);
+        EXPECT_EQ((char)(page_id + 2), buffer[PAGE_DATA_SIZE - 1]);
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
@@ -0,0 +1,151 @@
+/**
+ * io_engine_test.cpp
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include "disk/disk_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(IOEngineTest, ReadWriteTest) {
+  for (auto type : {IOEngineType::URING, IOEngineType::THREAD_POOL}) {
+    remove("test.db");
+    DiskManager *disk_manager = new DiskManager("test.db", type);
+    if (disk_manager->GetIOEngineType() != type) {
+      printf("io_uring is not available, tested the thread pool\n");
+    }
+
+    // more pages than the queue depth, Submit waits for free slots
+    const int num_pages = 3 * IO_QUEUE_DEPTH;
+    std::vector<char> data(num_pages * PAGE_SIZE);
+    std::vector<std::promise<bool>> done(num_pages);
+    std::vector<PageIORequest> requests;
+    for (int i = 0; i < num_pages; ++i) {
+      memset(&data[i * PAGE_SIZE], i, PAGE_SIZE);
+      std::promise<bool> *promise = &done[i];
+      requests.push_back({true, i, &data[i * PAGE_SIZE],
+                          [promise](bool ok) { promise->set_value(ok); }});
+    }
+    disk_manager->SubmitPageIO(requests);
+    for (auto &promise : done) {
+      EXPECT_TRUE(promise.get_future().get());
+    }
+
+    char buffer[PAGE_SIZE];
+    for (int i = 0; i < num_pages; ++i) {
+      disk_manager->ReadPage(i, buffer);
+      EXPECT_EQ(0, memcmp(&data[i * PAGE_SIZE], buffer, PAGE_SIZE));
+    }
+    std::vector<std::future<bool>> futures;
+    std::vector<char> read_data(num_pages * PAGE_SIZE);
+    for (int i = 0; i < num_pages; ++i) {
+      futures.push_back(
+          disk_manager->ReadPageAsync(i, &read_data[i * PAGE_SIZE]));
+    }
+    for (auto &future : futures) {
+      EXPECT_TRUE(future.get());
+    }
+    EXPECT_EQ(data, read_data);
+
+    // past the end of the file, zeros if the page is allocated
+    memset(buffer, 'x', PAGE_SIZE);
+    EXPECT_FALSE(disk_manager->ReadPageAsync(num_pages + 7, buffer).get());
+    disk_manager->ReservePage(num_pages + 7);
+    EXPECT_TRUE(disk_manager->ReadPageAsync(num_pages + 7, buffer).get());
+    EXPECT_EQ(0, buffer[0]);
+    EXPECT_EQ(0, buffer[PAGE_SIZE - 1]);
+    // and a write there grows the file
+    EXPECT_TRUE(disk_manager->WritePageAsync(num_pages + 7, &data[0]).get());
+    disk_manager->ReadPage(num_pages + 7, buffer);
+    EXPECT_EQ(0, memcmp(&data[0], buffer, PAGE_SIZE));
+
+    delete disk_manager;
+  }
+  remove("test.db");
+  remove("test.log");
+}
+
+// random page I/O with queue_depth requests in flight, in pages per second
+double IOBenchmark(DiskManager *disk_manager, bool is_write,
+                   size_t queue_depth) {
+  const int num_pages = 1024;
+  const int num_ops = 16384;
+  std::vector<char> buffers(queue_depth * PAGE_SIZE);
+  std::mutex latch;
+  std::condition_variable cv;
+  std::vector<size_t> free_slots;
+  for (size_t i = 0; i < queue_depth; ++i) {
+    free_slots.push_back(i);
+  }
+
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<page_id_t> dis(0, num_pages - 1);
+  auto start = std::chrono::steady_clock::now();
+  int issued = 0;
+  std::vector<PageIORequest> requests;
+  while (issued < num_ops) {
+    // refill the queue with as many requests as completed
+    requests.clear();
+    {
+      std::unique_lock<std::mutex> lock(latch);
+      cv.wait(lock, [&free_slots]() { return !free_slots.empty(); });
+      while (!free_slots.empty() && issued < num_ops) {
+        size_t slot = free_slots.back();
+        free_slots.pop_back();
+        requests.push_back({is_write, dis(gen), &buffers[slot * PAGE_SIZE],
+                            [&latch, &cv, &free_slots, slot](bool) {
+                              std::lock_guard<std::mutex> lock(latch);
+                              free_slots.push_back(slot);
+                              cv.notify_one();
+                            }});
+        ++issued;
+      }
+    }
+    disk_manager->SubmitPageIO(requests);
+  }
+  {
+    std::unique_lock<std::mutex> lock(latch);
+    cv.wait(lock, [&free_slots, queue_depth]() {
+      return free_slots.size() == queue_depth;
+    });
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return num_ops / elapsed.count();
+}
+
+TEST(IOEngineTest, BenchmarkTest) {
+  for (auto type : {IOEngineType::URING, IOEngineType::THREAD_POOL}) {
+    remove("test.db");
+    DiskManager *disk_manager = new DiskManager("test.db", type);
+    if (disk_manager->GetIOEngineType() != type) {
+      delete disk_manager;
+      continue;
+    }
+    char data[PAGE_SIZE] = {0};
+    for (page_id_t page_id = 0; page_id < 1024; ++page_id) {
+      disk_manager->WritePage(page_id, data);
+    }
+    const char *name = type == IOEngineType::URING ? "io_uring" : "threads";
+    for (size_t queue_depth : {1, 2, 4, 8, 16, 32, 64}) {
+      double reads = IOBenchmark(disk_manager, false, queue_depth);
+      double writes = IOBenchmark(disk_manager, true, queue_depth);
+      printf("%s queue depth %2zu: %8.0f reads/s, %8.0f writes/s\n", name,
+             queue_depth, reads, writes);
+    }
+    delete disk_manager;
+  }
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
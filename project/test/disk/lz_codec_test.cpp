@@ -0,0 +1,82 @@
+/**
+ * lz_codec_test.cpp
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+#include "disk/lz_codec.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// compress and decompress a page, return the compressed size
+static size_t RoundTrip(const char *page) {
+  char compressed[PAGE_SIZE], buffer[PAGE_SIZE];
+  size_t size = LZCodec::Compress(page, PAGE_SIZE, compressed, PAGE_SIZE);
+  if (size != 0) {
+    EXPECT_TRUE(LZCodec::Decompress(compressed, size, buffer, PAGE_SIZE));
+    EXPECT_EQ(0, memcmp(page, buffer, PAGE_SIZE));
+  }
+  return size;
+}
+
+TEST(LZCodecTest, RoundTripTest) {
+  char page[PAGE_SIZE];
+  // zeros, and a run overlapping the bytes it copies
+  memset(page, 0, PAGE_SIZE);
+  EXPECT_GT(64u, RoundTrip(page));
+  for (size_t i = 0; i < PAGE_SIZE; ++i) {
+    page[i] = "abc"[i % 3];
+  }
+  EXPECT_GT(64u, RoundTrip(page));
+
+  // text with long literal runs and matches
+  std::string text;
+  for (int i = 0; text.size() < PAGE_SIZE; ++i) {
+    text += "tuple " + std::to_string(i * 7919) + " name" +
+            std::string(i % 40, 'x') + ";";
+  }
+  memcpy(page, text.data(), PAGE_SIZE);
+  size_t size = RoundTrip(page);
+  EXPECT_LT(0u, size);
+  EXPECT_GT(PAGE_SIZE / 2u, size);
+
+  // random bytes do not compress
+  unsigned int seed = 15445;
+  for (size_t i = 0; i < PAGE_SIZE; ++i) {
+    page[i] = static_cast<char>(rand_r(&seed));
+  }
+  EXPECT_EQ(0u, RoundTrip(page));
+
+  // half random, half zeros
+  memset(page + PAGE_SIZE / 2, 0, PAGE_SIZE / 2);
+  size = RoundTrip(page);
+  EXPECT_LT(PAGE_SIZE / 2u, size);
+  EXPECT_GT(PAGE_SIZE * 3 / 4u, size);
+}
+
+TEST(LZCodecTest, CorruptTest) {
+  char page[PAGE_SIZE], compressed[PAGE_SIZE], buffer[PAGE_SIZE];
+  for (size_t i = 0; i < PAGE_SIZE; ++i) {
+    page[i] = static_cast<char>(i % 251 < 100 ? i % 7 : 'z');
+  }
+  size_t size = LZCodec::Compress(page, PAGE_SIZE, compressed, PAGE_SIZE);
+  ASSERT_LT(0u, size);
+
+  // truncated input, or a wrong size, is rejected
+  EXPECT_FALSE(LZCodec::Decompress(compressed, size / 2, buffer, PAGE_SIZE));
+  EXPECT_FALSE(LZCodec::Decompress(compressed, size, buffer, PAGE_SIZE - 1));
+  // whatever the bytes, nothing is written out of bounds
+  unsigned int seed = 15445;
+  for (int round = 0; round < 1000; ++round) {
+    std::vector<char> garbage(compressed, compressed + size);
+    garbage[rand_r(&seed) % size] = static_cast<char>(rand_r(&seed));
+    LZCodec::Decompress(garbage.data(), size, buffer, PAGE_SIZE);
+  }
+}
+
+} // namespace cmudb
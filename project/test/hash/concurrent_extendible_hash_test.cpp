@@ -0,0 +1,202 @@
+/**
+ * concurrent_extendible_hash_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "hash/concurrent_extendible_hash.h"
+#include "hash/extendible_hash.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ConcurrentExtendibleHashTest, SampleTest) {
+  ConcurrentExtendibleHash<int, std::string> test(2);
+  // 16 int keys fill a cache line
+  EXPECT_EQ(16, test.GetBucketCapacity());
+
+  // insert several key/value pairs
+  for (int i = 0; i < 64; ++i) {
+    test.Insert(i, std::to_string(i));
+  }
+  EXPECT_EQ(64, test.Size());
+  EXPECT_EQ(2, test.GetGlobalDepth());
+  EXPECT_EQ(4, test.GetNumBuckets());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(2, test.GetLocalDepth(i));
+  }
+
+  // find test
+  std::string result;
+  for (int i = 0; i < 64; ++i) {
+    EXPECT_EQ(1, test.Find(i, result));
+    EXPECT_EQ(std::to_string(i), result);
+  }
+  EXPECT_EQ(0, test.Find(64, result));
+
+  // override test
+  test.Insert(9, "nine");
+  test.Find(9, result);
+  EXPECT_EQ("nine", result);
+  EXPECT_EQ(64, test.Size());
+
+  // delete test
+  EXPECT_EQ(1, test.Remove(8));
+  EXPECT_EQ(1, test.Remove(4));
+  EXPECT_EQ(0, test.Remove(4));
+  EXPECT_EQ(0, test.Remove(100));
+  EXPECT_EQ(62, test.Size());
+  EXPECT_EQ(0, test.Find(8, result));
+  test.Find(12, result);
+  EXPECT_EQ("12", result);
+}
+
+TEST(ConcurrentExtendibleHashTest, SkewTest) {
+  ConcurrentExtendibleHash<int, int> test(16);
+
+  // only the bucket of the multiples of 64 keeps splitting
+  for (int i = 0; i < 1000; ++i) {
+    test.Insert(i * 64, i);
+  }
+  test.Insert(1, 1);
+  EXPECT_EQ(1001, test.Size());
+  EXPECT_EQ(12, test.GetGlobalDepth());
+  EXPECT_EQ(1, test.GetLocalDepth(1));
+
+  int value;
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(1, test.Find(i * 64, value));
+    EXPECT_EQ(i, value);
+  }
+  EXPECT_EQ(1, test.Find(1, value));
+}
+
+TEST(ConcurrentExtendibleHashTest, ConcurrentTest) {
+  const int num_threads = 8;
+  const int num_keys = 5000;
+  ConcurrentExtendibleHash<int, int> test(16);
+
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([&test, tid]() {
+      int value;
+      for (int i = tid; i < num_keys; i += num_threads) {
+        test.Insert(i, i);
+        EXPECT_EQ(1, test.Find(i, value));
+        EXPECT_EQ(i, value);
+      }
+      // remove the odd keys again
+      for (int i = tid; i < num_keys; i += num_threads) {
+        if (i % 2) {
+          EXPECT_EQ(1, test.Remove(i));
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(num_keys / 2, test.Size());
+  int value;
+  for (int i = 0; i < num_keys; ++i) {
+    EXPECT_EQ(i % 2 == 0, test.Find(i, value));
+  }
+}
+
+TEST(ConcurrentExtendibleHashTest, MergeTest) {
+  ConcurrentExtendibleHash<int, int> test(16);
+
+  for (int i = 0; i < 1024; ++i) {
+    test.Insert(i, i);
+  }
+  ExtendibleHashStats stats = test.GetStats();
+  EXPECT_EQ(64, stats.directory_size);
+  EXPECT_EQ(64, stats.num_buckets);
+  EXPECT_EQ(1024, stats.num_items);
+  EXPECT_EQ(16, stats.max_items);
+  EXPECT_DOUBLE_EQ(1, stats.occupancy);
+
+  // half a bucket is 8 items, 64 of them are too many to merge
+  for (int i = 0; i < 1024; ++i) {
+    if (i % 16 != 0) {
+      EXPECT_EQ(1, test.Remove(i));
+    }
+  }
+  stats = test.GetStats();
+  EXPECT_EQ(64, stats.directory_size);
+  EXPECT_EQ(64, stats.num_items);
+
+  // removing more merges buckets and halves the directory again
+  for (int i = 0; i < 1024; ++i) {
+    if (i % 16 == 0 && i % 128 != 0) {
+      EXPECT_EQ(1, test.Remove(i));
+    }
+  }
+  stats = test.GetStats();
+  EXPECT_EQ(8, stats.num_items);
+  EXPECT_EQ(0, stats.global_depth);
+  EXPECT_EQ(1, stats.directory_size);
+  EXPECT_EQ(1, stats.num_buckets);
+  EXPECT_EQ(1, test.GetNumBuckets());
+  EXPECT_EQ(63, stats.merges);
+  EXPECT_EQ(6, stats.shrinks);
+  EXPECT_DOUBLE_EQ(0.5, stats.occupancy);
+
+  int value;
+  for (int i = 0; i < 1024; ++i) {
+    EXPECT_EQ(i % 128 == 0, test.Find(i, value));
+  }
+}
+
+// page table lookups as done by the buffer pool, some inserts and removes
+template <typename H> double LookupBenchmark(int num_threads) {
+  const int num_keys = 4096;
+  const int num_ops = 200000;
+  H table(BUCKET_SIZE);
+  for (int i = 0; i < num_keys; ++i) {
+    table.Insert(i, i);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([&table, tid, num_threads]() {
+      std::mt19937 gen(tid);
+      std::uniform_int_distribution<int> dis(0, num_keys - 1);
+      int value;
+      for (int i = 0; i < num_ops / num_threads; ++i) {
+        int key = dis(gen);
+        if (i % 10 == 0) {
+          table.Remove(key);
+          table.Insert(key, key);
+        } else {
+          table.Find(key, value);
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  EXPECT_EQ(num_keys, table.Size());
+  return elapsed.count();
+}
+
+TEST(ConcurrentExtendibleHashTest, BenchmarkTest) {
+  for (int num_threads : {1, 4, 8}) {
+    double global = LookupBenchmark<ExtendibleHash<int, int>>(num_threads);
+    double latched =
+        LookupBenchmark<ConcurrentExtendibleHash<int, int>>(num_threads);
+    printf("page table %d thread(s): extendible %.2f ms, concurrent %.2f ms\n",
+           num_threads, global, latched);
+  }
+}
+
+} // namespace cmudb
@@ -117,9 +117,69 @@ TEST(ExtendibleHashTest, BasicRandomTest) {
     EXPECT_EQ(0, test->Find(i.first, value));
   }
 
+  // all buckets merged back into one
+  EXPECT_EQ(0, test->GetGlobalDepth());
+  EXPECT_EQ(1, test->GetNumBuckets());
+
   delete test;
 }
 
+TEST(ExtendibleHashTest, MergeTest) {
+  ExtendibleHash<int, int> test(4);
+
+  // 0 and 64 are told apart by the seventh bit only
+  for (int key : {0, 64, 128, 192, 256, 1, 2}) {
+    test.Insert(key, key);
+  }
+  EXPECT_EQ(7, test.GetGlobalDepth());
+  ExtendibleHashStats stats = test.GetStats();
+  EXPECT_EQ(128, stats.directory_size);
+  EXPECT_EQ(test.GetNumBuckets(), static_cast<int>(stats.num_buckets));
+  EXPECT_EQ(7, stats.num_items);
+
+  // half a bucket is two items, {0, 256} and {64} are too many together
+  EXPECT_EQ(1, test.Remove(192));
+  EXPECT_EQ(1, test.Remove(128));
+  EXPECT_EQ(0, test.GetStats().merges);
+
+  // {0} and {64} merge, then take over empty slots down to the bucket of 2
+  EXPECT_EQ(1, test.Remove(256));
+  stats = test.GetStats();
+  EXPECT_EQ(5, stats.merges);
+  EXPECT_EQ(0, stats.shrinks);
+  EXPECT_EQ(7, stats.global_depth);
+  EXPECT_EQ(2, test.GetLocalDepth(0));
+  EXPECT_EQ(test.GetNumBuckets(), static_cast<int>(stats.num_buckets));
+
+  // once the bucket of 1 is gone, no bucket needs the directory any more
+  EXPECT_EQ(1, test.Remove(2));
+  EXPECT_EQ(1, test.Remove(64));
+  EXPECT_EQ(7, test.GetGlobalDepth());
+  EXPECT_EQ(1, test.Remove(1));
+  stats = test.GetStats();
+  EXPECT_EQ(0, stats.global_depth);
+  EXPECT_EQ(1, stats.directory_size);
+  EXPECT_EQ(1, stats.num_buckets);
+  EXPECT_EQ(1, test.GetNumBuckets());
+  EXPECT_EQ(1, stats.num_items);
+  EXPECT_EQ(7, stats.shrinks);
+  EXPECT_DOUBLE_EQ(0.25, stats.occupancy);
+
+  int value;
+  EXPECT_EQ(1, test.Find(0, value));
+  EXPECT_EQ(0, test.Find(64, value));
+
+  // growing again works as before
+  for (int key : {64, 128, 192, 256}) {
+    test.Insert(key, key);
+  }
+  EXPECT_EQ(7, test.GetGlobalDepth());
+  for (int key : {0, 64, 128, 192, 256}) {
+    EXPECT_EQ(1, test.Find(key, value));
+    EXPECT_EQ(key, value);
+  }
+}
+
 TEST(ExtendibleHashTest, ConcurrentInsertTest) {
   const int num_runs = 50;
   const int num_threads = 3;
@@ -164,7 +224,9 @@ TEST(ExtendibleHashTest, ConcurrentRemoveTest) {
     for (int i = 0; i < num_threads; i++) {
       threads[i].join();
     }
-    EXPECT_EQ(test->GetGlobalDepth(), 6);
+    // removing may merge buckets and shrink the directory, depending on
+    // when the inserts run
+    EXPECT_LE(test->GetGlobalDepth(), 6);
     int val;
     EXPECT_EQ(0, test->Find(0, val));
     EXPECT_EQ(1, test->Find(8, val));
@@ -0,0 +1,74 @@
+/**
+ * replacer_test_util.h
+ */
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+// replay a page reference string on a tiny buffer pool of num_frames frames
+// and return the hit ratio of the point lookups
+inline double HitRatio(Replacer<int> &replacer, int num_frames,
+                       const std::vector<std::pair<int, bool>> &workload) {
+  std::unordered_map<int, int> page_table;
+  std::vector<int> frames(num_frames, INVALID_PAGE_ID);
+  std::list<int> free_list;
+  for (int i = 0; i < num_frames; ++i) {
+    free_list.push_back(i);
+  }
+
+  size_t lookups = 0, hits = 0;
+  for (auto &access : workload) {
+    int page_id = access.first;
+    auto it = page_table.find(page_id);
+    int frame;
+    if (it != page_table.end()) {
+      frame = it->second;
+      replacer.Erase(frame);
+      hits += access.second ? 1 : 0;
+    } else {
+      if (!free_list.empty()) {
+        frame = free_list.front();
+        free_list.pop_front();
+      } else {
+        EXPECT_EQ(true, replacer.Victim(frame));
+        page_table.erase(frames[frame]);
+      }
+      frames[frame] = page_id;
+      page_table[page_id] = frame;
+    }
+    lookups += access.second ? 1 : 0;
+    replacer.RecordAccess(frame, page_id);
+    replacer.Insert(frame);
+  }
+  return static_cast<double>(hits) / lookups;
+}
+
+// peeking must not change anything and must predict the following victims
+inline void ExpectPeekMatchesVictims(Replacer<int> &replacer) {
+  size_t size = replacer.Size();
+  std::vector<int> peeked;
+  EXPECT_EQ(size / 2, replacer.PeekVictims(peeked, size / 2));
+  EXPECT_EQ(size, replacer.PeekVictims(peeked, size + 1));
+  EXPECT_EQ(size, replacer.Size());
+
+  int value;
+  for (size_t i = 0; i < size; ++i) {
+    EXPECT_EQ(true, replacer.Victim(value));
+    EXPECT_EQ(peeked[size / 2 + i], value);
+    if (i < size / 2) {
+      EXPECT_EQ(peeked[i], value);
+    }
+  }
+  EXPECT_EQ(0, replacer.PeekVictims(peeked, 1));
+}
+
+} // namespace cmudb
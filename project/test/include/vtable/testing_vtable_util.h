@@ -7,6 +7,7 @@
 #include <cstdio>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "sqlite/sqlite3.h"
 #include "gtest/gtest.h"
@@ -38,4 +39,26 @@ bool ExecSQL(sqlite3 *db, std::string sql) {
   return true;
 }
 
+// For collecting result, a row is its values separated by '|'
+int RowCallback(void *rows, int argc, char **argv, char **azColName) {
+  std::string row;
+  for (int i = 0; i < argc; i++) {
+    row += (i == 0 ? "" : "|") + std::string(argv[i] ? argv[i] : "NULL");
+  }
+  static_cast<std::vector<std::string> *>(rows)->push_back(row);
+  return 0;
+}
+
+bool QuerySQL(sqlite3 *db, std::string sql, std::vector<std::string> &rows) {
+  char *zErrMsg = 0;
+  rows.clear();
+  int rc = sqlite3_exec(db, sql.c_str(), RowCallback, &rows, &zErrMsg);
+  if (rc != SQLITE_OK) {
+    std::cerr << "SQL error: " + std::string(zErrMsg) << std::endl;
+    sqlite3_free(zErrMsg);
+    return false;
+  }
+  return true;
+}
+
 } // namespace cmudb
\ No newline at end of file
@@ -16,6 +16,9 @@
 #include "gtest/gtest.h"
 
 namespace cmudb {
+// frames are split among shards, each with its own latch
+const size_t NUM_SHARDS = 4;
+
 // helper function to launch multiple threads
 template <typename... Args>
 void LaunchParallelTest(uint64_t num_threads, Args &&... args) {
@@ -106,7 +109,8 @@ TEST(BPlusTreeConcurrentTest, InsertTest1) {
   GenericComparator<8> comparator(key_schema);
 
   DiskManager *disk_manager = new DiskManager("test.db");
-  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager,
+                                                 nullptr, NUM_SHARDS);
   // create b+ tree
   BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
                                                            comparator);
@@ -151,8 +155,8 @@ TEST(BPlusTreeConcurrentTest, InsertTest1) {
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
 
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -162,7 +166,8 @@ TEST(BPlusTreeConcurrentTest, InsertTest2) {
   Schema *key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema);
   DiskManager *disk_manager = new DiskManager("test.db");
-  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager,
+                                                 nullptr, NUM_SHARDS);
   // create b+ tree
   BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
                                                            comparator);
@@ -205,8 +210,8 @@ TEST(BPlusTreeConcurrentTest, InsertTest2) {
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
 
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -217,7 +222,8 @@ TEST(BPlusTreeConcurrentTest, DeleteTest1) {
   GenericComparator<8> comparator(key_schema);
 
   DiskManager *disk_manager = new DiskManager("test.db");
-  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager,
+                                                 nullptr, NUM_SHARDS);
   // create b+ tree
   BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
                                                            comparator);
@@ -251,8 +257,8 @@ TEST(BPlusTreeConcurrentTest, DeleteTest1) {
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
 
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -263,7 +269,8 @@ TEST(BPlusTreeConcurrentTest, DeleteTest2) {
   GenericComparator<8> comparator(key_schema);
 
   DiskManager *disk_manager = new DiskManager("test.db");
-  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager,
+                                                 nullptr, NUM_SHARDS);
   // create b+ tree
   BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
                                                            comparator);
@@ -297,8 +304,8 @@ TEST(BPlusTreeConcurrentTest, DeleteTest2) {
   EXPECT_EQ(size, 4);
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -309,7 +316,8 @@ TEST(BPlusTreeConcurrentTest, MixTest) {
   GenericComparator<8> comparator(key_schema);
 
   DiskManager *disk_manager = new DiskManager("test.db");
-  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager,
+                                                 nullptr, NUM_SHARDS);
   // create b+ tree
   BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
                                                            comparator);
@@ -344,8 +352,8 @@ TEST(BPlusTreeConcurrentTest, MixTest) {
   EXPECT_EQ(size, 5);
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -356,7 +364,8 @@ TEST(BPlusTreeConcurrentTest, MixTest2) {
   GenericComparator<8> comparator(key_schema);
 
   DiskManager *disk_manager = new DiskManager("test.db");
-  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager,
+                                                 nullptr, NUM_SHARDS);
   // create b+ tree
   BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
                                                            comparator);
@@ -410,8 +419,8 @@ TEST(BPlusTreeConcurrentTest, MixTest2) {
   EXPECT_EQ(size, 100);
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
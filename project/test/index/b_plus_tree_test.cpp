@@ -66,11 +66,13 @@ TEST(BPlusTreeTests, InsertTest1) {
   }
 
   EXPECT_EQ(current_key, keys.size() + 1);
+  // a single leaf, the root
+  EXPECT_EQ("|  1   2   3   4   5 | ", tree.ToString(false));
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   delete transaction;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -142,8 +144,8 @@ TEST(BPlusTreeTests, InsertTest2) {
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   delete transaction;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -209,8 +211,8 @@ TEST(BPlusTreeTests, InsertScale) {
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   delete transaction;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -281,8 +283,8 @@ TEST(BPlusTreeTests, InsertRandom) {
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   delete transaction;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -357,8 +359,8 @@ TEST(BPlusTreeTests, DeleteBasic) {
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   delete transaction;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -439,8 +441,8 @@ TEST(BPlusTreeTests, DeleteScale) {
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   delete transaction;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -504,8 +506,8 @@ TEST(BPlusTreeTests, DeleteRandom) {
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   delete transaction;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -586,8 +588,8 @@ TEST(BPlusTreeTests, DeleteTest1) {
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   delete transaction;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -667,8 +669,8 @@ TEST(BPlusTreeTests, DeleteTest2) {
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   delete transaction;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -749,8 +751,8 @@ TEST(BPlusTreeTests, ScaleTest) {
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   delete transaction;
-  delete disk_manager;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
@@ -834,8 +836,68 @@ TEST(BPlusTreeTests, RandomTest) {
 
   bpm->UnpinPage(HEADER_PAGE_ID, true);
   delete transaction;
+  delete bpm;
   delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, LookupFetchTest) {
+  // create KeyComparator and index schema
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  // create b+ tree
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  GenericKey<8> index_key;
+  RID rid;
+  // create transaction
+  Transaction *transaction = new Transaction(0);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void) header_page;
+
+  // enough keys for a root and a level of leaves
+  for (int64_t key = 1; key <= 1000; ++key) {
+    rid.Set(0, key);
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, rid, transaction);
+  }
+
+  // a lookup fetches each level once, and leaves nothing pinned
+  std::vector<RID> rids;
+  for (int64_t key = 1; key <= 1000; key += 111) {
+    bpm->ResetStats();
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_EQ(true, tree.GetValue(index_key, rids));
+    EXPECT_EQ(key, rids[0].GetSlotNum());
+    BufferPoolStats stats = bpm->GetStats();
+    EXPECT_EQ(2, stats.hits + stats.misses);
+    EXPECT_EQ(true, bpm->Check());
+  }
+
+  // so does a scan, once per leaf after the descent
+  int64_t size = 0;
+  {
+    index_key.SetFromInteger(1);
+    for (auto iterator = tree.Begin(index_key); iterator.isEnd() == false;
+         ++iterator) {
+      size = size + 1;
+    }
+  }
+  EXPECT_EQ(size, 1000);
+  EXPECT_EQ(true, bpm->Check());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
   delete bpm;
+  delete disk_manager;
   remove("test.db");
   remove("test.log");
 }
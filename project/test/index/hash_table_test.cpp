@@ -0,0 +1,281 @@
+/**
+ * hash_table_test.cpp
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "index/extendible_hash_table.h"
+#include "page/header_page.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(HashTableTests, InsertTest) {
+  // create KeyComparator and index schema
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  // create hash table
+  ExtendibleHashTable<GenericKey<8>, RID, GenericComparator<8>> table(
+      "foo_pk", bpm, comparator);
+  GenericKey<8> index_key;
+  RID rid;
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void)header_page;
+
+  EXPECT_TRUE(table.IsEmpty());
+  std::vector<RID> rids;
+  index_key.SetFromInteger(1);
+  EXPECT_FALSE(table.GetValue(index_key, rids));
+
+  const int64_t scale = 10000;
+  for (int64_t key = 0; key < scale; ++key) {
+    rid.Set((int32_t)(key >> 32), (int32_t)(key & 0xFFFFFFFF));
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(table.Insert(index_key, rid));
+  }
+  // only support unique key
+  index_key.SetFromInteger(42);
+  EXPECT_FALSE(table.Insert(index_key, rid));
+  EXPECT_TRUE(table.Check());
+  EXPECT_LT(0, table.GetGlobalDepth());
+
+  // the directory and one bucket per lookup
+  bpm->ResetStats();
+  for (int64_t key = 0; key < scale; ++key) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(table.GetValue(index_key, rids));
+    EXPECT_EQ(1, rids.size());
+    EXPECT_EQ(key, rids[0].GetSlotNum());
+  }
+  BufferPoolStats stats = bpm->GetStats();
+  EXPECT_EQ(2 * scale, stats.hits + stats.misses);
+  index_key.SetFromInteger(scale);
+  EXPECT_FALSE(table.GetValue(index_key, rids));
+
+  // the directory page is recorded in the header page
+  page_id_t directory_page_id;
+  auto *header = static_cast<HeaderPage *>(header_page);
+  EXPECT_TRUE(header->GetRootId("foo_pk", directory_page_id));
+  EXPECT_EQ(table.GetDirectoryPageId(), directory_page_id);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(HashTableTests, DeleteTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  ExtendibleHashTable<GenericKey<8>, RID, GenericComparator<8>> table(
+      "foo_pk", bpm, comparator);
+  GenericKey<8> index_key;
+  RID rid;
+
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+
+  const int64_t scale = 5000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < scale; ++key) {
+    keys.push_back(key);
+    rid.Set(0, (int32_t)key);
+    index_key.SetFromInteger(key);
+    table.Insert(index_key, rid);
+  }
+  uint32_t num_buckets = table.GetNumBuckets();
+  EXPECT_LT(1, num_buckets);
+
+  // remove the odd keys
+  std::shuffle(keys.begin(), keys.end(), std::default_random_engine(0));
+  for (auto key : keys) {
+    if (key % 2) {
+      index_key.SetFromInteger(key);
+      table.Remove(index_key);
+    }
+  }
+  EXPECT_TRUE(table.Check());
+  std::vector<RID> rids;
+  for (int64_t key = 0; key < scale; ++key) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_EQ(key % 2 == 0, table.GetValue(index_key, rids));
+  }
+
+  // removing everything merges the buckets back into one
+  for (auto key : keys) {
+    index_key.SetFromInteger(key);
+    table.Remove(index_key);
+  }
+  EXPECT_TRUE(table.Check());
+  EXPECT_EQ(0, table.GetGlobalDepth());
+  EXPECT_EQ(1, table.GetNumBuckets());
+
+  // and it grows again
+  for (int64_t key = 0; key < scale; ++key) {
+    rid.Set(0, (int32_t)key);
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(table.Insert(index_key, rid));
+  }
+  EXPECT_TRUE(table.Check());
+  EXPECT_EQ(num_buckets, table.GetNumBuckets());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// FNV-1a over the key bytes, as the table hashes keys
+uint32_t HashOf(const GenericKey<8> &key) {
+  auto *data = reinterpret_cast<const unsigned char *>(&key);
+  uint32_t hash = 2166136261U;
+  for (size_t i = 0; i < sizeof(key); ++i) {
+    hash = (hash ^ data[i]) * 16777619U;
+  }
+  return hash;
+}
+
+TEST(HashTableTests, OverflowTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  ExtendibleHashTable<GenericKey<8>, RID, GenericComparator<8>> table(
+      "foo_pk", bpm, comparator);
+  GenericKey<8> index_key;
+  RID rid;
+
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+
+  // keys agreeing on every directory bit all go to one bucket: it splits to
+  // the largest depth, then chains overflow pages for the keys left
+  const size_t scale =
+      HashTableBucketPage<GenericKey<8>, RID, GenericComparator<8>>::
+          GetMaxSize() * 5 / 2;
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; keys.size() < scale; ++key) {
+    index_key.SetFromInteger(key);
+    if ((HashOf(index_key) & (HASH_DIRECTORY_ARRAY_SIZE - 1)) == 0) {
+      keys.push_back(key);
+    }
+  }
+  for (auto key : keys) {
+    rid.Set(0, (int32_t)key);
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(table.Insert(index_key, rid));
+  }
+  EXPECT_EQ(HASH_DIRECTORY_MAX_DEPTH, table.GetGlobalDepth());
+  // one split per level, the other buckets stay empty
+  EXPECT_EQ(HASH_DIRECTORY_MAX_DEPTH + 1, table.GetNumBuckets());
+  EXPECT_TRUE(table.Check());
+
+  std::vector<RID> rids;
+  for (auto key : keys) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(table.GetValue(index_key, rids));
+    EXPECT_EQ(key, rids[0].GetSlotNum());
+  }
+
+  // emptying the overflow pages
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (i % 4) {
+      index_key.SetFromInteger(keys[i]);
+      table.Remove(index_key);
+    }
+  }
+  EXPECT_TRUE(table.Check());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    rids.clear();
+    index_key.SetFromInteger(keys[i]);
+    EXPECT_EQ(i % 4 == 0, table.GetValue(index_key, rids));
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(HashTableTests, ConcurrentTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  ExtendibleHashTable<GenericKey<8>, RID, GenericComparator<8>> table(
+      "foo_pk", bpm, comparator);
+
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+
+  const int num_threads = 4;
+  const int64_t scale = 4000;
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.push_back(std::thread([&table, tid]() {
+      GenericKey<8> index_key;
+      RID rid;
+      std::vector<RID> rids;
+      for (int64_t key = tid; key < scale; key += num_threads) {
+        rid.Set(0, (int32_t)key);
+        index_key.SetFromInteger(key);
+        EXPECT_TRUE(table.Insert(index_key, rid));
+        rids.clear();
+        EXPECT_TRUE(table.GetValue(index_key, rids));
+      }
+      for (int64_t key = tid; key < scale; key += num_threads) {
+        if (key % 3 == 0) {
+          index_key.SetFromInteger(key);
+          table.Remove(index_key);
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_TRUE(table.Check());
+  GenericKey<8> index_key;
+  std::vector<RID> rids;
+  for (int64_t key = 0; key < scale; ++key) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_EQ(key % 3 != 0, table.GetValue(index_key, rids));
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace cmudb
@@ -1,6 +1,10 @@
+#include <atomic>
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "logging/common.h"
 #include "logging/log_recovery.h"
@@ -57,7 +61,187 @@ TEST(LogManagerTest, BasicLogging) {
   remove("test.log");
 }
 
+// buffers are swapped by appenders and flush requests at the same time,
+// every record must reach the log once
+TEST(LogManagerTest, ConcurrentFlushTest) {
+  const int num_threads = 4;
+  const int num_records = 20000;
+  remove("test.db");
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  log_manager->RunFlushThread();
+
+  std::atomic<bool> done(false);
+  std::thread requester([&]() {
+    while (!done) {
+      log_manager->RequestFlush();
+    }
+  });
+  std::vector<std::thread> appenders;
+  for (int i = 0; i < num_threads; ++i) {
+    appenders.emplace_back([&, i]() {
+      for (int j = 0; j < num_records; ++j) {
+        LogRecord record(i, INVALID_LSN, LogRecordType::BEGIN);
+        log_manager->AppendLogRecord(record);
+      }
+    });
+  }
+  for (auto &appender : appenders) {
+    appender.join();
+  }
+  done = true;
+  requester.join();
+  std::promise<void> promise;
+  log_manager->WakeupFlushThread(&promise);
+  EXPECT_EQ(num_threads * num_records - 1, log_manager->GetPersistentLSN());
+  log_manager->StopFlushThread();
+
+  LogRecovery log_recovery(disk_manager, nullptr);
+  std::vector<int> seen(num_threads * num_records, 0);
+  std::vector<char> buffer(LOG_BUFFER_SIZE);
+  for (int64_t offset = disk_manager->GetLogStart();
+       disk_manager->ReadLog(buffer.data(), LOG_BUFFER_SIZE, offset);
+       offset += LOG_BUFFER_SIZE) {
+    LogRecord record;
+    // a record header is 20 bytes
+    for (int pos = 0; pos + 20 <= LOG_BUFFER_SIZE &&
+                      log_recovery.DeserializeLogRecord(&buffer[pos], record);
+         pos += record.GetSize()) {
+      ASSERT_GE(record.GetLSN(), 0);
+      ASSERT_LT(record.GetLSN(), num_threads * num_records);
+      ++seen[record.GetLSN()];
+    }
+  }
+  for (int lsn = 0; lsn < num_threads * num_records; ++lsn) {
+    ASSERT_EQ(1, seen[lsn]) << "lsn " << lsn;
+  }
+
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// every flush writes a whole buffer, what a flush before left in the buffer
+// after the last record must not be read back as records
+TEST(LogManagerTest, StaleTailTest) {
+  remove("test.db");
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  log_manager->RunFlushThread();
+
+  // both buffers get many records, then the first one gets a single one
+  const int num_records[] = {100, 100, 1};
+  for (int count : num_records) {
+    for (int i = 0; i < count; ++i) {
+      LogRecord record(0, INVALID_LSN, LogRecordType::BEGIN);
+      log_manager->AppendLogRecord(record);
+    }
+    std::promise<void> promise;
+    log_manager->WakeupFlushThread(&promise);
+  }
+  log_manager->StopFlushThread();
+
+  LogRecovery log_recovery(disk_manager, nullptr);
+  std::vector<char> buffer(LOG_BUFFER_SIZE);
+  int64_t offset = disk_manager->GetLogStart();
+  for (int count : num_records) {
+    ASSERT_TRUE(
+        disk_manager->ReadLog(buffer.data(), LOG_BUFFER_SIZE, offset));
+    LogRecord record;
+    int found = 0;
+    // a record header is 20 bytes
+    for (int pos = 0; pos + 20 <= LOG_BUFFER_SIZE &&
+                      log_recovery.DeserializeLogRecord(&buffer[pos], record);
+         pos += record.GetSize()) {
+      ++found;
+    }
+    EXPECT_EQ(count, found);
+    offset += LOG_BUFFER_SIZE;
+  }
+  EXPECT_FALSE(disk_manager->ReadLog(buffer.data(), LOG_BUFFER_SIZE, offset));
+
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// without a flush thread, a full buffer is written by the append swapping it
+TEST(LogManagerTest, NoFlushThreadTest) {
+  remove("test.db");
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+
+  // three buffers of records, a record header is 20 bytes
+  int num_records = 3 * (LOG_BUFFER_SIZE / 20);
+  for (int i = 0; i < num_records; ++i) {
+    LogRecord record(0, INVALID_LSN, LogRecordType::BEGIN);
+    log_manager->AppendLogRecord(record);
+  }
+  EXPECT_EQ(2 * LOG_BUFFER_SIZE, disk_manager->GetLogSize());
+  EXPECT_EQ(2 * (LOG_BUFFER_SIZE / 20) - 1, log_manager->GetPersistentLSN());
+
+  // the same once the flush thread is stopped
+  log_manager->RunFlushThread();
+  log_manager->StopFlushThread();
+  for (int i = 0; i < num_records; ++i) {
+    LogRecord record(0, INVALID_LSN, LogRecordType::BEGIN);
+    log_manager->AppendLogRecord(record);
+  }
+  EXPECT_EQ(5 * LOG_BUFFER_SIZE, disk_manager->GetLogSize());
+
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
 // actually LogRecovery
+// the log of a transaction still active is needed by undo, it is kept
+// whatever LSN discarding asks for
+TEST(LogManagerTest, DiscardLogTest) {
+  remove("test.db");
+  remove("test.log");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  // every flush goes to a file of its own
+  disk_manager->SetLogSegmentSize(LOG_BUFFER_SIZE);
+  LogManager *log_manager = new LogManager(disk_manager);
+  log_manager->RunFlushThread();
+
+  auto append = [&](txn_id_t txn_id, LogRecordType type) {
+    LogRecord record(txn_id, INVALID_LSN, type);
+    lsn_t lsn = log_manager->AppendLogRecord(record);
+    std::promise<void> promise;
+    log_manager->WakeupFlushThread(&promise);
+    return lsn;
+  };
+  append(1, LogRecordType::BEGIN);
+  append(2, LogRecordType::BEGIN);
+  append(2, LogRecordType::COMMIT);
+  EXPECT_EQ(0, log_manager->DiscardLog(3));
+  EXPECT_EQ(0, disk_manager->GetLogStart());
+
+  lsn_t lsn = append(1, LogRecordType::COMMIT);
+  EXPECT_EQ(3, log_manager->DiscardLog(lsn));
+  EXPECT_EQ(3 * LOG_BUFFER_SIZE, disk_manager->GetLogStart());
+
+  // records not written yet are not discarded
+  LogRecord record(3, INVALID_LSN, LogRecordType::BEGIN);
+  log_manager->AppendLogRecord(record);
+  EXPECT_EQ(0, log_manager->DiscardLog(lsn + 2));
+  log_manager->StopFlushThread();
+
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove(("test.log." + std::to_string(3 * LOG_BUFFER_SIZE)).c_str());
+  remove(("test.log." + std::to_string(4 * LOG_BUFFER_SIZE)).c_str());
+}
+
 TEST(LogManagerTest, RedoTestWithOneTxn) {
   StorageEngine *storage_engine = new StorageEngine("test.db");
 
@@ -78,4 +78,143 @@ TEST(VtableTest, CreateTest) {
   remove("vtable.db");
   return;
 }
+
+TEST(VtableTest, PoolSizeTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  // pool size from the environment, then resized by a table argument
+  setenv("VTABLE_BUFFER_POOL_SIZE", "4", 1);
+  sqlite3 *db;
+  int rc;
+  rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  const char *zFile = "libvtable"; // shared library name
+  const char *zProc = 0;           // entry point within library
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, zFile, zProc, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo2 USING vtable ('a int, b "
+                          "varchar(13)', 'foo2_pk a', buffer_pool_size=64)"));
+  // a single statement, every commit waits for the log
+  std::string sql = "INSERT INTO foo2 VALUES(0, 'hello world')";
+  for (int i = 1; i < 100; ++i) {
+    sql += ", (" + std::to_string(i) + ", 'hello world')";
+  }
+  EXPECT_TRUE(ExecSQL(db, sql));
+  EXPECT_TRUE(ExecSQL(db, "SELECT * FROM foo2 WHERE a = 42"));
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo2"));
+
+  rc = sqlite3_close(db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  unsetenv("VTABLE_BUFFER_POOL_SIZE");
+
+  remove(db_file.c_str());
+  remove("vtable.db");
+  return;
+}
+
+TEST(VtableTest, BadSettingTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  int rc;
+  rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  const char *zFile = "libvtable"; // shared library name
+  const char *zProc = 0;           // entry point within library
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, zFile, zProc, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  // the statement fails, the process goes on
+  EXPECT_FALSE(ExecSQL(db, "CREATE VIRTUAL TABLE foo3 USING vtable ('a int', "
+                           "'foo3_pk a', bogus=3)"));
+  EXPECT_FALSE(ExecSQL(db, "CREATE VIRTUAL TABLE foo3 USING vtable ('a int', "
+                           "'foo3_pk a', buffer_pool_size=0)"));
+  EXPECT_FALSE(ExecSQL(db, "CREATE VIRTUAL TABLE foo3 USING vtable ('a int', "
+                           "'foo3_pk a', bogus)"));
+  // the header page was unpinned on the way out
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo3 USING vtable ('a int', "
+                          "'foo3_pk a')"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo3 VALUES(1)"));
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo3"));
+
+  rc = sqlite3_close(db);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  remove(db_file.c_str());
+  remove("vtable.db");
+  return;
+}
+
+TEST(VtableTest, HashIndexTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  int rc;
+  rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  const char *zFile = "libvtable"; // shared library name
+  const char *zProc = 0;           // entry point within library
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, zFile, zProc, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  EXPECT_FALSE(ExecSQL(db, "CREATE VIRTUAL TABLE foo3 USING vtable ('a int, "
+                           "b varchar(13)', 'foo3_pk a using trie')"));
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo3 USING vtable ('a int, b "
+                          "varchar(13)', 'foo3_pk a using hash')"));
+  // a single statement, every commit waits for the log
+  std::string sql = "INSERT INTO foo3 VALUES(0, 'hello world')";
+  for (int i = 1; i < 100; ++i) {
+    sql += ", (" + std::to_string(i) + ", 'hello world')";
+  }
+  EXPECT_TRUE(ExecSQL(db, sql));
+
+  // the point query goes through the index, idxNum 1
+  std::vector<std::string> rows;
+  EXPECT_TRUE(
+      QuerySQL(db, "EXPLAIN QUERY PLAN SELECT * FROM foo3 WHERE a = 42", rows));
+  ASSERT_EQ(1, rows.size());
+  EXPECT_NE(std::string::npos, rows[0].find("INDEX 1:"));
+  EXPECT_TRUE(QuerySQL(db, "SELECT * FROM foo3 WHERE a = 42", rows));
+  ASSERT_EQ(1, rows.size());
+  EXPECT_EQ("42|hello world", rows[0]);
+  EXPECT_TRUE(QuerySQL(db, "SELECT * FROM foo3 WHERE a = 100", rows));
+  EXPECT_EQ(0, rows.size());
+
+  EXPECT_TRUE(ExecSQL(db, "DELETE FROM foo3 WHERE a = 42"));
+  EXPECT_TRUE(QuerySQL(db, "SELECT * FROM foo3 WHERE a = 42", rows));
+  EXPECT_EQ(0, rows.size());
+  EXPECT_TRUE(QuerySQL(db, "SELECT * FROM foo3 WHERE a = 43", rows));
+  ASSERT_EQ(1, rows.size());
+  EXPECT_EQ("43|hello world", rows[0]);
+  EXPECT_TRUE(QuerySQL(db, "SELECT count(*) FROM foo3", rows));
+  ASSERT_EQ(1, rows.size());
+  EXPECT_EQ("99", rows[0]);
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo3"));
+
+  rc = sqlite3_close(db);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  remove(db_file.c_str());
+  remove("vtable.db");
+  return;
+}
 } // namespace cmudb